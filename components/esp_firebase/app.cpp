@@ -1,21 +1,25 @@
 
 #include <iostream>
+#include <stdlib.h>
+#include <time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_tls.h"
+#include "sdkconfig.h"
 
 #include "app.h"
+#include "json_stream.h"
 
 
 
 #include "jsoncpp/value.h"
 #include "jsoncpp/json.h"
 
-// #include "nvs.h"
-// #include "nvs_flash.h"
+#include "nvs.h"
 #define NVS_TAG "NVS"
 
 
@@ -30,13 +34,16 @@ extern const char cert_end[]   asm("_binary_gtsr1_pem_end");
 static int output_len = 0; 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
+    ESPFirebase::host_client_t* host_client = (ESPFirebase::host_client_t*)evt->user_data;
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ERROR");
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_CONNECTED");
-            memset(evt->user_data, 0, HTTP_RECV_BUFFER_SIZE);
+            host_client->connections++;
+            host_client->connected_us = esp_timer_get_time();
+            memset(host_client->response_buffer, 0, HTTP_RECV_BUFFER_SIZE);
             output_len = 0;
             break;
         case HTTP_EVENT_HEADER_SENT:
@@ -53,10 +60,26 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
             output_len = 0;
             break;
         case HTTP_EVENT_ON_DATA:
+        {
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            memcpy((char*)evt->user_data + output_len, evt->data, evt->data_len);  // cast adicionado aqui
-            output_len += evt->data_len;
+            int status_code = esp_http_client_get_status_code(evt->client);
+            if (host_client->parser != NULL && status_code >= 200 && status_code < 300)
+            {
+                // Parsed chunk by chunk, nothing kept; a parse error stays in the parser
+                host_client->parser->feed((const char*)evt->data, evt->data_len);
+                break;
+            }
+            // Room left for the terminating zero: the rest of a larger response is dropped
+            int len = evt->data_len;
+            if (len > HTTP_RECV_BUFFER_SIZE - 1 - output_len)
+            {
+                ESP_LOGW(HTTP_TAG, "Response larger than %d bytes, truncated", HTTP_RECV_BUFFER_SIZE - 1);
+                len = HTTP_RECV_BUFFER_SIZE - 1 - output_len;
+            }
+            memcpy(host_client->response_buffer + output_len, evt->data, len);
+            output_len += len;
             break;
+        }
         case HTTP_EVENT_DISCONNECTED:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_DISCONNECTED");
             break;
@@ -71,38 +94,227 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 }
 namespace ESPFirebase {
 
-// TODO: protect this function from breaking 
-void FirebaseApp::firebaseClientInit(void)
-{   
+// Client of the url's host, created on first use and kept open between requests
+host_client_t* FirebaseApp::getClient(const char* url)
+{
+    std::string host = url;
+    size_t begin = host.find("://");
+    begin = (begin == std::string::npos) ? 0 : begin + 3;
+    host = host.substr(begin, host.find_first_of(":/?", begin) - begin);
+
+    host_client_t* host_client = NULL;
+    for (int i = 0; i < FirebaseApp::client_count; i++)
+    {
+        if (FirebaseApp::clients[i].host == host)
+        {
+            return &FirebaseApp::clients[i];
+        }
+        if (host_client == NULL || FirebaseApp::clients[i].last_used < host_client->last_used)
+        {
+            host_client = &FirebaseApp::clients[i];
+        }
+    }
+
+    if (FirebaseApp::client_count < FIREBASE_MAX_HOSTS)
+    {
+        host_client = &FirebaseApp::clients[FirebaseApp::client_count++];
+    }
+    else
+    {
+        ESP_LOGD(FIREBASE_APP_TAG, "Closing connection to %s", host_client->host.c_str());
+        esp_http_client_cleanup(host_client->handle);
+    }
+
+    std::string host_url = "https://" + host;
+    host_client->host = host;
+    host_client->response_buffer = FirebaseApp::local_response_buffer;
+    host_client->connections = 0;
+    host_client->parser = NULL;
+
     esp_http_client_config_t config = {0};
-    config.url = "https://google.com";    // you have to set this as https link of some sort so that it can init properly, you cant leave it empty
+    config.url = host_url.c_str();
     config.event_handler = http_event_handler;
     config.cert_pem = FirebaseApp::https_certificate;
-    config.user_data = FirebaseApp::local_response_buffer;
+    config.user_data = host_client;
     config.buffer_size_tx = 4096;
     config.buffer_size = HTTP_RECV_BUFFER_SIZE;
-    FirebaseApp::client = esp_http_client_init(&config);
-    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client Initialized");
-
+    config.keep_alive_enable = true;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // The transport keeps the last session ticket and presents it when it reconnects,
+    // e.g. after a Wi-Fi drop: an abbreviated handshake without the certificate exchange
+    // The ticket is kept in RAM only, esp_http_client has no API to export it or seed a client
+    // with it: the first connection to each host after a reboot is a full handshake
+    config.save_client_session = true;
+#endif
+    host_client->handle = esp_http_client_init(&config);
+    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client for %s Initialized", host.c_str());
+    return host_client;
 }
 
-
 esp_err_t FirebaseApp::setHeader(const char* header, const char* value)
 {    
-    return esp_http_client_set_header(FirebaseApp::client, header, value);
+    for (auto& entry : FirebaseApp::headers)
+    {
+        if (entry.first == header)
+        {
+            entry.second = value;
+            return ESP_OK;
+        }
+    }
+    FirebaseApp::headers.emplace_back(header, value);
+    return ESP_OK;
+}
+
+http_stats_t FirebaseApp::getHttpStats(void) const
+{
+    return FirebaseApp::http_stats;
+}
+
+// JsonStream sink: hands each chunk to the open request, esp_http_client_write() may take part of it
+static esp_err_t http_write_sink(void* ctx, const char* data, size_t len)
+{
+    esp_http_client_handle_t client = (esp_http_client_handle_t)ctx;
+    while (len > 0)
+    {
+        int written = esp_http_client_write(client, data, len);
+        if (written <= 0)
+        {
+            return ESP_FAIL;
+        }
+        data += written;
+        len -= written;
+    }
+    return ESP_OK;
+}
+
+http_ret_t FirebaseApp::performRequest(const char* url, esp_http_client_method_t method, const std::string& post_field,
+                                       JsonParser* response)
+{
+    return FirebaseApp::sendRequest(url, method, post_field.data(), post_field.length(), NULL, response);
+}
+
+http_ret_t FirebaseApp::performRequest(const char* url, esp_http_client_method_t method, const char* data, size_t len,
+                                       JsonParser* response)
+{
+    return FirebaseApp::sendRequest(url, method, data, len, NULL, response);
 }
 
-http_ret_t FirebaseApp::performRequest(const char* url, esp_http_client_method_t method, std::string post_field)
+http_ret_t FirebaseApp::performRequest(const char* url, esp_http_client_method_t method, const json_body_t& body,
+                                       JsonParser* response)
 {
-    ESP_ERROR_CHECK(esp_http_client_set_url(FirebaseApp::client, url));
-    ESP_ERROR_CHECK(esp_http_client_set_method(FirebaseApp::client, method));
-    ESP_ERROR_CHECK(esp_http_client_set_post_field(FirebaseApp::client, post_field.c_str(), post_field.length()));
-    esp_err_t err = esp_http_client_perform(FirebaseApp::client);
-    int status_code = esp_http_client_get_status_code(FirebaseApp::client);
-    if (err != ESP_OK || status_code != 200)
+    return FirebaseApp::sendRequest(url, method, NULL, 0, &body, response);
+}
+
+// Every request goes through esp_http_client_open()/write() rather than perform(), so a client
+// never mixes both; the response still reaches http_event_handler through flush_response()
+http_ret_t FirebaseApp::sendRequest(const char* url, esp_http_client_method_t method, const char* data, size_t len,
+                                    const json_body_t* body, JsonParser* response)
+{
+    FirebaseLock lock(this);
+    host_client_t* host_client = FirebaseApp::getClient(url);
+    if (host_client->handle == NULL)
+    {
+        return {ESP_ERR_NO_MEM, 0};
+    }
+    esp_http_client_handle_t client = host_client->handle;
+
+    // A streamed body is produced once without a sink to learn its Content-Length
+    if (body != NULL)
+    {
+        JsonStream counter;
+        (*body)(counter);
+        len = counter.length();
+    }
+
+    // Cleared before the headers: clearing the post field also drops content-type
+    esp_http_client_set_post_field(client, NULL, 0);
+    for (const auto& entry : FirebaseApp::headers)
+    {
+        esp_http_client_set_header(client, entry.first.c_str(), entry.second.c_str());
+    }
+    ESP_ERROR_CHECK(esp_http_client_set_url(client, url));
+    ESP_ERROR_CHECK(esp_http_client_set_method(client, method));
+
+    // Same host as its last request: esp_http_client keeps the connection unless the server closed it
+    uint32_t connections = host_client->connections;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = ESP_FAIL;
+    int status_code = 0;
+    bool reused = false;    // The last attempt was opened on the connection already open
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        uint32_t before = host_client->connections;
+        reused = false;
+        err = esp_http_client_open(client, len);
+        if (err == ESP_OK)
+        {
+            reused = host_client->connections == before;
+            if (body != NULL)
+            {
+                JsonStream stream(http_write_sink, client);
+                (*body)(stream);
+                err = stream.finish();
+            }
+            else
+            {
+                err = http_write_sink(client, data, len);
+            }
+        }
+        if (err == ESP_OK && esp_http_client_fetch_headers(client) < 0)
+        {
+            err = ESP_FAIL;
+        }
+        if (err == ESP_OK)
+        {
+            status_code = esp_http_client_get_status_code(client);
+            host_client->parser = response;
+            err = esp_http_client_flush_response(client, NULL);
+            host_client->parser = NULL;
+            if (err == ESP_OK && response != NULL && status_code >= 200 && status_code < 300)
+            {
+                err = response->finish();
+                if (err != ESP_OK)
+                {
+                    ESP_LOGE(FIREBASE_APP_TAG, "Response not valid JSON at byte %u", (unsigned)response->offset());
+                }
+            }
+            break;
+        }
+        esp_http_client_close(client);
+        // The server dropped a kept-alive connection since the last request: once more on a new one
+        if (!reused)
+        {
+            break;
+        }
+        ESP_LOGD(FIREBASE_APP_TAG, "Connection to %s closed by the server, reconnecting", host_client->host.c_str());
+    }
+
+    host_client->last_used = ++FirebaseApp::http_stats.requests;
+    if (host_client->connections != connections)
+    {
+        FirebaseApp::http_stats.handshakes++;
+        if (connections > 0)
+        {
+            FirebaseApp::http_stats.reconnects++;
+            FirebaseApp::http_stats.reconnect_us += host_client->connected_us - start_us;
+        }
+        else
+        {
+            FirebaseApp::http_stats.handshake_us += host_client->connected_us - start_us;
+        }
+    }
+    else if (reused)
+    {
+        FirebaseApp::http_stats.reused++;
+    }
+    else
+    {
+        FirebaseApp::http_stats.connect_failures++;
+    }
+    if (err != ESP_OK || status_code < 200 || status_code >= 300)
     {
         ESP_LOGE(FIREBASE_APP_TAG, "Error while performing request esp_err_t code=0x%x | status_code=%d", (int)err, status_code);
-        ESP_LOGE(FIREBASE_APP_TAG, "request: url=%s \nmethod=%d \npost_field=%s", url, method, post_field.c_str());
+        ESP_LOGE(FIREBASE_APP_TAG, "request: url=%s \nmethod=%d \nbody=%u bytes", url, method, (unsigned)len);
         ESP_LOGE(FIREBASE_APP_TAG, "response=\n%s", local_response_buffer);
     }
     return {err, status_code};
@@ -125,24 +337,22 @@ esp_err_t FirebaseApp::getRefreshToken(bool register_account)
     account_json += FirebaseApp::user_account.user_password;
     account_json += R"(", "returnSecureToken": true})"; 
 
+    // The response, with its ID token, is parsed as it arrives rather than through local_response_buffer
+    JsonValueBuilder builder;
+    JsonParser parser(&builder);
     FirebaseApp::setHeader("content-type", "application/json");
     if (register_account)
     {
-        http_ret = FirebaseApp::performRequest(FirebaseApp::register_url.c_str(), HTTP_METHOD_POST, account_json);
+        http_ret = FirebaseApp::performRequest(FirebaseApp::register_url.c_str(), HTTP_METHOD_POST, account_json, &parser);
     }
     else
     {
-        http_ret = FirebaseApp::performRequest(FirebaseApp::login_url.c_str(), HTTP_METHOD_POST, account_json);
+        http_ret = FirebaseApp::performRequest(FirebaseApp::login_url.c_str(), HTTP_METHOD_POST, account_json, &parser);
     }
 
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        // std::cout << FirebaseApp::local_response_buffer << '\n';
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
-        Json::Value data;
-        reader.parse(begin, end, data, false);
+        Json::Value data = builder.release();
         FirebaseApp::refresh_token = data["refreshToken"].asString();
 
         ESP_LOGD(FIREBASE_APP_TAG, "Refresh Token=%s", FirebaseApp::refresh_token.c_str());
@@ -161,21 +371,35 @@ esp_err_t FirebaseApp::getAuthToken()
     token_post_data+= FirebaseApp::refresh_token + "\"}";
 
 
+    JsonValueBuilder builder;
+    JsonParser parser(&builder);
     FirebaseApp::setHeader("content-type", "application/json");
-    http_ret = FirebaseApp::performRequest(FirebaseApp::auth_url.c_str(), HTTP_METHOD_POST, token_post_data);
+    http_ret = FirebaseApp::performRequest(FirebaseApp::auth_url.c_str(), HTTP_METHOD_POST, token_post_data, &parser);
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
-        Json::Value data;
-        reader.parse(begin, end, data, false);
+        Json::Value data = builder.release();
         FirebaseApp::auth_token = data["access_token"].asString();
+        // expires_in is a string of seconds, 3600 for Firebase ID tokens
+        long long expires_in = atoll(data["expires_in"].asString().c_str());
+        if (expires_in <= FIREBASE_TOKEN_REFRESH_MARGIN_S)
+        {
+            expires_in = 3600;
+        }
+        FirebaseApp::auth_expiry.start(expires_in, esp_timer_get_time(), time(NULL));
+        if (data["refresh_token"].isString())
+        {
+            FirebaseApp::refresh_token = data["refresh_token"].asString();
+        }
 
         ESP_LOGD(FIREBASE_APP_TAG, "Auth Token=%s", FirebaseApp::auth_token.c_str());
 
         return ESP_OK;
     }
+    else if (http_ret.err == ESP_OK && http_ret.status_code >= 400 && http_ret.status_code < 500)
+    {
+        // Revoked or expired refresh token, or the account was disabled
+        return ESP_ERR_INVALID_STATE;
+    }
     else 
     {
         return ESP_FAIL;
@@ -184,59 +408,279 @@ esp_err_t FirebaseApp::getAuthToken()
     
 }
 
-// esp_err_t FirebaseApp::nvsSaveTokens() // useless until expire time added
-// {
-//     nvs_handle_t my_handle;
-//     esp_err_t err;
-//     err = nvs_open("storage", NVS_READWRITE, &my_handle);
-//     err = nvs_set_str(my_handle, "refresh", FirebaseApp::refresh_token.c_str());
-//     err = nvs_set_str(my_handle, "auth", FirebaseApp::auth_token.c_str());
-//     err = nvs_commit(my_handle);
-//     nvs_close(my_handle);
-//     ESP_LOGD(NVS_TAG, "Tokens saved");
-//     return err;
-
-// }
-// esp_err_t FirebaseApp::nvsReadTokens() // useless until expire time added
-// {
-//     nvs_handle_t my_handle;
-//     esp_err_t err;
-//     int refresh_len, auth_len = 0;
-//     char refresh[500] = {0};
-//     char auth[500] = {0};
-//     err = nvs_open("storage", NVS_READWRITE, &my_handle);
-
-//     // err = nvs_set_i16(my_handle, "refresh_len", &refresh_len);
-//     // err = nvs_set_i16(my_handle, "auth_len", &auth_len);
-
-//     err = nvs_get_str(&my_handle, "refresh", &refresh_temp, &refresh_len);
-//     err = nvs_get_str(&my_handle, "auth", &auth_temp, &auth_len);
-//     err = nvs_commit(my_handle);
-//     nvs_close(my_handle);
-
-//     FirebaseApp::refresh_token = std::string(refresh_temp);
-//     FirebaseApp::auth_token = std::string(auth_temp);
-
-//     ESP_LOGD(NVS_TAG, "Tokens read");
-//     return err;
-
-// }
+esp_err_t FirebaseApp::refreshAuthToken(void)
+{
+    FirebaseLock lock(this);
+
+    esp_err_t err = FirebaseApp::getAuthToken();
+    FirebaseApp::clearHTTPBuffer();
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGW(FIREBASE_APP_TAG, "Refresh token rejected, signing in again");
+        err = FirebaseApp::getRefreshToken(false);
+        FirebaseApp::clearHTTPBuffer();
+        if (err == ESP_OK)
+        {
+            err = FirebaseApp::getAuthToken();
+            FirebaseApp::clearHTTPBuffer();
+        }
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(FIREBASE_APP_TAG, "Failed to refresh auth token");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(FIREBASE_APP_TAG, "Auth token refreshed");
+    FirebaseApp::nvsSaveTokens();
+    return ESP_OK;
+}
+
+int64_t FirebaseApp::getAuthTokenExpiry(void) const
+{
+    return FirebaseApp::auth_expiry.timerUs();
+}
+
+// A token obtained before SNTP set the clock is stored without its wall clock expiry: add it once the clock is set
+bool FirebaseApp::syncTokenExpiry(void)
+{
+    FirebaseLock lock(this);
+
+    if (FirebaseApp::auth_expiry.syncWallClock(esp_timer_get_time(), time(NULL)))
+    {
+        ESP_LOGI(FIREBASE_APP_TAG, "Wall clock set, auth token expiry stored");
+        FirebaseApp::nvsSaveTokens();
+    }
+    return FirebaseApp::auth_expiry.wallClockPending();
+}
+
+void FirebaseApp::lock(void)
+{
+    xSemaphoreTakeRecursive(FirebaseApp::lock_handle, portMAX_DELAY);
+}
+
+void FirebaseApp::unlock(void)
+{
+    xSemaphoreGiveRecursive(FirebaseApp::lock_handle);
+}
+
+FirebaseLock::FirebaseLock(FirebaseApp* app)
+    : app(app)
+{
+    app->lock();
+}
+
+FirebaseLock::~FirebaseLock()
+{
+    app->unlock();
+}
+
+// Sleeps until shortly before the ID token expires and refreshes it, so requests never wait for a login
+void FirebaseApp::tokenRefreshTask(void* arg)
+{
+    FirebaseApp* app = (FirebaseApp*)arg;
+    int64_t retry_us = 0;
+
+    while (1)
+    {
+        bool clock_pending = app->syncTokenExpiry();
+        int64_t wake_us = app->getAuthTokenExpiry() - FIREBASE_TOKEN_REFRESH_MARGIN_S * 1000000LL;
+        if (retry_us > wake_us)
+        {
+            wake_us = retry_us;
+        }
+        int64_t wait_us = wake_us - esp_timer_get_time();
+        if (clock_pending && wait_us > FIREBASE_CLOCK_POLL_S * 1000000LL)
+        {
+            // Back soon to check whether SNTP has set the clock
+            wait_us = FIREBASE_CLOCK_POLL_S * 1000000LL;
+        }
+        if (wait_us > 0)
+        {
+            // Woken early by a notification when a login renewed the token meanwhile
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_us / 1000) + 1) > 0)
+            {
+                continue;
+            }
+            if (esp_timer_get_time() < wake_us)
+            {
+                continue;
+            }
+        }
+
+        if (app->refreshAuthToken() == ESP_OK)
+        {
+            retry_us = 0;
+        }
+        else
+        {
+            retry_us = esp_timer_get_time() + FIREBASE_TOKEN_RETRY_S * 1000000LL;
+        }
+    }
+}
+
+void FirebaseApp::startTokenRefresh(void)
+{
+    if (FirebaseApp::refresh_task != NULL)
+    {
+        xTaskNotifyGive(FirebaseApp::refresh_task);
+        return;
+    }
+    // The refresh performs TLS handshakes on this stack
+    if (xTaskCreate(tokenRefreshTask, "fb_token", 8192, this, 5, &this->refresh_task) != pdPASS)
+    {
+        ESP_LOGE(FIREBASE_APP_TAG, "Failed to start the token refresh task");
+        FirebaseApp::refresh_task = NULL;
+    }
+}
+
+static esp_err_t nvs_get_string(nvs_handle_t handle, const char* key, std::string& out)
+{
+    size_t len = 0;
+    esp_err_t err = nvs_get_str(handle, key, NULL, &len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    out.resize(len);
+    err = nvs_get_str(handle, key, &out[0], &len);
+    out.resize(len > 0 ? len - 1 : 0);   // len counts the terminator
+    return err;
+}
+
+// Tokens are stored with the account they belong to and the wall clock expiry of the ID token
+esp_err_t FirebaseApp::nvsSaveTokens()
+{
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open(FIREBASE_NVS_NAMESPACE, NVS_READWRITE, &my_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(NVS_TAG, "Failed to open namespace: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_set_str(my_handle, "email", FirebaseApp::user_account.user_email);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_str(my_handle, "refresh", FirebaseApp::refresh_token.c_str());
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_set_str(my_handle, "auth", FirebaseApp::auth_token.c_str());
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_set_i64(my_handle, "auth_exp", FirebaseApp::auth_expiry.wallClock());
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(my_handle);
+    }
+    nvs_close(my_handle);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(NVS_TAG, "Failed to save tokens: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGD(NVS_TAG, "Tokens saved");
+    return ESP_OK;
+}
+
+// Loads the stored tokens, only if they belong to the current account
+esp_err_t FirebaseApp::nvsReadTokens(int64_t& auth_exp)
+{
+    nvs_handle_t my_handle;
+    std::string email, refresh, auth;
+
+    esp_err_t err = nvs_open(FIREBASE_NVS_NAMESPACE, NVS_READONLY, &my_handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_get_string(my_handle, "email", email);
+    if (err == ESP_OK)
+    {
+        err = nvs_get_string(my_handle, "refresh", refresh);
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_get_string(my_handle, "auth", auth);
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_get_i64(my_handle, "auth_exp", &auth_exp);
+    }
+    nvs_close(my_handle);
+
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (email != FirebaseApp::user_account.user_email || refresh.empty())
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FirebaseApp::refresh_token = refresh;
+    FirebaseApp::auth_token = auth;
+
+    ESP_LOGD(NVS_TAG, "Tokens read");
+    return ESP_OK;
+}
+
+// Continues the session stored by a previous boot: its ID token while still valid, else a new one from its refresh token
+esp_err_t FirebaseApp::resumeSession(void)
+{
+    int64_t auth_exp = 0;
+    esp_err_t err = FirebaseApp::nvsReadTokens(auth_exp);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    int64_t valid_s = FirebaseApp::auth_token.empty() ? 0
+        : FirebaseApp::auth_expiry.resume(auth_exp, FIREBASE_TOKEN_REFRESH_MARGIN_S, esp_timer_get_time(), time(NULL));
+    if (valid_s > 0)
+    {
+        ESP_LOGI(FIREBASE_APP_TAG, "Using stored auth token, valid for %lld s", (long long)valid_s);
+        return ESP_OK;
+    }
+
+    err = FirebaseApp::getAuthToken();
+    FirebaseApp::clearHTTPBuffer();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    ESP_LOGI(FIREBASE_APP_TAG, "Auth token renewed from stored refresh token");
+    FirebaseApp::nvsSaveTokens();
+    return ESP_OK;
+}
 
 FirebaseApp::FirebaseApp(const char* api_key)
     : https_certificate(cert_start), api_key(api_key)
 {
     
     FirebaseApp::local_response_buffer = new char[HTTP_RECV_BUFFER_SIZE];
+    FirebaseApp::lock_handle = xSemaphoreCreateRecursiveMutex();
     FirebaseApp::register_url += FirebaseApp::api_key; 
     FirebaseApp::login_url += FirebaseApp::api_key;
     FirebaseApp::auth_url += FirebaseApp::api_key;
-    firebaseClientInit();
 }
 
 FirebaseApp::~FirebaseApp()
 {
+    // Not while it refreshes: it only blocks on the lock or its notification otherwise
+    FirebaseApp::lock();
+    if (FirebaseApp::refresh_task != NULL)
+    {
+        vTaskDelete(FirebaseApp::refresh_task);
+    }
+    FirebaseApp::unlock();
+    vSemaphoreDelete(FirebaseApp::lock_handle);
+    for (int i = 0; i < FirebaseApp::client_count; i++)
+    {
+        esp_http_client_cleanup(FirebaseApp::clients[i].handle);
+    }
     delete[] FirebaseApp::local_response_buffer;
-    esp_http_client_cleanup(FirebaseApp::client);
 }
 
 esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
@@ -246,6 +690,7 @@ esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
         FirebaseApp::user_account.user_email = account.user_email;
         FirebaseApp::user_account.user_password = account.user_password;
     }
+    FirebaseLock lock(this);
     esp_err_t err = FirebaseApp::getRefreshToken(true);
     if (err != ESP_OK)
     {
@@ -261,6 +706,8 @@ esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
     }
     FirebaseApp::clearHTTPBuffer();
     ESP_LOGI(FIREBASE_APP_TAG, "Created user successfully");
+    FirebaseApp::nvsSaveTokens();
+    FirebaseApp::startTokenRefresh();
 
     return ESP_OK;
 }
@@ -272,7 +719,21 @@ esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
         FirebaseApp::user_account.user_email = account.user_email;
         FirebaseApp::user_account.user_password = account.user_password;
     }
-    esp_err_t err = FirebaseApp::getRefreshToken(false);
+    FirebaseLock lock(this);
+    // No password sign in when a previous boot left tokens for this account
+    esp_err_t err = FirebaseApp::resumeSession();
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(FIREBASE_APP_TAG, "Login to user successful, session resumed");
+        FirebaseApp::startTokenRefresh();
+        return ESP_OK;
+    }
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGW(FIREBASE_APP_TAG, "Stored refresh token rejected, signing in again");
+    }
+
+    err = FirebaseApp::getRefreshToken(false);
     if (err != ESP_OK)
     {
         ESP_LOGE(FIREBASE_APP_TAG, "Failed to get refresh token");
@@ -288,6 +749,8 @@ esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
     }
     FirebaseApp::clearHTTPBuffer();
     ESP_LOGI(FIREBASE_APP_TAG, "Login to user successful");
+    FirebaseApp::nvsSaveTokens();
+    FirebaseApp::startTokenRefresh();
     return ESP_OK;
 }
 
@@ -1,9 +1,24 @@
 #ifndef _ESP_FIREBASE_H_
 #define  _ESP_FIREBASE_H_
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
 #include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "json_parser.h"
+#include "json_stream.h"
+#include "token_expiry.h"
 
 
 #define HTTP_RECV_BUFFER_SIZE 4096
+#define FIREBASE_MAX_HOSTS 4    // Persistent connections kept at once, one per host
+#define FIREBASE_TOKEN_REFRESH_MARGIN_S 300 // Refresh the ID token this long before it expires
+#define FIREBASE_TOKEN_RETRY_S 30           // Wait after a failed refresh
+#define FIREBASE_NVS_NAMESPACE "firebase"   // Tokens kept across reboots
+#define FIREBASE_CLOCK_POLL_S 10            // Check for SNTP this often while a token has no wall clock expiry
 
 namespace ESPFirebase 
 {
@@ -19,6 +34,45 @@ namespace ESPFirebase
         esp_err_t err;
         int status_code;
     }; 
+
+    struct http_stats_t
+    {
+        uint32_t requests;
+        uint32_t handshakes;    // Requests that had to open a connection (TCP + TLS)
+        uint32_t reused;        // Requests sent over an already open connection
+        uint32_t connect_failures; // Requests that found no open connection and could not open one
+        uint32_t reconnects;    // Handshakes to a host connected before: abbreviated when its session ticket is cached
+        int64_t handshake_us;   // Time spent connecting, first connection to each host, always a full handshake
+        int64_t reconnect_us;   // Time spent connecting, reconnects
+    };
+
+    /**
+     * @brief One esp_http_client per host, so switching hosts does not close the other connections
+     */
+    struct host_client_t
+    {
+        std::string host;
+        esp_http_client_handle_t handle;
+        char* response_buffer;      // Shared FirebaseApp::local_response_buffer
+        JsonParser* parser;         // Takes the 2xx response body of the current request instead of response_buffer
+        uint32_t connections;       // HTTP_EVENT_ON_CONNECTED count
+        int64_t connected_us;       // esp_timer time of the last HTTP_EVENT_ON_CONNECTED
+        uint32_t last_used;         // Request number of the last use, to evict the least recently used
+    };
+    class FirebaseApp;
+
+    /**
+     * @brief Holds FirebaseApp::lock() for a scope
+     */
+    class FirebaseLock
+    {
+    private:
+        FirebaseApp* app;
+    public:
+        explicit FirebaseLock(FirebaseApp* app);
+        ~FirebaseLock();
+    };
+
     /**
      * @brief Class over the esp_http_client, handles auth and should be passed as ptr to other classes such as RTDB 
      * 
@@ -32,17 +86,26 @@ namespace ESPFirebase
             std::string login_url = "https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=";
             std::string auth_url = "https://securetoken.googleapis.com/v1/token?key=";
             std::string refresh_token = "";
-            esp_http_client_handle_t client;
-            bool client_initialized = false;
-
-
-
-            void firebaseClientInit(void);
+            host_client_t clients[FIREBASE_MAX_HOSTS] = {};
+            int client_count = 0;
+            std::vector<std::pair<std::string, std::string>> headers;
+            http_stats_t http_stats = {};
+            SemaphoreHandle_t lock_handle;
+            TaskHandle_t refresh_task = NULL;
+            TokenExpiry auth_expiry;    // Of auth_token
+
+            host_client_t* getClient(const char* url);
         
             esp_err_t getRefreshToken(bool register_account);
             esp_err_t getAuthToken();
-            esp_err_t nvsSaveTokens(); // useless until expire time added
-            esp_err_t nvsReadTokens(); // useless until expire time added
+            void startTokenRefresh(void);
+            static void tokenRefreshTask(void* arg);
+            esp_err_t nvsSaveTokens();
+            esp_err_t nvsReadTokens(int64_t& auth_exp);
+            bool syncTokenExpiry(void);
+            esp_err_t resumeSession(void);
+            http_ret_t sendRequest(const char* url, esp_http_client_method_t method, const char* data, size_t len,
+                                   const json_body_t* body, JsonParser* response);
             
 
         public:
@@ -53,23 +116,66 @@ namespace ESPFirebase
             std::string auth_token = "";
 
             /**
-             * @brief Standard http request. Use after firebaseClientInit(). response stored in local_response_buffer. 
+             * @brief Standard http request. Use after firebaseClientInit(). response stored in local_response_buffer,
+             * truncated to HTTP_RECV_BUFFER_SIZE - 1 bytes, unless a response parser is given.
              * 
              * @param url Request url
              * @param method Request method
              * @param post_field Optional post field. Used when method is POST
+             * @param response Optional parser fed a 2xx response body as it arrives, whatever its size;
+             * a parse error is returned as the request's esp_err_t. Error responses still go to local_response_buffer.
              * @return Returns struct http_ret_t: esp_err_t + http status code.
              */
-            http_ret_t performRequest(const char* url, esp_http_client_method_t method, std::string post_field = "");
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const std::string& post_field = "",
+                                      JsonParser* response = NULL);
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const char* data, size_t len,
+                                      JsonParser* response = NULL);
+            /**
+             * @brief Request whose body is written straight to the connection as it is produced,
+             * in JSON_STREAM_CHUNK pieces: no copy of the whole body is ever held
+             */
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const json_body_t& body,
+                                      JsonParser* response = NULL);
+            /**
+             * @brief Header sent with every following request, whatever its host
+             */
             esp_err_t setHeader(const char* header, const char* value);
+            http_stats_t getHttpStats(void) const;
+
+            /**
+             * @brief Serialize use of the app between tasks: hold it from a request until its response is consumed
+             * 
+             * The background token refresh takes it too. Recursive.
+             */
+            void lock(void);
+            void unlock(void);
+
+            /**
+             * @brief Exchange the refresh token for a new ID token; signs in with the password only
+             * if the refresh token itself is rejected. Runs on its own before expiry, after a login.
+             */
+            esp_err_t refreshAuthToken(void);
+
+            /**
+             * @brief esp_timer time at which the current ID token expires, 0 before a login
+             */
+            int64_t getAuthTokenExpiry(void) const;
             
             void clearHTTPBuffer(void);
             
           
 
             FirebaseApp(const char * api_key);
+            FirebaseApp(const FirebaseApp&) = delete;   // The refresh task holds a pointer to it
+            FirebaseApp& operator=(const FirebaseApp&) = delete;
             ~FirebaseApp();
             esp_err_t registerUserAccount(const user_account_t& account);
+            /**
+             * @brief Sign in. Tokens are kept in NVS: a later boot reuses the stored ID token while it is
+             * valid, or renews it from the stored refresh token, before falling back to the password.
+             * Needs nvs_flash_init() and, to trust the stored expiry, a wall clock set by SNTP; a token
+             * obtained before SNTP gets its stored expiry once the clock is set.
+             */
             esp_err_t loginUserAccount(const user_account_t& account);
         };
 }
@@ -0,0 +1,604 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+
+
+namespace ESPFirebase {
+
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+JsonParser::JsonParser(JsonHandler* handler)
+    : handler(handler)
+{
+    reset();
+}
+
+void JsonParser::reset(void)
+{
+    state = VALUE;
+    in_key = false;
+    escape = 0;
+    literal_pos = 0;
+    literal = NULL;
+    code = 0;
+    high_surrogate = 0;
+    depth = 0;
+    token.clear();
+    consumed = 0;
+    err = ESP_OK;
+}
+
+esp_err_t JsonParser::feed(const char* data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && err == ESP_OK)
+    {
+        if (state == STRING && escape == 0 && high_surrogate == 0)
+        {
+            // Plain characters of a string in one append
+            size_t run = i;
+            while (run < len && data[run] != '"' && data[run] != '\\')
+            {
+                run++;
+            }
+            token.append(data + i, run - i);
+            consumed += run - i;
+            i = run;
+            if (i == len)
+            {
+                break;
+            }
+        }
+        if (state == NUMBER && !is_number_char(data[i]))
+        {
+            // The character after a number is read again in the state that follows it
+            if (!endNumber() && err == ESP_OK)
+            {
+                err = ESP_ERR_INVALID_RESPONSE;
+            }
+            continue;
+        }
+        if (!step(data[i]))
+        {
+            if (err == ESP_OK)
+            {
+                err = ESP_ERR_INVALID_RESPONSE;
+            }
+            break;
+        }
+        consumed++;
+        i++;
+    }
+    return err;
+}
+
+esp_err_t JsonParser::finish(void)
+{
+    if (err == ESP_OK && state == NUMBER && !endNumber() && err == ESP_OK)
+    {
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    if (err == ESP_OK && state != DONE)
+    {
+        // Truncated or empty
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    return err;
+}
+
+size_t JsonParser::offset(void) const
+{
+    return consumed;
+}
+
+bool JsonParser::step(char c)
+{
+    switch (state)
+    {
+    case STRING:
+        return stringChar(c);
+    case NUMBER:
+        token += c;
+        return true;
+    case LITERAL:
+        if (c != literal[literal_pos])
+        {
+            return false;
+        }
+        if (literal[++literal_pos] == '\0')
+        {
+            bool ok = literal[0] == 'n' ? handler->null() : handler->boolean(literal[0] == 't');
+            if (!ok)
+            {
+                err = ESP_FAIL;
+                return false;
+            }
+            return valueDone();
+        }
+        return true;
+    default:
+        break;
+    }
+
+    if (is_space(c))
+    {
+        return true;
+    }
+    switch (state)
+    {
+    case VALUE:
+        return beginValue(c);
+    case VALUE_OR_END:
+        return c == ']' ? endContainer(c) : beginValue(c);
+    case KEY_OR_END:
+        if (c == '}')
+        {
+            return endContainer(c);
+        }
+        // fall through
+    case KEY:
+        if (c != '"')
+        {
+            return false;
+        }
+        state = STRING;
+        in_key = true;
+        token.clear();
+        return true;
+    case COLON:
+        if (c != ':')
+        {
+            return false;
+        }
+        state = VALUE;
+        return true;
+    case COMMA_OR_END:
+        if (c == ',')
+        {
+            state = containers[depth - 1] == '{' ? KEY : VALUE;
+            return true;
+        }
+        return endContainer(c);
+    default:
+        // Anything but whitespace after the document
+        return false;
+    }
+}
+
+bool JsonParser::beginValue(char c)
+{
+    bool ok = true;
+    switch (c)
+    {
+    case '{':
+    case '[':
+        if (depth == JSON_PARSER_MAX_DEPTH)
+        {
+            err = ESP_ERR_INVALID_SIZE;
+            return false;
+        }
+        containers[depth++] = c;
+        state = c == '{' ? KEY_OR_END : VALUE_OR_END;
+        ok = c == '{' ? handler->beginObject() : handler->beginArray();
+        break;
+    case '"':
+        state = STRING;
+        in_key = false;
+        token.clear();
+        break;
+    case 't':
+        literal = "true";
+        break;
+    case 'f':
+        literal = "false";
+        break;
+    case 'n':
+        literal = "null";
+        break;
+    default:
+        if (c != '-' && (c < '0' || c > '9'))
+        {
+            return false;
+        }
+        state = NUMBER;
+        token.assign(1, c);
+        break;
+    }
+    if (c == 't' || c == 'f' || c == 'n')
+    {
+        state = LITERAL;
+        literal_pos = 1;
+    }
+    if (!ok)
+    {
+        err = ESP_FAIL;
+    }
+    return ok;
+}
+
+bool JsonParser::endContainer(char c)
+{
+    char open = c == '}' ? '{' : '[';
+    if ((c != '}' && c != ']') || depth == 0 || containers[depth - 1] != open)
+    {
+        return false;
+    }
+    depth--;
+    if (!(c == '}' ? handler->endObject() : handler->endArray()))
+    {
+        err = ESP_FAIL;
+        return false;
+    }
+    return valueDone();
+}
+
+bool JsonParser::valueDone(void)
+{
+    state = depth == 0 ? DONE : COMMA_OR_END;
+    return true;
+}
+
+bool JsonParser::stringChar(char c)
+{
+    // A high surrogate has to be followed by the \u of its low half
+    if (high_surrogate != 0 && ((escape == 0 && c != '\\') || (escape == 1 && c != 'u')))
+    {
+        return false;
+    }
+
+    if (escape == 1)
+    {
+        escape = 0;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            token += c;
+            break;
+        case 'b':
+            token += '\b';
+            break;
+        case 'f':
+            token += '\f';
+            break;
+        case 'n':
+            token += '\n';
+            break;
+        case 'r':
+            token += '\r';
+            break;
+        case 't':
+            token += '\t';
+            break;
+        case 'u':
+            escape = 2;
+            code = 0;
+            break;
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    if (escape >= 2)
+    {
+        int digit = hex_value(c);
+        if (digit < 0)
+        {
+            return false;
+        }
+        code = code * 16 + digit;
+        if (++escape < 6)
+        {
+            return true;
+        }
+        escape = 0;
+        if (high_surrogate != 0)
+        {
+            if (code < 0xdc00 || code > 0xdfff)
+            {
+                return false;
+            }
+            appendUtf8(0x10000 + ((high_surrogate & 0x3ff) << 10) + (code & 0x3ff));
+            high_surrogate = 0;
+        }
+        else if (code >= 0xd800 && code <= 0xdbff)
+        {
+            high_surrogate = code;
+        }
+        else
+        {
+            appendUtf8(code);
+        }
+        return true;
+    }
+
+    if (c == '\\')
+    {
+        escape = 1;
+        return true;
+    }
+    if (c != '"')
+    {
+        token += c;
+        return true;
+    }
+
+    bool ok;
+    if (in_key)
+    {
+        ok = handler->key(token.data(), token.size());
+        state = COLON;
+    }
+    else
+    {
+        ok = handler->string(token.data(), token.size());
+        valueDone();
+    }
+    if (!ok)
+    {
+        err = ESP_FAIL;
+    }
+    return ok;
+}
+
+void JsonParser::appendUtf8(uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        token += (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        token += (char)(0xc0 | (cp >> 6));
+        token += (char)(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        token += (char)(0xe0 | (cp >> 12));
+        token += (char)(0x80 | ((cp >> 6) & 0x3f));
+        token += (char)(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        token += (char)(0xf0 | (cp >> 18));
+        token += (char)(0x80 | ((cp >> 12) & 0x3f));
+        token += (char)(0x80 | ((cp >> 6) & 0x3f));
+        token += (char)(0x80 | (cp & 0x3f));
+    }
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool JsonParser::endNumber(void)
+{
+    const char* p = token.c_str();
+    bool negative = *p == '-';
+    bool integral = true;
+    if (negative)
+    {
+        p++;
+    }
+    if (*p == '0')
+    {
+        p++;
+    }
+    else if (*p >= '1' && *p <= '9')
+    {
+        while (*p >= '0' && *p <= '9')
+        {
+            p++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    if (*p == '.')
+    {
+        integral = false;
+        if (*++p < '0' || *p > '9')
+        {
+            return false;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            p++;
+        }
+    }
+    if (*p == 'e' || *p == 'E')
+    {
+        integral = false;
+        p++;
+        if (*p == '+' || *p == '-')
+        {
+            p++;
+        }
+        if (*p < '0' || *p > '9')
+        {
+            return false;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            p++;
+        }
+    }
+    if (*p != '\0')
+    {
+        return false;
+    }
+
+    bool ok;
+    uint64_t magnitude = 0;
+    bool overflow = false;
+    if (integral)
+    {
+        for (p = token.c_str() + negative; *p != '\0'; p++)
+        {
+            uint32_t digit = *p - '0';
+            if (magnitude > (UINT64_MAX - digit) / 10)
+            {
+                overflow = true;
+                break;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+    }
+    if (!integral || overflow || (negative && magnitude > (uint64_t)INT64_MAX + 1))
+    {
+        ok = handler->real(strtod(token.c_str(), NULL));
+    }
+    else if (negative)
+    {
+        ok = handler->integer(magnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)magnitude);
+    }
+    else if (magnitude <= (uint64_t)INT64_MAX)
+    {
+        ok = handler->integer((int64_t)magnitude);
+    }
+    else
+    {
+        ok = handler->uinteger(magnitude);
+    }
+    if (!ok)
+    {
+        err = ESP_FAIL;
+        return false;
+    }
+    return valueDone();
+}
+
+
+JsonValueBuilder::JsonValueBuilder(child_callback_t on_child)
+    : on_child(on_child), index(0)
+{
+}
+
+bool JsonValueBuilder::add(Json::Value&& value)
+{
+    if (stack.empty())
+    {
+        root = std::move(value);
+        return true;
+    }
+    frame_t& top = stack.back();
+    if (on_child && stack.size() == 1)
+    {
+        bool ok = on_child(top.value.isArray() ? std::to_string(index) : pending_key, value);
+        index++;
+        return ok;
+    }
+    if (top.value.isArray())
+    {
+        top.value.append(std::move(value));
+    }
+    else
+    {
+        top.value[pending_key] = std::move(value);
+    }
+    return true;
+}
+
+bool JsonValueBuilder::begin(Json::ValueType type)
+{
+    stack.push_back({Json::Value(type), pending_key});
+    return true;
+}
+
+bool JsonValueBuilder::end(void)
+{
+    frame_t frame = std::move(stack.back());
+    stack.pop_back();
+    pending_key = std::move(frame.key);
+    return add(std::move(frame.value));
+}
+
+bool JsonValueBuilder::null(void)
+{
+    return add(Json::Value());
+}
+
+bool JsonValueBuilder::boolean(bool value)
+{
+    return add(Json::Value(value));
+}
+
+bool JsonValueBuilder::integer(int64_t value)
+{
+    return add(Json::Value((Json::Int64)value));
+}
+
+bool JsonValueBuilder::uinteger(uint64_t value)
+{
+    return add(Json::Value((Json::UInt64)value));
+}
+
+bool JsonValueBuilder::real(double value)
+{
+    return add(Json::Value(value));
+}
+
+bool JsonValueBuilder::string(const char* data, size_t len)
+{
+    return add(Json::Value(data, data + len));
+}
+
+bool JsonValueBuilder::key(const char* data, size_t len)
+{
+    pending_key.assign(data, len);
+    return true;
+}
+
+bool JsonValueBuilder::beginObject(void)
+{
+    return begin(Json::objectValue);
+}
+
+bool JsonValueBuilder::endObject(void)
+{
+    return end();
+}
+
+bool JsonValueBuilder::beginArray(void)
+{
+    return begin(Json::arrayValue);
+}
+
+bool JsonValueBuilder::endArray(void)
+{
+    return end();
+}
+
+Json::Value JsonValueBuilder::release(void)
+{
+    return std::move(root);
+}
+
+
+}
@@ -0,0 +1,167 @@
+#ifndef _ESP_FIREBASE_JSON_PARSER_H_
+#define  _ESP_FIREBASE_JSON_PARSER_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "esp_err.h"
+
+#include "jsoncpp/value.h"
+
+#define JSON_PARSER_MAX_DEPTH 64    // Objects and arrays open at once
+
+namespace ESPFirebase
+{
+
+    /**
+     * @brief Receives what JsonParser reads, in document order. Returning false stops the parse.
+     *
+     * String and key data is only valid during the call.
+     */
+    class JsonHandler
+    {
+    public:
+        virtual ~JsonHandler() = default;
+        virtual bool null(void) { return true; }
+        virtual bool boolean(bool value) { return true; }
+        virtual bool integer(int64_t value) { return true; }
+        virtual bool uinteger(uint64_t value) { return true; }
+        virtual bool real(double value) { return true; }
+        virtual bool string(const char* data, size_t len) { return true; }
+        virtual bool key(const char* data, size_t len) { return true; }
+        virtual bool beginObject(void) { return true; }
+        virtual bool endObject(void) { return true; }
+        virtual bool beginArray(void) { return true; }
+        virtual bool endArray(void) { return true; }
+    };
+
+    /**
+     * @brief JSON read in pieces as they arrive, e.g. HTTP response chunks
+     *
+     * Holds no more of the text than the string or number being read, so the memory used
+     * depends on the handler, not on the size of the document. Numbers are typed as
+     * Json::Reader types them: integers that fit int64_t, then uint64_t, else doubles.
+     */
+    class JsonParser
+    {
+    private:
+        enum state_t : uint8_t
+        {
+            VALUE,
+            VALUE_OR_END,       // After '['
+            KEY_OR_END,         // After '{'
+            KEY,
+            COLON,
+            COMMA_OR_END,
+            STRING,
+            NUMBER,
+            LITERAL,
+            DONE,
+        };
+
+        JsonHandler* handler;
+        state_t state;
+        bool in_key;
+        uint8_t escape;             // 1 after a backslash, 2..5 reading the hex digits of \u
+        uint8_t literal_pos;
+        const char* literal;        // "true", "false" or "null" being matched
+        uint32_t code;
+        uint32_t high_surrogate;
+        int depth;
+        char containers[JSON_PARSER_MAX_DEPTH];
+        std::string token;          // String or number split across chunks
+        size_t consumed;
+        esp_err_t err;
+
+        bool step(char c);
+        bool beginValue(char c);
+        bool endContainer(char c);
+        bool valueDone(void);
+        bool stringChar(char c);
+        bool endNumber(void);
+        void appendUtf8(uint32_t cp);
+
+    public:
+        explicit JsonParser(JsonHandler* handler);
+
+        /**
+         * @brief Forget the document read so far, to parse a new one
+         */
+        void reset(void);
+
+        /**
+         * @brief Parse the next piece of the document
+         *
+         * @return ESP_OK, ESP_ERR_INVALID_RESPONSE if the text is not JSON, ESP_ERR_INVALID_SIZE if it
+         * nests deeper than JSON_PARSER_MAX_DEPTH, ESP_FAIL if the handler stopped the parse.
+         * Errors are sticky: later pieces are ignored.
+         */
+        esp_err_t feed(const char* data, size_t len);
+
+        /**
+         * @brief End of input
+         *
+         * @return ESP_OK if exactly one complete document was read, else as feed()
+         */
+        esp_err_t finish(void);
+
+        /**
+         * @brief Bytes read, up to the error if there was one
+         */
+        size_t offset(void) const;
+    };
+
+    /**
+     * @brief Builds the Json::Value of a parsed document
+     *
+     * With a child callback, each direct child of the root is handed over as soon as it is complete
+     * and freed afterwards, so only one child is in memory at a time; the root stays empty.
+     * Array children are named by their index.
+     */
+    class JsonValueBuilder : public JsonHandler
+    {
+    public:
+        typedef std::function<bool(const std::string& key, const Json::Value& child)> child_callback_t;
+
+    private:
+        struct frame_t
+        {
+            Json::Value value;
+            std::string key;        // Name of the value in its parent
+        };
+
+        Json::Value root;
+        std::vector<frame_t> stack;
+        std::string pending_key;
+        child_callback_t on_child;
+        Json::ArrayIndex index;
+
+        bool add(Json::Value&& value);
+        bool begin(Json::ValueType type);
+        bool end(void);
+
+    public:
+        explicit JsonValueBuilder(child_callback_t on_child = nullptr);
+
+        bool null(void) override;
+        bool boolean(bool value) override;
+        bool integer(int64_t value) override;
+        bool uinteger(uint64_t value) override;
+        bool real(double value) override;
+        bool string(const char* data, size_t len) override;
+        bool key(const char* data, size_t len) override;
+        bool beginObject(void) override;
+        bool endObject(void) override;
+        bool beginArray(void) override;
+        bool endArray(void) override;
+
+        /**
+         * @brief The document, moved out
+         */
+        Json::Value release(void);
+    };
+}
+
+
+#endif
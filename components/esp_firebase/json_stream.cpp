@@ -0,0 +1,204 @@
+#include <string.h>
+#include "json_stream.h"
+
+#include "jsoncpp/json.h"
+
+
+namespace ESPFirebase {
+
+
+JsonStream::JsonStream(sink_t sink, void* ctx)
+    : sink(sink), ctx(ctx), used(0), total(0), err(ESP_OK), precision(Json::Value::defaultRealPrecision),
+      precisionType(Json::PrecisionType::significantDigits), depth(0), first(0)
+{
+}
+
+void JsonStream::setPrecision(unsigned int precision, Json::PrecisionType type)
+{
+    JsonStream::precision = precision;
+    JsonStream::precisionType = type;
+}
+
+void JsonStream::put(char c)
+{
+    if (used == sizeof(buffer))
+    {
+        finish();
+    }
+    buffer[used++] = c;
+    total++;
+}
+
+void JsonStream::raw(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        if (used == sizeof(buffer))
+        {
+            finish();
+        }
+        size_t n = sizeof(buffer) - used;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(buffer + used, data, n);
+        used += n;
+        total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+esp_err_t JsonStream::finish(void)
+{
+    if (used > 0 && sink != NULL && err == ESP_OK)
+    {
+        err = sink(ctx, buffer, used);
+    }
+    used = 0;
+    return err;
+}
+
+size_t JsonStream::length(void) const
+{
+    return total;
+}
+
+void JsonStream::writeQuoted(const char* str, size_t len)
+{
+    // Plain ASCII goes through as is; anything to escape, embedded NULs included, takes the jsoncpp quoting,
+    // so the text stays FastWriter's
+    const char* end = str + len;
+    const char* c = str;
+    while (c != end && *c != '"' && *c != '\\' && (unsigned char)*c >= 0x20 && (unsigned char)*c <= 0x7f)
+    {
+        c++;
+    }
+    if (c == end)
+    {
+        put('"');
+        raw(str, len);
+        put('"');
+    }
+    else
+    {
+        Json::String quoted = Json::valueToQuotedString(str, len);
+        raw(quoted.data(), quoted.size());
+    }
+}
+
+void JsonStream::writeValue(const Json::Value& value)
+{
+    Json::String text;
+
+    switch (value.type())
+    {
+    case Json::nullValue:
+        raw("null", 4);
+        break;
+    case Json::intValue:
+        text = Json::valueToString(value.asLargestInt());
+        raw(text.data(), text.size());
+        break;
+    case Json::uintValue:
+        text = Json::valueToString(value.asLargestUInt());
+        raw(text.data(), text.size());
+        break;
+    case Json::realValue:
+        text = Json::valueToString(value.asDouble(), precision, precisionType);
+        raw(text.data(), text.size());
+        break;
+    case Json::stringValue:
+    {
+        const char* begin;
+        const char* end;
+        if (value.getString(&begin, &end))
+        {
+            writeQuoted(begin, end - begin);
+        }
+        break;
+    }
+    case Json::booleanValue:
+        if (value.asBool())
+        {
+            raw("true", 4);
+        }
+        else
+        {
+            raw("false", 5);
+        }
+        break;
+    case Json::arrayValue:
+        put('[');
+        for (Json::ArrayIndex i = 0; i < value.size(); i++)
+        {
+            if (i > 0)
+            {
+                put(',');
+            }
+            writeValue(value[i]);
+        }
+        put(']');
+        break;
+    case Json::objectValue:
+        // Iterating the members in place: FastWriter copies all of their names first
+        put('{');
+        for (Json::Value::const_iterator it = value.begin(); it != value.end(); ++it)
+        {
+            if (it != value.begin())
+            {
+                put(',');
+            }
+            const char* end;
+            const char* name = it.memberName(&end);
+            writeQuoted(name, end - name);
+            put(':');
+            writeValue(*it);
+        }
+        put('}');
+        break;
+    }
+}
+
+void JsonStream::value(const Json::Value& value)
+{
+    writeValue(value);
+}
+
+void JsonStream::beginObject(void)
+{
+    put('{');
+    if (depth < JSON_STREAM_MAX_DEPTH)
+    {
+        first |= 1u << depth;
+    }
+    depth++;
+}
+
+void JsonStream::key(const char* name)
+{
+    uint32_t bit = depth > 0 && depth <= JSON_STREAM_MAX_DEPTH ? 1u << (depth - 1) : 0;
+    if (first & bit)
+    {
+        first &= ~bit;
+    }
+    else
+    {
+        put(',');
+    }
+    writeQuoted(name, strlen(name));
+    put(':');
+}
+
+void JsonStream::endObject(void)
+{
+    put('}');
+    if (depth > 0)
+    {
+        depth--;
+    }
+}
+
+
+}
@@ -0,0 +1,96 @@
+#ifndef _ESP_FIREBASE_JSON_STREAM_H_
+#define  _ESP_FIREBASE_JSON_STREAM_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include "esp_err.h"
+
+#include "jsoncpp/value.h"
+
+#define JSON_STREAM_CHUNK 512   // Bytes handed to the sink at once
+#define JSON_STREAM_MAX_DEPTH 32 // Objects opened with beginObject() at once
+
+namespace ESPFirebase
+{
+
+    /**
+     * @brief Compact JSON written in pieces through a fixed buffer, the same text as Json::FastWriter
+     * without its trailing newline
+     *
+     * Nothing proportional to the document is allocated. Without a sink the stream only counts
+     * the bytes, which gives the Content-Length of a body before it is sent.
+     */
+    class JsonStream
+    {
+    public:
+        typedef esp_err_t (*sink_t)(void* ctx, const char* data, size_t len);
+
+    private:
+        sink_t sink;
+        void* ctx;
+        char buffer[JSON_STREAM_CHUNK];
+        size_t used;
+        size_t total;
+        esp_err_t err;
+        unsigned int precision;
+        Json::PrecisionType precisionType;
+        int depth;
+        uint32_t first;     // Bit per open object: no member written yet
+
+        void put(char c);
+        void writeQuoted(const char* str, size_t len);
+        void writeValue(const Json::Value& value);
+
+    public:
+        explicit JsonStream(sink_t sink = NULL, void* ctx = NULL);
+
+        /**
+         * @brief How real values are written, as the "precision" and "precisionType" settings of
+         * Json::StreamWriterBuilder. The default is FastWriter's: the shortest digits that read back as
+         * the same double. Json::PrecisionType::shortestFloat writes values that came from a float,
+         * such as sensor readings, with the digits of that float: 12.34 instead of 12.34000015258789.
+         */
+        void setPrecision(unsigned int precision, Json::PrecisionType type = Json::PrecisionType::significantDigits);
+
+        /**
+         * @brief Write a whole value
+         */
+        void value(const Json::Value& value);
+
+        /**
+         * @brief Build an object member by member, so a body does not have to exist as one Json::Value
+         *
+         * key() is followed by exactly one value() or nested beginObject()/endObject().
+         */
+        void beginObject(void);
+        void key(const char* name);
+        void endObject(void);
+
+        /**
+         * @brief Text that is already JSON
+         */
+        void raw(const char* data, size_t len);
+
+        /**
+         * @brief Hand what is buffered to the sink
+         *
+         * @return ESP_OK, or the first error the sink returned; the sink is not called after an error
+         */
+        esp_err_t finish(void);
+
+        /**
+         * @brief Bytes written so far, sent or not
+         */
+        size_t length(void) const;
+    };
+
+    /**
+     * @brief Request body produced on demand. It may be called several times per request: to count
+     * its bytes for Content-Length, to send them and again on a retry, so every call has to write
+     * exactly the same bytes.
+     */
+    typedef std::function<void(JsonStream&)> json_body_t;
+}
+
+
+#endif
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string.h>
 #include "esp_log.h"
 
 #include "rtdb.h"
@@ -12,176 +13,193 @@ namespace ESPFirebase {
 
 
 RTDB::RTDB(FirebaseApp* app, const char * database_url)
-    : app(app), base_database_url(database_url)
+    : app(app), base_database_url(database_url), precision(Json::Value::defaultRealPrecision),
+      precisionType(Json::PrecisionType::significantDigits)
 
 {
     
 }
-Json::Value RTDB::getData(const char* path)
-{
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
 
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
+void RTDB::setPrecision(unsigned int precision, Json::PrecisionType type)
+{
+    RTDB::precision = precision;
+    RTDB::precisionType = type;
+}
+static const char* method_name(esp_http_client_method_t method)
+{
+    switch (method)
     {
-        const char* begin = this->app->local_response_buffer;
-        const char* end = begin + strlen(this->app->local_response_buffer);
-
-        Json::Reader reader;
-        Json::Value data;
+    case HTTP_METHOD_PUT:
+        return "PUT";
+    case HTTP_METHOD_POST:
+        return "POST";
+    case HTTP_METHOD_PATCH:
+        return "PATCH";
+    default:
+        return "Request";
+    }
+}
 
-        reader.parse(begin, end, data, false);
+// Caller holds the app lock. A 401 means the ID token expired before the background
+// refresh ran: refresh it and retry once.
+http_ret_t RTDB::request(const char* path, esp_http_client_method_t method, const json_body_t& body, const char* query,
+                         JsonParser* response)
+{
+    http_ret_t http_ret = {ESP_FAIL, 0};
+    // The body may still choose its own precision
+    json_body_t written = [this, &body](JsonStream& stream)
+    {
+        stream.setPrecision(RTDB::precision, RTDB::precisionType);
+        body(stream);
+    };
 
-        ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
-        this->app->clearHTTPBuffer();
-        return data;
-    }
-    else
-    {   
-        ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
-        ESP_LOGI(RTDB_TAG, "Token expired ? Trying refreshing auth");
-        esp_err_t err = this->app->loginUserAccount(this->app->user_account);
-        if (err == ESP_OK)
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        std::string url = RTDB::base_database_url;
+        url += path;
+        url += ".json?";
+        url += query;
+        url += "auth=" + this->app->auth_token;
+
+        this->app->setHeader("content-type", "application/json");
+        http_ret = this->app->performRequest(url.c_str(), method, written, response);
+        if (http_ret.err != ESP_OK || http_ret.status_code != 401 || attempt > 0)
         {
-            this->app->setHeader("content-type", "application/json");
-            http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
-            if (http_ret.err == ESP_OK && http_ret.status_code == 200)
-            {
-                const char* begin = this->app->local_response_buffer;
-                const char* end = begin + strlen(this->app->local_response_buffer);
-
-                Json::Reader reader;
-                Json::Value data;
-
-                reader.parse(begin, end, data, false);
-
-                ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
-                this->app->clearHTTPBuffer();
-                return data;
-            }
-            else
-            {
-                ESP_LOGE(RTDB_TAG, "Failed to get data after refreshing token. double check account credentials or database rules");
-                this->app->clearHTTPBuffer();
-                return Json::Value();
-            }
+            break;
         }
-        else
+        this->app->clearHTTPBuffer();
+        ESP_LOGI(RTDB_TAG, "Token expired, refreshing auth");
+        if (this->app->refreshAuthToken() != ESP_OK)
         {
-            ESP_LOGE(RTDB_TAG, "Failed to refresh auth token");
-            this->app->clearHTTPBuffer();
-            return Json::Value();
+            break;
         }
     }
+    return http_ret;
 }
 
-esp_err_t RTDB::putData(const char* path, const char* json_str)
+http_ret_t RTDB::request(const char* path, esp_http_client_method_t method, const char* json_str, const char* query,
+                         JsonParser* response)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-
-    //std::string auth = "key=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    //this->app->setHeader("Authorization", auth.c_str());
-    //this->app->setHeader("auth-token", this->app->auth_token.c_str());
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PUT, json_str);
+    size_t len = strlen(json_str);
+    return RTDB::request(path, method, [json_str, len](JsonStream& stream) { stream.raw(json_str, len); }, query,
+                         response);
+}
+
+// print=silent answers 204 No Content
+esp_err_t RTDB::write(const char* path, esp_http_client_method_t method, const json_body_t& body, const char* query)
+{
+    FirebaseLock lock(this->app);
+
+    http_ret_t http_ret = RTDB::request(path, method, body, query);
     this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200)
+    if (http_ret.err == ESP_OK && (http_ret.status_code == 200 || http_ret.status_code == 204))
     {
-        ESP_LOGI(RTDB_TAG, "PUT successful");
+        ESP_LOGI(RTDB_TAG, "%s successful", method_name(method));
         return ESP_OK;
     }
     else
     {
-        ESP_LOGE(RTDB_TAG, "PUT failed");
+        ESP_LOGE(RTDB_TAG, "%s failed", method_name(method));
         return ESP_FAIL;
     }
 }
 
-esp_err_t RTDB::putData(const char* path, const Json::Value& data)
+Json::Value RTDB::getData(const char* path)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::putData(path, json_str.c_str());
-    return err;
+    FirebaseLock lock(this->app);
 
-}
-
-esp_err_t RTDB::postData(const char* path, const char* json_str)
-{
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_POST, json_str);
+    JsonValueBuilder builder;
+    JsonParser parser(&builder);
+    http_ret_t http_ret = RTDB::request(path, HTTP_METHOD_GET, "", "", &parser);
     this->app->clearHTTPBuffer();
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        ESP_LOGI(RTDB_TAG, "POST successful");
-        return ESP_OK;
+        ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
+        return builder.release();
     }
     else
-    {
-        ESP_LOGE(RTDB_TAG, "POST failed");
-        return ESP_FAIL;
-        
+    {   
+        ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
+        return Json::Value();
     }
 }
 
-esp_err_t RTDB::postData(const char* path, const Json::Value& data)
+esp_err_t RTDB::getChildren(const char* path, const JsonValueBuilder::child_callback_t& on_child)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::postData(path, json_str.c_str());
-    return err;
+    FirebaseLock lock(this->app);
 
-}
-esp_err_t RTDB::patchData(const char* path, const char* json_str)
-{
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PATCH, json_str);
+    JsonValueBuilder builder(on_child);
+    JsonParser parser(&builder);
+    http_ret_t http_ret = RTDB::request(path, HTTP_METHOD_GET, "", "", &parser);
     this->app->clearHTTPBuffer();
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        ESP_LOGI(RTDB_TAG, "PATCH successful");
+        ESP_LOGI(RTDB_TAG, "Children of path=%s read", path);
         return ESP_OK;
     }
     else
     {
-        ESP_LOGE(RTDB_TAG, "PATCH failed");
+        ESP_LOGE(RTDB_TAG, "Error while reading children at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
         return ESP_FAIL;
-        
     }
 }
 
+esp_err_t RTDB::putData(const char* path, const char* json_str)
+{
+    size_t len = strlen(json_str);
+    return RTDB::write(path, HTTP_METHOD_PUT, [json_str, len](JsonStream& stream) { stream.raw(json_str, len); });
+}
+
+// Json::Value bodies are serialized into the connection as they are sent, never as a whole string
+esp_err_t RTDB::putData(const char* path, const Json::Value& data)
+{
+    return RTDB::write(path, HTTP_METHOD_PUT, [&data](JsonStream& stream) { stream.value(data); });
+}
+
+esp_err_t RTDB::postData(const char* path, const char* json_str)
+{
+    size_t len = strlen(json_str);
+    return RTDB::write(path, HTTP_METHOD_POST, [json_str, len](JsonStream& stream) { stream.raw(json_str, len); });
+}
+
+esp_err_t RTDB::postData(const char* path, const Json::Value& data)
+{
+    return RTDB::write(path, HTTP_METHOD_POST, [&data](JsonStream& stream) { stream.value(data); });
+}
+
+esp_err_t RTDB::patchData(const char* path, const char* json_str)
+{
+    size_t len = strlen(json_str);
+    return RTDB::write(path, HTTP_METHOD_PATCH, [json_str, len](JsonStream& stream) { stream.raw(json_str, len); });
+}
+
 esp_err_t RTDB::patchData(const char* path, const Json::Value& data)
 {
-    Json::FastWriter writer;
-    std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::patchData(path, json_str.c_str());
-    return err;
+    return RTDB::write(path, HTTP_METHOD_PATCH, [&data](JsonStream& stream) { stream.value(data); });
+}
+
+esp_err_t RTDB::patchDataSilent(const char* path, const char* json_str)
+{
+    size_t len = strlen(json_str);
+    return RTDB::write(path, HTTP_METHOD_PATCH, [json_str, len](JsonStream& stream) { stream.raw(json_str, len); },
+                       "print=silent&");
 }
 
+esp_err_t RTDB::patchDataSilent(const char* path, const Json::Value& data)
+{
+    return RTDB::write(path, HTTP_METHOD_PATCH, [&data](JsonStream& stream) { stream.value(data); }, "print=silent&");
+}
+
+esp_err_t RTDB::patchDataSilent(const char* path, const json_body_t& body)
+{
+    return RTDB::write(path, HTTP_METHOD_PATCH, body, "print=silent&");
+}
 
 esp_err_t RTDB::deleteData(const char* path)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_DELETE, "");
+    FirebaseLock lock(this->app);
+
+    http_ret_t http_ret = RTDB::request(path, HTTP_METHOD_DELETE, "");
     this->app->clearHTTPBuffer();
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
@@ -1,6 +1,8 @@
 #ifndef _ESP_FIREBASE_RTDB_H_
 #define  _ESP_FIREBASE_RTDB_H_
 #include "app.h"
+#include "json_parser.h"
+#include "json_stream.h"
 
 
 #include "jsoncpp/value.h"
@@ -16,12 +18,36 @@ namespace ESPFirebase
     private:
         FirebaseApp* app;
         std::string base_database_url;
+        unsigned int precision;
+        Json::PrecisionType precisionType;
+
+        http_ret_t request(const char* path, esp_http_client_method_t method, const json_body_t& body, const char* query = "",
+                           JsonParser* response = NULL);
+        http_ret_t request(const char* path, esp_http_client_method_t method, const char* json_str, const char* query = "",
+                           JsonParser* response = NULL);
+        esp_err_t write(const char* path, esp_http_client_method_t method, const json_body_t& body, const char* query = "");
 
 
     public:
                 
+        /**
+         * @brief Read a node. The response is parsed as it arrives, so its size is only bounded by
+         * the memory of the resulting Json::Value.
+         *
+         * @return The node, null if it does not exist or on error
+         */
         Json::Value getData(const char* path);
 
+        /**
+         * @brief Read a node child by child: each direct child is parsed, handed to on_child and freed
+         * before the next one, so a large history node takes the memory of one child at a time
+         *
+         * @param on_child Called with the key and value of each child, in the order the server sends
+         * them; returning false stops the read
+         * @return ESP_OK, ESP_FAIL if the request failed or on_child stopped it
+         */
+        esp_err_t getChildren(const char* path, const JsonValueBuilder::child_callback_t& on_child);
+
         esp_err_t putData(const char* path, const char* json_str);
         esp_err_t putData(const char* path, const Json::Value& data);
 
@@ -30,8 +56,27 @@ namespace ESPFirebase
 
         esp_err_t patchData(const char* path, const char* json_str);
         esp_err_t patchData(const char* path, const Json::Value& data);
+
+        /**
+         * @brief PATCH with print=silent: the server answers 204 without echoing the data back,
+         * which keeps large multi-location updates out of the response buffer.
+         */
+        esp_err_t patchDataSilent(const char* path, const char* json_str);
+        esp_err_t patchDataSilent(const char* path, const Json::Value& data);
+        /**
+         * @brief Silent PATCH of a body written piece by piece, e.g. a batch kept in another form
+         * than a Json::Value. See json_body_t.
+         */
+        esp_err_t patchDataSilent(const char* path, const json_body_t& body);
         
         esp_err_t deleteData(const char* path);
+
+        /**
+         * @brief How real values of the Json::Value and json_body_t bodies are written, see
+         * JsonStream::setPrecision(). With (2, Json::PrecisionType::decimalPlaces) an angle goes
+         * out as 12.34, rounded without snprintf. Text bodies are sent as they are.
+         */
+        void setPrecision(unsigned int precision, Json::PrecisionType type = Json::PrecisionType::significantDigits);
         RTDB(FirebaseApp* app, const char* database_url);
     };
 
@@ -0,0 +1,153 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "rtdb_batch.h"
+
+#include "jsoncpp/json.h"
+#define RTDB_BATCH_TAG "RTDBBatch"
+#define RTDB_BATCH_QUEUE_FACTOR 4   // Queued samples kept through failed flushes, in batches
+#define RTDB_BATCH_ARENA_BLOCK 4096 // Bytes per arena block, some ten samples of a few sensors
+
+
+namespace ESPFirebase {
+
+
+RTDBBatch::RTDBBatch(RTDB* db, const char* path, size_t max_samples, uint32_t max_age_ms)
+    : db(db), path(path), max_samples(max_samples > 0 ? max_samples : 1),
+      max_age_us((int64_t)max_age_ms * 1000), arena(RTDB_BATCH_ARENA_BLOCK), arena_garbage(0),
+      first_queued_us(0), retrying(false), stats()
+{
+    max_queued = RTDB_BATCH_QUEUE_FACTOR * this->max_samples;
+    resetQueue();
+}
+
+RTDBBatch::~RTDBBatch()
+{
+    if (!queued.empty())
+    {
+        flush();
+    }
+    queued.abandonArena();
+}
+
+// Everything queued was allocated in the arena: dropped in one go
+void RTDBBatch::resetQueue(void)
+{
+    queued.abandonArena();
+    arena.reset();
+    arena_garbage = 0;
+    Json::ArenaScope scope(arena);
+    queued = Json::Value(Json::objectValue);
+}
+
+// Samples dropped while flushes fail stay in the arena until it is reset: once they add up
+// to a batch, the queue is moved out and back in so the arena only holds live samples
+void RTDBBatch::compactQueue(void)
+{
+    Json::Value live = queued;
+    resetQueue();
+    Json::ArenaScope scope(arena);
+    queued = live;
+}
+
+esp_err_t RTDBBatch::add(int64_t timestamp_ms, const Json::Value& sample)
+{
+    if (queued.empty())
+    {
+        first_queued_us = esp_timer_get_time();
+    }
+
+    {
+        Json::ArenaScope scope(arena);
+        Json::Value& slot = queued[sampleKey(timestamp_ms)];
+        if (!slot.isNull())
+        {
+            arena_garbage++;
+        }
+        slot = sample;
+
+        while (queued.size() > max_queued)
+        {
+            queued.removeMember(queued.begin().name());
+            stats.samples_dropped++;
+            arena_garbage++;
+        }
+    }
+    if (arena_garbage >= max_samples)
+    {
+        compactQueue();
+    }
+
+    // After a failure only poll() retries, once max_age_ms has passed, so a dead link
+    // costs one request timeout per period rather than one per sample
+    if (queued.size() >= max_samples && !retrying)
+    {
+        return flush();
+    }
+    return ESP_OK;
+}
+
+esp_err_t RTDBBatch::poll(void)
+{
+    if (!queued.empty() && esp_timer_get_time() - first_queued_us >= max_age_us)
+    {
+        return flush();
+    }
+    return ESP_OK;
+}
+
+esp_err_t RTDBBatch::flush(void)
+{
+    if (queued.empty())
+    {
+        return ESP_OK;
+    }
+
+    size_t count = queued.size();
+
+    stats.requests++;
+    esp_err_t err = db->patchDataSilent(path.c_str(), queued);
+    if (err != ESP_OK)
+    {
+        // Kept for the next flush; the age timer restarts to space out the retries
+        stats.failures++;
+        retrying = true;
+        first_queued_us = esp_timer_get_time();
+        ESP_LOGW(RTDB_BATCH_TAG, "Batch of %u samples failed, kept for retry", (unsigned)count);
+        return err;
+    }
+
+    stats.samples_sent += count;
+    retrying = false;
+    resetQueue();
+    ESP_LOGD(RTDB_BATCH_TAG, "Batch of %u samples written to %s", (unsigned)count, path.c_str());
+    return ESP_OK;
+}
+
+size_t RTDBBatch::pending(void) const
+{
+    return queued.size();
+}
+
+rtdb_batch_stats_t RTDBBatch::getStats(void) const
+{
+    return stats;
+}
+
+bool RTDBBatch::isRetrying(void) const
+{
+    return retrying;
+}
+
+std::string RTDBBatch::sampleKey(int64_t timestamp_ms)
+{
+    // Fixed width keys: the database and Json::Value both order them by time
+    char key[21];
+    snprintf(key, sizeof(key), "%013" PRId64, timestamp_ms);
+    return key;
+}
+
+
+}
@@ -0,0 +1,94 @@
+#ifndef _ESP_FIREBASE_RTDB_BATCH_H_
+#define  _ESP_FIREBASE_RTDB_BATCH_H_
+#include <stdint.h>
+#include <string>
+#include "rtdb.h"
+
+#include "jsoncpp/value.h"
+
+namespace ESPFirebase 
+{
+
+    struct rtdb_batch_stats_t
+    {
+        uint32_t requests;      // PATCH requests sent, successful or not
+        uint32_t failures;      // Failed requests; their samples stay queued for the next flush
+        uint32_t samples_sent;
+        uint32_t samples_dropped; // Oldest samples discarded while the database was unreachable
+    };
+
+    /**
+     * @brief Collects time-series samples and writes them in one multi-location PATCH
+     *
+     * Every sample becomes the child <path>/<timestamp_ms>, so history accumulates
+     * instead of being overwritten. A flush happens when max_samples are queued, when
+     * the oldest queued sample is max_age_ms old (checked by poll()) and on destruction.
+     * Samples of a failed flush stay queued, up to four batches, and are retried by poll().
+     * The queue is built in its own Json::Arena: a batch costs a few block allocations
+     * instead of several per sample, all returned together after the flush.
+     */
+    class RTDBBatch
+    {
+    private:
+        RTDB* db;
+        std::string path;
+        size_t max_samples;
+        int64_t max_age_us;
+        size_t max_queued;          // Bound on what failed flushes may leave behind
+        Json::Arena arena;          // Holds queued, released at once after each flush
+        size_t arena_garbage;       // Samples dropped or replaced since the arena was last reset
+        Json::Value queued;         // timestamp_ms key -> sample, ordered by key
+        int64_t first_queued_us;    // esp_timer time at which the oldest queued sample was added
+        bool retrying;              // Last flush failed, wait for poll() instead of flushing on size
+        rtdb_batch_stats_t stats;
+
+        void resetQueue(void);
+        void compactQueue(void);
+
+    public:
+        /**
+         * @param db Database the batches are written to
+         * @param path Parent of the sample children, e.g. "/accel/<device>"
+         * @param max_samples Samples per request
+         * @param max_age_ms Longest a sample waits before it is flushed
+         */
+        RTDBBatch(RTDB* db, const char* path, size_t max_samples, uint32_t max_age_ms);
+        ~RTDBBatch();
+
+        /**
+         * @brief Queue a sample; flushes if max_samples are queued
+         * 
+         * @param timestamp_ms Wall clock time of the sample, its key in the database
+         * @param sample Sample data
+         * @return Result of the flush, or ESP_OK if none was needed
+         */
+        esp_err_t add(int64_t timestamp_ms, const Json::Value& sample);
+
+        /**
+         * @brief Flush if the oldest queued sample reached max_age_ms; call periodically
+         */
+        esp_err_t poll(void);
+
+        /**
+         * @brief Write every queued sample now
+         */
+        esp_err_t flush(void);
+
+        size_t pending(void) const;
+        rtdb_batch_stats_t getStats(void) const;
+
+        /**
+         * @brief True from a failed flush until a flush succeeds
+         */
+        bool isRetrying(void) const;
+
+        /**
+         * @brief Child name of a sample: fixed width, so the database orders keys by time
+         */
+        static std::string sampleKey(int64_t timestamp_ms);
+    };
+
+}
+
+
+#endif
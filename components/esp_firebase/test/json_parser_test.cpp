@@ -0,0 +1,122 @@
+#include <string>
+#include <string.h>
+#include "unity.h"
+#include "esp_firebase/json_parser.h"
+
+#include "jsoncpp/json.h"
+
+using namespace ESPFirebase;
+
+static const char* DOCUMENT =
+    "{\"accel\": {\"0001700000000000\": {\"sensor1\": {\"roll\": 12.5, \"pitch\": -3.25e-2}},"
+    " \"0001700000000100\": {\"sensor1\": {\"roll\": -0.0, \"pitch\": 1E3}}},"
+    " \"flags\": [true, false, null, [], {}],"
+    " \"ints\": [0, -1, 9223372036854775807, -9223372036854775808, 18446744073709551615, 18446744073709551616],"
+    " \"text\": \"quote\\\" slash\\/ tab\\t \\u00e9 \\u20ac \\ud83d\\ude00 raw \xc3\xa9\","
+    " \"\\u006bey\": \"\"}";
+
+static std::string fast_write(const Json::Value& value)
+{
+    Json::FastWriter writer;
+    return writer.write(value);
+}
+
+static std::string reader_text(const char* text)
+{
+    Json::Reader reader;
+    Json::Value value;
+    TEST_ASSERT_TRUE(reader.parse(text, text + strlen(text), value, false));
+    return fast_write(value);
+}
+
+/* Fed in pieces of piece bytes, the last one shorter */
+static esp_err_t parse_pieces(const char* text, size_t piece, Json::Value* value)
+{
+    JsonValueBuilder builder;
+    JsonParser parser(&builder);
+    size_t len = strlen(text);
+    for (size_t i = 0; i < len; i += piece)
+    {
+        parser.feed(text + i, len - i < piece ? len - i : piece);
+    }
+    esp_err_t err = parser.finish();
+    *value = builder.release();
+    return err;
+}
+
+TEST_CASE("JSON parser reads the same values as Json::Reader, however the text is split", "[json_parser]")
+{
+    std::string expected = reader_text(DOCUMENT);
+    for (size_t piece = 1; piece <= strlen(DOCUMENT); piece++)
+    {
+        Json::Value value;
+        TEST_ASSERT_EQUAL(ESP_OK, parse_pieces(DOCUMENT, piece, &value));
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), fast_write(value).c_str());
+    }
+
+    Json::Value value;
+    TEST_ASSERT_EQUAL(ESP_OK, parse_pieces(DOCUMENT, 7, &value));
+    TEST_ASSERT_TRUE(value["ints"][2].isInt64());
+    TEST_ASSERT_TRUE(value["ints"][4].isUInt64());
+    TEST_ASSERT_FALSE(value["ints"][4].isInt64());
+    TEST_ASSERT_TRUE(value["ints"][5].isDouble());
+    TEST_ASSERT_EQUAL_STRING("quote\" slash/ tab\t \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 raw \xc3\xa9",
+                             value["text"].asCString());
+
+    /* A bare scalar is a document too, e.g. a leaf read by getData */
+    TEST_ASSERT_EQUAL(ESP_OK, parse_pieces(" 42 ", 1, &value));
+    TEST_ASSERT_EQUAL(42, value.asInt());
+    TEST_ASSERT_EQUAL(ESP_OK, parse_pieces("null", 2, &value));
+    TEST_ASSERT_TRUE(value.isNull());
+}
+
+TEST_CASE("JSON parser rejects what is not one JSON document", "[json_parser]")
+{
+    const char* invalid[] = {
+        "", "{", "{\"a\":1", "[1,2", "\"open", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "[1,]", "{1:2}",
+        "[}", "{]", "tru", "nul", "truth", "01", "-", "1.", "1e", "+1", ".5", "[1]]", "1 2",
+        "\"\\x\"", "\"\\u12g4\"", "\"\\ud83d\"", "\"\\ud83d\\u0041\"",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        Json::Value value;
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, parse_pieces(invalid[i], 1, &value));
+    }
+
+    std::string deep(JSON_PARSER_MAX_DEPTH + 1, '[');
+    Json::Value value;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, parse_pieces(deep.c_str(), 16, &value));
+}
+
+TEST_CASE("JSON parser hands children over one at a time", "[json_parser]")
+{
+    Json::Value expected;
+    Json::Reader reader;
+    TEST_ASSERT_TRUE(reader.parse(DOCUMENT, DOCUMENT + strlen(DOCUMENT), expected, false));
+    const Json::Value& accel = expected["accel"];
+
+    int children = 0;
+    JsonValueBuilder builder([&](const std::string& key, const Json::Value& child) {
+        TEST_ASSERT_EQUAL_STRING(fast_write(accel[key]).c_str(), fast_write(child).c_str());
+        children++;
+        return true;
+    });
+    JsonParser parser(&builder);
+    std::string node = fast_write(accel);
+    TEST_ASSERT_EQUAL(ESP_OK, parser.feed(node.data(), node.size()));
+    TEST_ASSERT_EQUAL(ESP_OK, parser.finish());
+    TEST_ASSERT_EQUAL(2, children);
+    TEST_ASSERT_EQUAL(0, builder.release().size());
+
+    /* Array children are named by index; returning false stops the parse */
+    std::string keys;
+    JsonValueBuilder first_two([&](const std::string& key, const Json::Value& child) {
+        keys += key;
+        return keys.size() < 2;
+    });
+    JsonParser list_parser(&first_two);
+    const char* list = "[10, [20], {\"x\": 30}, 40]";
+    TEST_ASSERT_EQUAL(ESP_FAIL, list_parser.feed(list, strlen(list)));
+    TEST_ASSERT_EQUAL(ESP_FAIL, list_parser.finish());
+    TEST_ASSERT_EQUAL_STRING("01", keys.c_str());
+}
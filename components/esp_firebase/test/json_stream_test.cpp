@@ -0,0 +1,162 @@
+#include <string>
+#include "unity.h"
+#include "esp_firebase/json_stream.h"
+
+#include "jsoncpp/json.h"
+
+using namespace ESPFirebase;
+
+struct capture_t
+{
+    std::string text;
+    int calls;
+    size_t largest;
+    int fail_after;     // Calls accepted before the sink starts failing, -1 never
+};
+
+static esp_err_t capture_sink(void* ctx, const char* data, size_t len)
+{
+    capture_t* capture = (capture_t*)ctx;
+    if (capture->fail_after >= 0 && capture->calls >= capture->fail_after)
+    {
+        capture->calls++;
+        return ESP_FAIL;
+    }
+    capture->calls++;
+    capture->largest = len > capture->largest ? len : capture->largest;
+    capture->text.append(data, len);
+    return ESP_OK;
+}
+
+/* FastWriter ends its document with a newline, the stream does not */
+static std::string fast_write(const Json::Value& value)
+{
+    Json::FastWriter writer;
+    std::string text = writer.write(value);
+    text.pop_back();
+    return text;
+}
+
+static std::string stream_write(const Json::Value& value, capture_t* capture)
+{
+    JsonStream stream(capture_sink, capture);
+    stream.value(value);
+    TEST_ASSERT_EQUAL(ESP_OK, stream.finish());
+    TEST_ASSERT_EQUAL(capture->text.size(), stream.length());
+    return capture->text;
+}
+
+static Json::Value make_sample(int i)
+{
+    Json::Value sample(Json::objectValue);
+    sample["sensor1"]["roll"] = 12.5 + i;
+    sample["sensor1"]["pitch"] = -0.1 * i;
+    sample["sensor2"]["roll"] = i;
+    sample["sensor2"]["pitch"] = (Json::UInt64)i << 40;
+    return sample;
+}
+
+TEST_CASE("JSON stream writes the same text as FastWriter", "[json_stream]")
+{
+    Json::Value doc(Json::objectValue);
+    doc["null"] = Json::Value();
+    doc["bool"][0] = true;
+    doc["bool"][1] = false;
+    doc["int"] = -42;
+    doc["uint"] = (Json::UInt64)1 << 63;
+    doc["real"] = 3.14159265358979;
+    doc["empty"] = Json::Value(Json::objectValue);
+    doc["list"] = Json::Value(Json::arrayValue);
+    doc["escaped"] = "quote\" backslash\\ slash/ tab\t newline\n bell\x07";
+    doc["unicode"] = "postura \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80";
+    doc["key \"with\" quotes"] = "x";
+    doc["nul"] = Json::Value(std::string("before\0after", 12));
+    doc[std::string("nul\0key", 7)] = std::string("\0", 1);
+    doc["nested"]["a"]["b"]["c"] = "deep";
+
+    capture_t capture = {"", 0, 0, -1};
+    TEST_ASSERT_EQUAL_STRING(fast_write(doc).c_str(), stream_write(doc, &capture).c_str());
+}
+
+TEST_CASE("JSON stream hands a large document over in bounded chunks", "[json_stream]")
+{
+    Json::Value batch(Json::objectValue);
+    for (int i = 0; i < 100; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%013d", 1700000000 + i);
+        batch[key] = make_sample(i);
+    }
+
+    capture_t capture = {"", 0, 0, -1};
+    std::string expected = fast_write(batch);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), stream_write(batch, &capture).c_str());
+    TEST_ASSERT_GREATER_THAN(expected.size() / JSON_STREAM_CHUNK - 1, capture.calls);
+    TEST_ASSERT_EQUAL(JSON_STREAM_CHUNK, capture.largest);
+
+    /* Without a sink only the length is counted: the Content-Length of the request */
+    JsonStream counter;
+    counter.value(batch);
+    TEST_ASSERT_EQUAL(ESP_OK, counter.finish());
+    TEST_ASSERT_EQUAL(expected.size(), counter.length());
+}
+
+TEST_CASE("JSON stream builds an object member by member", "[json_stream]")
+{
+    Json::Value expected(Json::objectValue);
+    capture_t capture = {"", 0, 0, -1};
+    JsonStream stream(capture_sink, &capture);
+
+    stream.beginObject();
+    for (int i = 0; i < 3; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%013d", i);
+        expected[key] = make_sample(i);
+        stream.key(key);
+        stream.value(expected[key]);
+    }
+    stream.key("inner");
+    stream.beginObject();
+    stream.endObject();
+    expected["inner"] = Json::Value(Json::objectValue);
+    stream.endObject();
+
+    TEST_ASSERT_EQUAL(ESP_OK, stream.finish());
+    TEST_ASSERT_EQUAL_STRING(fast_write(expected).c_str(), capture.text.c_str());
+}
+
+TEST_CASE("JSON stream writes reals with the precision it is given", "[json_stream]")
+{
+    Json::Value sample(Json::objectValue);
+    sample["pitch"] = 12.34f;
+    sample["roll"] = -0.1;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    builder["precisionType"] = "float";
+    capture_t capture = {"", 0, 0, -1};
+    JsonStream stream(capture_sink, &capture);
+    stream.setPrecision(Json::Value::defaultRealPrecision, Json::PrecisionType::shortestFloat);
+    stream.value(sample);
+    TEST_ASSERT_EQUAL(ESP_OK, stream.finish());
+    TEST_ASSERT_EQUAL_STRING("{\"pitch\":12.34,\"roll\":-0.1}", capture.text.c_str());
+    TEST_ASSERT_EQUAL_STRING(Json::writeString(builder, sample).c_str(), capture.text.c_str());
+}
+
+TEST_CASE("JSON stream stops at the first sink error", "[json_stream]")
+{
+    Json::Value list(Json::arrayValue);
+    for (int i = 0; i < 500; i++)
+    {
+        list.append(i);
+    }
+
+    capture_t capture = {"", 0, 0, 1};
+    JsonStream stream(capture_sink, &capture);
+    stream.value(list);
+    TEST_ASSERT_EQUAL(ESP_FAIL, stream.finish());
+    TEST_ASSERT_EQUAL(2, capture.calls);
+    TEST_ASSERT_EQUAL(JSON_STREAM_CHUNK, capture.text.size());
+    TEST_ASSERT_EQUAL(fast_write(list).size(), stream.length());
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "sdkconfig.h"
+
+/*
+ * Needs a TLS server on the local network and CONFIG_ESP_FIREBASE_TLS_STANDIN_URL:
+ *   openssl s_server -accept 4433 -www -cert standin_cert.pem -key standin_key.pem
+ * The client is configured as FirebaseApp configures its per-host clients.
+ */
+
+#define RECONNECTS  5
+
+extern const char standin_cert_start[] asm("_binary_standin_cert_pem_start");
+
+static const char *TAG = "tls resumption test";
+
+typedef struct {
+    uint32_t connections;
+    int64_t connected_us;
+} standin_ctx_t;
+
+static esp_err_t standin_event_handler(esp_http_client_event_t *evt)
+{
+    standin_ctx_t *ctx = (standin_ctx_t *) evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        ctx->connections++;
+        ctx->connected_us = esp_timer_get_time();
+    }
+    return ESP_OK;
+}
+
+/* Mean connect time of RECONNECTS reconnects, after a first connection that fills the session cache */
+static int64_t mean_reconnect_us(bool save_client_session)
+{
+    standin_ctx_t ctx = {0};
+    esp_http_client_config_t config = {0};
+    int64_t total_us = 0;
+
+    config.url = CONFIG_ESP_FIREBASE_TLS_STANDIN_URL;
+    config.cert_pem = standin_cert_start;
+    config.skip_cert_common_name_check = true;
+    config.event_handler = standin_event_handler;
+    config.user_data = &ctx;
+    config.keep_alive_enable = true;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    config.save_client_session = save_client_session;
+#else
+    /* The option does not exist: every reconnect is a full handshake */
+    (void) save_client_session;
+#endif
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    TEST_ASSERT_NOT_NULL(client);
+
+    for (int i = 0; i <= RECONNECTS; i++) {
+        int64_t start_us = esp_timer_get_time();
+        TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_perform(client));
+        TEST_ASSERT_EQUAL(200, esp_http_client_get_status_code(client));
+        TEST_ASSERT_EQUAL(i + 1, ctx.connections);
+        if (i > 0) {
+            total_us += ctx.connected_us - start_us;
+        }
+        /* What a Wi-Fi drop does to the connection */
+        esp_http_client_close(client);
+    }
+
+    esp_http_client_cleanup(client);
+    return total_us / RECONNECTS;
+}
+
+TEST_CASE("TLS session ticket shortens the reconnect handshake", "[esp_firebase][tls]")
+{
+    if (strlen(CONFIG_ESP_FIREBASE_TLS_STANDIN_URL) == 0) {
+        TEST_IGNORE_MESSAGE("CONFIG_ESP_FIREBASE_TLS_STANDIN_URL not set");
+    }
+
+    int64_t full_us = mean_reconnect_us(false);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    int64_t resumed_us = mean_reconnect_us(true);
+    ESP_LOGI(TAG, "reconnect: %lld us full handshake, %lld us resumed", (long long) full_us, (long long) resumed_us);
+    /* The resumed handshake skips the certificate chain and the ECDHE key exchange */
+    TEST_ASSERT_TRUE(resumed_us < full_us);
+#else
+    ESP_LOGI(TAG, "reconnect: %lld us full handshake", (long long) full_us);
+    TEST_IGNORE_MESSAGE("CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS disabled");
+#endif
+}
@@ -0,0 +1,60 @@
+#include "unity.h"
+#include "esp_firebase/token_expiry.h"
+
+using namespace ESPFirebase;
+
+#define BOOT_CLOCK 10                   // time() before SNTP: seconds since boot
+#define SNTP_CLOCK 1760000000           // time() once SNTP set it
+#define EXPIRES_IN_S 3600
+#define MARGIN_S 300
+
+TEST_CASE("Token obtained before SNTP gets its wall clock expiry once the clock is set", "[token_expiry]")
+{
+    TokenExpiry expiry;
+    expiry.start(EXPIRES_IN_S, 5000000, BOOT_CLOCK);
+    TEST_ASSERT_EQUAL_INT64(5000000 + EXPIRES_IN_S * 1000000LL, expiry.timerUs());
+    TEST_ASSERT_EQUAL_INT64(0, expiry.wallClock());
+    TEST_ASSERT_TRUE(expiry.wallClockPending());
+
+    // Clock still not set
+    TEST_ASSERT_FALSE(expiry.syncWallClock(35000000, BOOT_CLOCK + 30));
+    TEST_ASSERT_TRUE(expiry.wallClockPending());
+
+    // SNTP sets it 60 s after the login
+    TEST_ASSERT_TRUE(expiry.syncWallClock(65000000, SNTP_CLOCK));
+    TEST_ASSERT_EQUAL_INT64(SNTP_CLOCK + EXPIRES_IN_S - 60, expiry.wallClock());
+    TEST_ASSERT_FALSE(expiry.wallClockPending());
+    TEST_ASSERT_FALSE(expiry.syncWallClock(75000000, SNTP_CLOCK + 10));
+    TEST_ASSERT_EQUAL_INT64(SNTP_CLOCK + EXPIRES_IN_S - 60, expiry.wallClock());
+
+    // The next boot, 10 minutes later, reuses the token until its real expiry
+    TokenExpiry next;
+    int64_t valid_s = next.resume(expiry.wallClock(), MARGIN_S, 2000000, SNTP_CLOCK + 600);
+    TEST_ASSERT_EQUAL_INT64(EXPIRES_IN_S - 60 - 600, valid_s);
+    TEST_ASSERT_EQUAL_INT64(2000000 + valid_s * 1000000LL, next.timerUs());
+    TEST_ASSERT_FALSE(next.wallClockPending());
+}
+
+TEST_CASE("Token obtained after SNTP has its wall clock expiry at once", "[token_expiry]")
+{
+    TokenExpiry expiry;
+    expiry.start(EXPIRES_IN_S, 5000000, SNTP_CLOCK);
+    TEST_ASSERT_EQUAL_INT64(SNTP_CLOCK + EXPIRES_IN_S, expiry.wallClock());
+    TEST_ASSERT_FALSE(expiry.wallClockPending());
+    TEST_ASSERT_FALSE(expiry.syncWallClock(6000000, SNTP_CLOCK + 1));
+}
+
+TEST_CASE("Stored token is not reused without a wall clock or near its expiry", "[token_expiry]")
+{
+    TokenExpiry expiry;
+    int64_t stored = SNTP_CLOCK + EXPIRES_IN_S;
+
+    TEST_ASSERT_EQUAL_INT64(0, expiry.resume(stored, MARGIN_S, 2000000, BOOT_CLOCK));
+    TEST_ASSERT_EQUAL_INT64(0, expiry.resume(stored, MARGIN_S, 2000000, stored - MARGIN_S));
+    // Stored before the clock was set
+    TEST_ASSERT_EQUAL_INT64(0, expiry.resume(0, MARGIN_S, 2000000, SNTP_CLOCK));
+    TEST_ASSERT_EQUAL_INT64(0, expiry.timerUs());
+    TEST_ASSERT_FALSE(expiry.wallClockPending());
+
+    TEST_ASSERT_EQUAL_INT64(MARGIN_S + 1, expiry.resume(stored, MARGIN_S, 2000000, stored - MARGIN_S - 1));
+}
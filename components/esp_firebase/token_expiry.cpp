@@ -0,0 +1,40 @@
+#include "token_expiry.h"
+
+
+namespace ESPFirebase {
+
+
+bool TokenExpiry::wallClockValid(time_t now)
+{
+    return now > FIREBASE_MIN_VALID_EPOCH;
+}
+
+void TokenExpiry::start(int64_t expires_in_s, int64_t now_us, time_t now)
+{
+    timer_us = now_us + expires_in_s * 1000000LL;
+    epoch = wallClockValid(now) ? now + expires_in_s : 0;
+}
+
+// The esp_timer expiry is exact on this boot, so it gives the wall clock one as soon as the clock is set
+bool TokenExpiry::syncWallClock(int64_t now_us, time_t now)
+{
+    if (!wallClockPending() || !wallClockValid(now))
+    {
+        return false;
+    }
+    epoch = now + (timer_us - now_us) / 1000000LL;
+    return true;
+}
+
+int64_t TokenExpiry::resume(int64_t stored_epoch, int64_t margin_s, int64_t now_us, time_t now)
+{
+    if (!wallClockValid(now) || stored_epoch - now <= margin_s)
+    {
+        return 0;
+    }
+    epoch = stored_epoch;
+    timer_us = now_us + (stored_epoch - now) * 1000000LL;
+    return stored_epoch - now;
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef _ESP_FIREBASE_TOKEN_EXPIRY_H_
+#define  _ESP_FIREBASE_TOKEN_EXPIRY_H_
+#include <stdint.h>
+#include <time.h>
+
+#define FIREBASE_MIN_VALID_EPOCH 1700000000 // Earlier wall clock means SNTP has not set it yet
+
+namespace ESPFirebase
+{
+
+    /**
+     * @brief When the ID token expires: on esp_timer, which drives the refresh on this boot,
+     * and on the wall clock, which is what is stored for the next boots
+     *
+     * A token obtained before SNTP set the clock only has the first until syncWallClock().
+     * The current times are passed in: esp_timer_get_time() and time(NULL).
+     */
+    class TokenExpiry
+    {
+    private:
+        int64_t timer_us = 0;   // esp_timer time at which the token expires, 0 without a token
+        int64_t epoch = 0;      // Same on the wall clock, seconds, 0 while the clock is not set
+
+    public:
+        static bool wallClockValid(time_t now);
+
+        /**
+         * @brief New token, valid for expires_in_s from now
+         */
+        void start(int64_t expires_in_s, int64_t now_us, time_t now);
+
+        /**
+         * @brief Give a token obtained before the clock was set its wall clock expiry
+         * @return true if it did, then the expiry should be stored again
+         */
+        bool syncWallClock(int64_t now_us, time_t now);
+
+        /**
+         * @brief Take the wall clock expiry stored by a previous boot
+         * @return Seconds the token is still valid, 0 if the clock is not set or it expires within
+         * margin_s; the expiry is only taken when not 0
+         */
+        int64_t resume(int64_t stored_epoch, int64_t margin_s, int64_t now_us, time_t now);
+
+        /**
+         * @brief A token without its wall clock expiry yet, see syncWallClock()
+         */
+        bool wallClockPending(void) const { return timer_us != 0 && epoch == 0; }
+
+        int64_t timerUs(void) const { return timer_us; }
+        int64_t wallClock(void) const { return epoch; }
+    };
+}
+
+#endif
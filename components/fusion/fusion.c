@@ -0,0 +1,198 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "fusion.h"
+
+#define DEG_TO_RAD      0.01745329252f
+#define RAD_TO_DEG      57.2957795131f
+
+float fusion_inv_sqrt(float x)
+{
+    float half_x = 0.5f * x;
+    float y;
+    uint32_t i;
+
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f3759dfu - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    return y * (1.5f - half_x * y * y);
+}
+
+static void fusion_normalize(fusion_quat_t *q)
+{
+    float recip_norm = fusion_inv_sqrt(q->w * q->w + q->x * q->x + q->y * q->y + q->z * q->z);
+
+    q->w *= recip_norm;
+    q->x *= recip_norm;
+    q->y *= recip_norm;
+    q->z *= recip_norm;
+}
+
+void fusion_init(fusion_t *fusion, const fusion_config_t *config)
+{
+    fusion->config = *config;
+    fusion_reset(fusion);
+}
+
+void fusion_reset(fusion_t *fusion)
+{
+    fusion->q.w = 1.0f;
+    fusion->q.x = 0.0f;
+    fusion->q.y = 0.0f;
+    fusion->q.z = 0.0f;
+    fusion->integral_x = 0.0f;
+    fusion->integral_y = 0.0f;
+    fusion->integral_z = 0.0f;
+    fusion->initialized = false;
+}
+
+/* Roll and pitch from gravity, yaw 0 */
+static void fusion_align(fusion_t *fusion, float ax, float ay, float az)
+{
+    float half_roll = 0.5f * atan2f(ay, az);
+    float half_pitch = 0.5f * atan2f(-ax, sqrtf(ay * ay + az * az));
+    float cr = cosf(half_roll);
+    float sr = sinf(half_roll);
+    float cp = cosf(half_pitch);
+    float sp = sinf(half_pitch);
+
+    fusion->q.w = cr * cp;
+    fusion->q.x = sr * cp;
+    fusion->q.y = cr * sp;
+    fusion->q.z = -sr * sp;
+    fusion->initialized = true;
+}
+
+static void fusion_integrate_gyro(fusion_quat_t *q, float gx, float gy, float gz, float dt)
+{
+    float q0 = q->w, q1 = q->x, q2 = q->y, q3 = q->z;
+    float half_dt = 0.5f * dt;
+
+    q->w = q0 + (-q1 * gx - q2 * gy - q3 * gz) * half_dt;
+    q->x = q1 + (q0 * gx + q2 * gz - q3 * gy) * half_dt;
+    q->y = q2 + (q0 * gy - q1 * gz + q3 * gx) * half_dt;
+    q->z = q3 + (q0 * gz + q1 * gy - q2 * gx) * half_dt;
+}
+
+/* Madgwick, "An efficient orientation filter for inertial and inertial/magnetic sensor arrays", IMU variant */
+static void fusion_madgwick(fusion_t *fusion, float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+    float q0 = fusion->q.w, q1 = fusion->q.x, q2 = fusion->q.y, q3 = fusion->q.z;
+
+    /* Rate of change of the quaternion from the gyroscope */
+    float dq0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float dq1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float dq2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float dq3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    /* Gradient descent step towards the measured gravity */
+    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+    float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+    float s_norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+
+    /* Zero at the exact solution */
+    if (s_norm > 0.0f) {
+        float step = fusion->config.beta * fusion_inv_sqrt(s_norm);
+        dq0 -= step * s0;
+        dq1 -= step * s1;
+        dq2 -= step * s2;
+        dq3 -= step * s3;
+    }
+
+    fusion->q.w = q0 + dq0 * dt;
+    fusion->q.x = q1 + dq1 * dt;
+    fusion->q.y = q2 + dq2 * dt;
+    fusion->q.z = q3 + dq3 * dt;
+}
+
+/* Mahony, "Nonlinear Complementary Filters on the Special Orthogonal Group", IMU variant */
+static void fusion_mahony(fusion_t *fusion, float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+    float q0 = fusion->q.w, q1 = fusion->q.x, q2 = fusion->q.y, q3 = fusion->q.z;
+
+    /* Half of the gravity direction estimated by q */
+    float half_vx = q1 * q3 - q0 * q2;
+    float half_vy = q0 * q1 + q2 * q3;
+    float half_vz = q0 * q0 - 0.5f + q3 * q3;
+
+    /* Error: cross product between measured and estimated gravity */
+    float half_ex = ay * half_vz - az * half_vy;
+    float half_ey = az * half_vx - ax * half_vz;
+    float half_ez = ax * half_vy - ay * half_vx;
+
+    if (fusion->config.ki > 0.0f) {
+        float two_ki_dt = 2.0f * fusion->config.ki * dt;
+        fusion->integral_x += two_ki_dt * half_ex;
+        fusion->integral_y += two_ki_dt * half_ey;
+        fusion->integral_z += two_ki_dt * half_ez;
+        gx += fusion->integral_x;
+        gy += fusion->integral_y;
+        gz += fusion->integral_z;
+    }
+
+    float two_kp = 2.0f * fusion->config.kp;
+    gx += two_kp * half_ex;
+    gy += two_kp * half_ey;
+    gz += two_kp * half_ez;
+
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    fusion->q.w = q0 + (-q1 * gx - q2 * gy - q3 * gz);
+    fusion->q.x = q1 + (q0 * gx + q2 * gz - q3 * gy);
+    fusion->q.y = q2 + (q0 * gy - q1 * gz + q3 * gx);
+    fusion->q.z = q3 + (q0 * gz + q1 * gy - q2 * gx);
+}
+
+void fusion_update(fusion_t *fusion, float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+    float a_norm = ax * ax + ay * ay + az * az;
+
+    /* Free fall or a dead accelerometer gives no reference: integrate the gyroscope only */
+    if (a_norm == 0.0f) {
+        if (fusion->initialized) {
+            fusion_integrate_gyro(&fusion->q, gx * DEG_TO_RAD, gy * DEG_TO_RAD, gz * DEG_TO_RAD, dt);
+            fusion_normalize(&fusion->q);
+        }
+        return;
+    }
+
+    float recip_norm = fusion_inv_sqrt(a_norm);
+    ax *= recip_norm;
+    ay *= recip_norm;
+    az *= recip_norm;
+
+    if (!fusion->initialized) {
+        fusion_align(fusion, ax, ay, az);
+        return;
+    }
+
+    if (fusion->config.algorithm == FUSION_MAHONY) {
+        fusion_mahony(fusion, gx * DEG_TO_RAD, gy * DEG_TO_RAD, gz * DEG_TO_RAD, ax, ay, az, dt);
+    } else {
+        fusion_madgwick(fusion, gx * DEG_TO_RAD, gy * DEG_TO_RAD, gz * DEG_TO_RAD, ax, ay, az, dt);
+    }
+    fusion_normalize(&fusion->q);
+}
+
+void fusion_get_euler(const fusion_quat_t *q, fusion_euler_t *euler)
+{
+    float sin_pitch = 2.0f * (q->w * q->y - q->z * q->x);
+
+    if (sin_pitch > 1.0f) {
+        sin_pitch = 1.0f;
+    } else if (sin_pitch < -1.0f) {
+        sin_pitch = -1.0f;
+    }
+
+    euler->roll = atan2f(2.0f * (q->w * q->x + q->y * q->z), 1.0f - 2.0f * (q->x * q->x + q->y * q->y)) * RAD_TO_DEG;
+    euler->pitch = asinf(sin_pitch) * RAD_TO_DEG;
+    euler->yaw = atan2f(2.0f * (q->w * q->z + q->x * q->y), 1.0f - 2.0f * (q->y * q->y + q->z * q->z)) * RAD_TO_DEG;
+}
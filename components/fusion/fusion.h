@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Quaternion orientation filter (Madgwick / Mahony) for gyroscope + accelerometer
+ *
+ * Single precision only: the ESP32 FPU has no double precision, and every normalization in
+ * the filter goes through fusion_inv_sqrt(). The alignment with gravity on the first
+ * fusion_update() runs once and keeps sqrtf(), so the starting pitch has no estimate error.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FUSION_MADGWICK = 0,    /*!< Gradient descent correction, gain beta */
+    FUSION_MAHONY   = 1,    /*!< PI correction of the gyroscope, gains kp and ki */
+} fusion_algorithm_t;
+
+typedef struct {
+    float w;
+    float x;
+    float y;
+    float z;
+} fusion_quat_t;
+
+/**
+ * @brief Euler angles in degrees, aerospace sequence (yaw, then pitch, then roll)
+ *
+ * Without a magnetometer yaw is relative to the heading at the first update and drifts.
+ */
+typedef struct {
+    float roll;
+    float pitch;
+    float yaw;
+} fusion_euler_t;
+
+typedef struct {
+    fusion_algorithm_t algorithm;
+    float beta;             /*!< Madgwick gain, rad/s */
+    float kp;               /*!< Mahony proportional gain */
+    float ki;               /*!< Mahony integral gain, 0 disables gyroscope bias estimation */
+} fusion_config_t;
+
+#define FUSION_CONFIG_DEFAULT() { \
+    .algorithm = FUSION_MADGWICK, \
+    .beta = 0.1f,                 \
+    .kp = 0.5f,                   \
+    .ki = 0.0f,                   \
+}
+
+typedef struct {
+    fusion_config_t config;
+    fusion_quat_t q;        /*!< Sensor to earth rotation */
+    float integral_x;       /*!< Mahony integral feedback, rad/s */
+    float integral_y;
+    float integral_z;
+    bool initialized;       /*!< q was aligned with gravity by a first update */
+} fusion_t;
+
+/**
+ * @brief Initialize a filter
+ *
+ * The first fusion_update() aligns the quaternion with the measured gravity instead of
+ * converging to it from the identity.
+ *
+ * @param fusion Filter state
+ * @param config Algorithm and gains, copied
+ */
+void fusion_init(fusion_t *fusion, const fusion_config_t *config);
+
+/**
+ * @brief Forget the orientation; the next update aligns with gravity again
+ *
+ * For gaps in the samples that are too long to integrate the gyroscope over.
+ */
+void fusion_reset(fusion_t *fusion);
+
+/**
+ * @brief Fuse one sample
+ *
+ * @param fusion Filter state
+ * @param gx Angular rate around X, degree per second (likewise gy, gz)
+ * @param ax Acceleration along X, any unit: only the direction is used (likewise ay, az)
+ * @param dt Time since the previous sample, seconds
+ */
+void fusion_update(fusion_t *fusion, float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+/**
+ * @brief Derive Euler angles from a quaternion
+ */
+void fusion_get_euler(const fusion_quat_t *q, fusion_euler_t *euler);
+
+/**
+ * @brief 1 / sqrt(x), bit-level estimate refined by one Newton step (relative error < 0.2 %)
+ */
+float fusion_inv_sqrt(float x);
+
+#ifdef __cplusplus
+}
+#endif
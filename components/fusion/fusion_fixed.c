@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include "fusion_fixed.h"
+
+#define Q30_ONE                 (1u << 30)
+#define BAM_HALF_PI             (1u << 30)      /*!< Binary angle of pi / 2 */
+#define BAM_PI                  (1u << 31)
+#define RAD_Q30_TO_BAM          2734261102u     /*!< 2^33 / pi: Q30 radians to binary angle, then >> 32 */
+
+/* atan(z) = z * (A1 + A3 z^2 + A5 z^4 + A7 z^6 + A9 z^8) on [0, 1], Abramowitz & Stegun 4.4.49, Q30 */
+#define ATAN_A1                 1073597943
+#define ATAN_A3                 (-354656388)
+#define ATAN_A5                 193424926
+#define ATAN_A7                 (-91410863)
+#define ATAN_A9                 22371518
+
+/* 1 / sqrt(m) at the middle of [i / 8, (i + 1) / 8), i = 8..31, Q30 */
+static const uint32_t inv_sqrt_lut[24] = {
+    1041682578, 985333074, 937238702, 895562589, 858993459, 826566842, 797555404, 771398898,
+    747657839, 725981977, 706088274, 687745184, 670761200, 654976372, 640255922, 626485368,
+    613566757, 601415717, 589959130, 579133272, 568882316, 559157115, 549914212, 541115017,
+};
+
+uint32_t fusion_fixed_sqrt(uint32_t x)
+{
+    if (0 == x) {
+        return 0;
+    }
+
+    /* m = x * 4^k in [2^30, 2^32), i.e. [1, 4) in Q30 */
+    int shift = __builtin_clz(x) & ~1;
+    uint32_t m = x << shift;
+
+    /* Table estimate of 1 / sqrt(m), then two Newton steps y = y * (3 - m * y^2) / 2 */
+    uint64_t y = inv_sqrt_lut[(m >> 27) - 8];
+    for (int i = 0; i < 2; i++) {
+        uint64_t t = (y * y) >> 30;
+        t = ((uint64_t) m * t) >> 30;
+        y = (y * (3ull * Q30_ONE - t)) >> 31;
+    }
+
+    /* sqrt(m) = m / sqrt(m), in Q30, then undo the normalization */
+    uint64_t root = ((uint64_t) m * y) >> 30;
+    int out_shift = 15 + shift / 2;
+    return (uint32_t)((root + (1ull << (out_shift - 1))) >> out_shift);
+}
+
+int32_t fusion_fixed_atan2(int32_t y, int32_t x)
+{
+    uint32_t abs_x = x < 0 ? -(uint32_t) x : (uint32_t) x;
+    uint32_t abs_y = y < 0 ? -(uint32_t) y : (uint32_t) y;
+
+    if (0 == abs_x && 0 == abs_y) {
+        return 0;
+    }
+
+    /* Reduce to the first octant: z = min / max in [0, 1] */
+    bool swap = abs_y > abs_x;
+    uint32_t num = swap ? abs_x : abs_y;
+    uint32_t den = swap ? abs_y : abs_x;
+
+    /* Q30 quotient from two 32-bit divisions: 64-bit division is a library call on Xtensa */
+    int shift = __builtin_clz(den);
+    num <<= shift;
+    den = ((den << shift) >> 16) + ((den << shift) >> 15 & 1);
+    uint32_t quot = (num >> 1) / den;
+    uint32_t rem = (num >> 1) - quot * den;
+    int64_t z = ((int64_t) quot << 15) + (int64_t)((rem << 15) / den);
+    if (z > Q30_ONE) {
+        z = Q30_ONE;
+    }
+    int64_t z2 = (z * z) >> 30;
+
+    int64_t p = ATAN_A9;
+    p = ATAN_A7 + ((p * z2) >> 30);
+    p = ATAN_A5 + ((p * z2) >> 30);
+    p = ATAN_A3 + ((p * z2) >> 30);
+    p = ATAN_A1 + ((p * z2) >> 30);
+    uint64_t rad_q30 = (uint64_t)((p * z) >> 30);
+    uint32_t angle = (uint32_t)((rad_q30 * RAD_Q30_TO_BAM) >> 32);
+
+    if (swap) {
+        angle = BAM_HALF_PI - angle;
+    }
+    if (x < 0) {
+        angle = BAM_PI - angle;
+    }
+    if (y < 0) {
+        angle = -angle;
+    }
+    return (int32_t) angle;
+}
+
+void fusion_fixed_tilt(const int16_t acce[3], fusion_fixed_angles_t *angles)
+{
+    int32_t ax = acce[0], ay = acce[1], az = acce[2];
+
+    angles->roll = fusion_fixed_atan2(ay, az);
+    angles->pitch = fusion_fixed_atan2(-ax, (int32_t) fusion_fixed_sqrt((uint32_t)(ay * ay) + (uint32_t)(az * az)));
+}
+
+void fusion_fixed_init(fusion_fixed_t *fusion, uint32_t gyro_lsb_per_dps_x10, uint8_t alpha_shift)
+{
+    /* Binary angle per LSB per microsecond: 2^31 / 180 degree / 10^6 us / (LSB per dps), in Q16 */
+    fusion->gyro_scale = ((int64_t) 10 << 47) / (180000000ll * gyro_lsb_per_dps_x10);
+    fusion->alpha_shift = alpha_shift;
+    fusion_fixed_reset(fusion);
+}
+
+void fusion_fixed_reset(fusion_fixed_t *fusion)
+{
+    fusion->angles.roll = 0;
+    fusion->angles.pitch = 0;
+    fusion->initialized = false;
+}
+
+static int32_t fusion_fixed_blend(int32_t angle, int64_t gyro_step, int32_t acce_angle, uint8_t alpha_shift)
+{
+    /* Unsigned arithmetic: binary angles wrap around at +/- pi */
+    uint32_t predicted = (uint32_t) angle + (uint32_t)(int32_t) gyro_step;
+    int32_t error = (int32_t)((uint32_t) acce_angle - predicted);
+
+    return (int32_t)(predicted + (uint32_t)(error >> alpha_shift));
+}
+
+void fusion_fixed_update(fusion_fixed_t *fusion, const int16_t gyro[3], const int16_t acce[3], uint32_t dt_us)
+{
+    fusion_fixed_angles_t acce_angles;
+
+    fusion_fixed_tilt(acce, &acce_angles);
+    if (!fusion->initialized) {
+        fusion->angles = acce_angles;
+        fusion->initialized = true;
+        return;
+    }
+
+    int64_t step = (int64_t) dt_us * fusion->gyro_scale;
+    fusion->angles.roll = fusion_fixed_blend(fusion->angles.roll, (gyro[0] * step) >> 16, acce_angles.roll, fusion->alpha_shift);
+    fusion->angles.pitch = fusion_fixed_blend(fusion->angles.pitch, (gyro[1] * step) >> 16, acce_angles.pitch, fusion->alpha_shift);
+}
+
+void fusion_fixed_get_euler(const fusion_fixed_angles_t *angles, fusion_euler_t *euler)
+{
+    euler->roll = angles->roll * (float)(180.0 / FUSION_FIXED_PI);
+    euler->pitch = angles->pitch * (float)(180.0 / FUSION_FIXED_PI);
+    euler->yaw = 0.0f;
+}
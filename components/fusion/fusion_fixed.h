@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief Integer-only tilt estimation on raw MPU6050 readings
+ *
+ * Roll and pitch from a complementary filter over raw gyroscope and accelerometer
+ * samples, without any floating point: polynomial atan2 and a table based inverse
+ * square root. Angles are binary angles, a full turn being the int32_t range
+ * (FUSION_FIXED_PI == 2^31, i.e. Q31 fractions of pi), so they wrap around like
+ * angles do.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fusion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FUSION_FIXED_PI             2147483648.0    /*!< Binary angle of pi, for conversions only */
+
+typedef struct {
+    int32_t roll;           /*!< Binary angle, Q31 of pi */
+    int32_t pitch;
+} fusion_fixed_angles_t;
+
+typedef struct {
+    fusion_fixed_angles_t angles;
+    int64_t gyro_scale;     /*!< Binary angle per gyroscope LSB and microsecond, Q16 */
+    uint8_t alpha_shift;    /*!< Accelerometer weight per update is 2^-alpha_shift */
+    bool initialized;       /*!< angles were set from the accelerometer by a first update */
+} fusion_fixed_t;
+
+/**
+ * @brief Initialize a filter
+ *
+ * @param fusion Filter state
+ * @param gyro_lsb_per_dps_x10 Gyroscope sensitivity times 10 (1310, 655, 328 or 164 for 250 to 2000 dps)
+ * @param alpha_shift Accelerometer weight is 2^-alpha_shift; 6 gives a time constant of ~64 samples
+ */
+void fusion_fixed_init(fusion_fixed_t *fusion, uint32_t gyro_lsb_per_dps_x10, uint8_t alpha_shift);
+
+/**
+ * @brief Forget the angles; the next update takes them from the accelerometer
+ */
+void fusion_fixed_reset(fusion_fixed_t *fusion);
+
+/**
+ * @brief Fuse one raw sample
+ *
+ * @param fusion Filter state
+ * @param gyro Raw gyroscope X, Y, Z
+ * @param acce Raw accelerometer X, Y, Z, any full scale range
+ * @param dt_us Time since the previous sample, microseconds
+ */
+void fusion_fixed_update(fusion_fixed_t *fusion, const int16_t gyro[3], const int16_t acce[3], uint32_t dt_us);
+
+/**
+ * @brief Roll and pitch from the accelerometer alone
+ *
+ * Roll is atan2(ay, az), over the full turn as fusion_get_euler() gives it, not the
+ * atan(ay / sqrt(ax^2 + az^2)) of the original firmware, which differs once pitch is not 0.
+ * Pitch is atan(-ax / sqrt(ay^2 + az^2)) in both.
+ */
+void fusion_fixed_tilt(const int16_t acce[3], fusion_fixed_angles_t *angles);
+
+/**
+ * @brief Convert to degrees, for display and upload; roll and pitch only, yaw is 0
+ */
+void fusion_fixed_get_euler(const fusion_fixed_angles_t *angles, fusion_euler_t *euler);
+
+/**
+ * @brief atan2(y, x) as a binary angle (Q31 of pi)
+ *
+ * Polynomial approximation on one octant, error below 0.001 degree.
+ */
+int32_t fusion_fixed_atan2(int32_t y, int32_t x);
+
+/**
+ * @brief Integer square root, from a 1 / sqrt lookup table refined by two Newton steps
+ */
+uint32_t fusion_fixed_sqrt(uint32_t x);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Timing for the [bench] cases: CPU cycles on a target, nanoseconds on the linux target,
+ * where there is no cycle counter to read. BENCH_UNIT names the unit for the logs.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#define BENCH_UNIT  "ns"
+#else
+#include "esp_cpu.h"
+#define BENCH_UNIT  "cycles"
+#endif
+
+typedef struct {
+#if CONFIG_IDF_TARGET_LINUX
+    struct timespec start;
+#else
+    uint32_t start;
+#endif
+} bench_t;
+
+static inline void bench_begin(bench_t *bench)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    clock_gettime(CLOCK_MONOTONIC, &bench->start);
+#else
+    bench->start = esp_cpu_get_cycle_count();
+#endif
+}
+
+/* BENCH_UNIT elapsed since bench_begin(); the cycle counter wraps after a few seconds */
+static inline double bench_end(const bench_t *bench)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - bench->start.tv_sec) * 1e9 + (end.tv_nsec - bench->start.tv_nsec);
+#else
+    return (double)(uint32_t)(esp_cpu_get_cycle_count() - bench->start);
+#endif
+}
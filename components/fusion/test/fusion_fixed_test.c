@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <math.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "fusion.h"
+#include "fusion_fixed.h"
+#include "bench_timer.h"
+
+#define SAMPLE_RATE_HZ      1000
+#define SAMPLE_DT_US        (1000000 / SAMPLE_RATE_HZ)
+#define ACCE_LSB_PER_G      16384   /*!< ACCE_FS_2G */
+#define GYRO_LSB_PER_DPS_X10 655    /*!< GYRO_FS_500DPS */
+#define ALPHA_SHIFT         6
+#define BENCH_UPDATES       100000
+
+static const char *TAG = "fusion fixed test";
+
+static float to_degree(int32_t angle)
+{
+    return angle * (float)(180.0 / FUSION_FIXED_PI);
+}
+
+static float angle_error(float a, float b)
+{
+    float error = fabsf(a - b);
+    return error > 180.0f ? 360.0f - error : error;
+}
+
+/* Reference: calculate_roll() and calculate_pitch() as the firmware had them before the quaternion filter */
+static void baseline_tilt(const int16_t acce[3], double *roll, double *pitch)
+{
+    double ax = acce[0], ay = acce[1], az = acce[2];
+
+    *roll = atan(ay / sqrt(ax * ax + az * az)) * (180.0 / M_PI);
+    *pitch = atan(-ax / sqrt(ay * ay + az * az)) * (180.0 / M_PI);
+}
+
+static void raw_roll_sample(float roll_deg, float roll_rate_dps, int16_t gyro[3], int16_t acce[3])
+{
+    float roll = roll_deg * 0.01745329252f;
+
+    gyro[0] = (int16_t) lrintf(roll_rate_dps * GYRO_LSB_PER_DPS_X10 / 10.0f);
+    gyro[1] = 0;
+    gyro[2] = 0;
+    acce[0] = 0;
+    acce[1] = (int16_t) lrintf(sinf(roll) * ACCE_LSB_PER_G);
+    acce[2] = (int16_t) lrintf(cosf(roll) * ACCE_LSB_PER_G);
+}
+
+TEST_CASE("Fusion fixed atan2 matches atan2f", "[fusion]")
+{
+    float max_error = 0.0f;
+
+    for (int32_t y = -32768; y <= 32767; y += 97) {
+        for (int32_t x = -32768; x <= 32767; x += 89) {
+            if (0 == x && 0 == y) {
+                continue;
+            }
+            float expected = atan2f((float) y, (float) x) * 57.2957795131f;
+            max_error = fmaxf(max_error, angle_error(to_degree(fusion_fixed_atan2(y, x)), expected));
+        }
+    }
+    ESP_LOGI(TAG, "atan2 max error %.5f deg", max_error);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.001f, max_error);
+
+    /* Axes and the full int32_t range */
+    TEST_ASSERT_EQUAL_INT32(0, fusion_fixed_atan2(0, 1));
+    TEST_ASSERT_EQUAL_INT32(1 << 30, fusion_fixed_atan2(INT32_MAX, 0));
+    TEST_ASSERT_EQUAL_INT32(-(1 << 30), fusion_fixed_atan2(INT32_MIN, 0));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, fusion_fixed_atan2(0, INT32_MIN));
+}
+
+TEST_CASE("Fusion fixed sqrt matches sqrtf", "[fusion]")
+{
+    TEST_ASSERT_EQUAL_UINT32(0, fusion_fixed_sqrt(0));
+    TEST_ASSERT_EQUAL_UINT32(65536, fusion_fixed_sqrt(UINT32_MAX));
+
+    for (uint64_t x = 1; x <= UINT32_MAX; x = x * 17 / 16 + 1) {
+        double expected = sqrt((double) x);
+        TEST_ASSERT_FLOAT_WITHIN(0.51f, (float) expected, (float) fusion_fixed_sqrt((uint32_t) x));
+    }
+}
+
+/*
+ * Pitch is the baseline formula everywhere. Roll is atan2(ay, az), which covers the full
+ * turn: the baseline roll folds into +-90 deg and mixes in ax, so it is the same angle only
+ * with no pitch and the sensor upright, and is checked there.
+ */
+TEST_CASE("Fusion fixed tilt matches the baseline formula", "[fusion]")
+{
+    fusion_fixed_angles_t angles;
+    double roll, pitch;
+    float max_error = 0.0f;
+    int upright = 0;
+
+    /* Every direction on a 2 g sphere, as the accelerometer reports it */
+    for (int r = -180; r < 180; r += 5) {
+        for (int p = -85; p <= 85; p += 5) {
+            float rr = r * 0.01745329252f, pr = p * 0.01745329252f;
+            int16_t acce[3] = {
+                (int16_t) lrintf(-sinf(pr) * ACCE_LSB_PER_G),
+                (int16_t) lrintf(cosf(pr) * sinf(rr) * ACCE_LSB_PER_G),
+                (int16_t) lrintf(cosf(pr) * cosf(rr) * ACCE_LSB_PER_G),
+            };
+            fusion_fixed_tilt(acce, &angles);
+            baseline_tilt(acce, &roll, &pitch);
+            max_error = fmaxf(max_error, angle_error(to_degree(angles.pitch), (float) pitch));
+            if (0 == acce[0] && acce[2] > 0) {
+                max_error = fmaxf(max_error, angle_error(to_degree(angles.roll), (float) roll));
+                upright++;
+            }
+            roll = atan2((double) acce[1], (double) acce[2]) * (180.0 / M_PI);
+            max_error = fmaxf(max_error, angle_error(to_degree(angles.roll), (float) roll));
+        }
+    }
+    ESP_LOGI(TAG, "tilt max error %.5f deg", max_error);
+    TEST_ASSERT_GREATER_THAN(30, upright);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.01f, max_error);
+}
+
+TEST_CASE("Fusion fixed tracks motion", "[fusion]")
+{
+    fusion_fixed_t fusion;
+    fusion_euler_t euler;
+    int16_t gyro[3], acce[3];
+    float max_error = 0.0f;
+
+    fusion_fixed_init(&fusion, GYRO_LSB_PER_DPS_X10, ALPHA_SHIFT);
+
+    /* 20 degrees at 0.5 Hz for 4 s, as for the float filter */
+    for (int i = 0; i < 4 * SAMPLE_RATE_HZ; i++) {
+        float t = (float) i / SAMPLE_RATE_HZ;
+        float w = 2.0f * (float) M_PI * 0.5f;
+        float roll = 20.0f * sinf(w * t);
+        raw_roll_sample(roll, 20.0f * w * cosf(w * t), gyro, acce);
+        fusion_fixed_update(&fusion, gyro, acce, SAMPLE_DT_US);
+        fusion_fixed_get_euler(&fusion.angles, &euler);
+        max_error = fmaxf(max_error, fabsf(euler.roll - roll));
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, euler.pitch);
+    }
+    ESP_LOGI(TAG, "max roll error %.3f deg", max_error);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, max_error);
+}
+
+TEST_CASE("Fusion fixed wraps around upside down", "[fusion]")
+{
+    fusion_fixed_t fusion;
+    fusion_euler_t euler;
+    int16_t gyro[3], acce[3];
+
+    fusion_fixed_init(&fusion, GYRO_LSB_PER_DPS_X10, ALPHA_SHIFT);
+
+    /* Rolling through 180 degrees at 90 dps must not swing back through 0 */
+    for (int i = 0; i < 2 * SAMPLE_RATE_HZ; i++) {
+        float roll = 90.0f + 90.0f * i / SAMPLE_RATE_HZ;
+        raw_roll_sample(roll, 90.0f, gyro, acce);
+        fusion_fixed_update(&fusion, gyro, acce, SAMPLE_DT_US);
+        fusion_fixed_get_euler(&fusion.angles, &euler);
+        TEST_ASSERT_LESS_THAN_FLOAT(1.0f, angle_error(euler.roll, roll > 180.0f ? roll - 360.0f : roll));
+    }
+}
+
+TEST_CASE("Fusion fixed versus float benchmark", "[fusion][bench]")
+{
+    fusion_config_t config = FUSION_CONFIG_DEFAULT();
+    fusion_t fusion;
+    fusion_fixed_t fusion_fixed;
+    fusion_euler_t euler;
+    int16_t gyro[3], acce[3];
+    double cost[2];
+
+    fusion_init(&fusion, &config);
+    fusion_fixed_init(&fusion_fixed, GYRO_LSB_PER_DPS_X10, ALPHA_SHIFT);
+    raw_roll_sample(10.0f, 5.0f, gyro, acce);
+
+    for (int f = 0; f < 2; f++) {
+        bench_t bench;
+        bench_begin(&bench);
+        for (int i = 0; i < BENCH_UPDATES; i++) {
+            if (f == 0) {
+                /* The float path includes the raw to physical unit conversion the driver does */
+                fusion_update(&fusion, gyro[0] * (10.0f / GYRO_LSB_PER_DPS_X10), gyro[1] * (10.0f / GYRO_LSB_PER_DPS_X10),
+                              gyro[2] * (10.0f / GYRO_LSB_PER_DPS_X10), acce[0] / (float) ACCE_LSB_PER_G,
+                              acce[1] / (float) ACCE_LSB_PER_G, acce[2] / (float) ACCE_LSB_PER_G, SAMPLE_DT_US * 1e-6f);
+            } else {
+                fusion_fixed_update(&fusion_fixed, gyro, acce, SAMPLE_DT_US);
+            }
+        }
+        cost[f] = bench_end(&bench) / BENCH_UPDATES;
+        ESP_LOGI(TAG, "%s: %.1f " BENCH_UNIT "/update", f == 0 ? "float" : "fixed", cost[f]);
+    }
+    ESP_LOGI(TAG, "fixed point is %.2fx the float throughput", cost[0] / cost[1]);
+
+    fusion_get_euler(&fusion.q, &euler);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 10.0f, euler.roll);
+    fusion_fixed_get_euler(&fusion_fixed.angles, &euler);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 10.0f, euler.roll);
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <math.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "fusion.h"
+#include "bench_timer.h"
+
+#define SAMPLE_RATE_HZ      1000
+#define SAMPLE_DT           (1.0f / SAMPLE_RATE_HZ)
+#define BENCH_UPDATES       100000
+#define BENCH_SENSORS       4       /*!< Sensors the budget has to cover at SAMPLE_RATE_HZ */
+
+static const char *TAG = "fusion test";
+
+/* Roll only, so gravity and angular rate are known exactly */
+static void roll_sample(float roll_deg, float roll_rate_dps, float *gyro, float *acce)
+{
+    float roll = roll_deg * 0.01745329252f;
+
+    gyro[0] = roll_rate_dps;
+    gyro[1] = 0.0f;
+    gyro[2] = 0.0f;
+    acce[0] = 0.0f;
+    acce[1] = sinf(roll);
+    acce[2] = cosf(roll);
+}
+
+static void check_tracks_sway(fusion_algorithm_t algorithm)
+{
+    fusion_config_t config = FUSION_CONFIG_DEFAULT();
+    fusion_t fusion;
+    fusion_euler_t euler;
+    float gyro[3], acce[3];
+    float max_error = 0.0f;
+
+    config.algorithm = algorithm;
+    fusion_init(&fusion, &config);
+
+    /* 20 degrees at 0.5 Hz for 4 s */
+    for (int i = 0; i < 4 * SAMPLE_RATE_HZ; i++) {
+        float t = i * SAMPLE_DT;
+        float w = 2.0f * (float) M_PI * 0.5f;
+        float roll = 20.0f * sinf(w * t);
+        roll_sample(roll, 20.0f * w * cosf(w * t), gyro, acce);
+        fusion_update(&fusion, gyro[0], gyro[1], gyro[2], acce[0], acce[1], acce[2], SAMPLE_DT);
+        fusion_get_euler(&fusion.q, &euler);
+        max_error = fmaxf(max_error, fabsf(euler.roll - roll));
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, euler.pitch);
+    }
+    ESP_LOGI(TAG, "max roll error %.3f deg", max_error);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, max_error);
+}
+
+TEST_CASE("Fusion inverse square root", "[fusion]")
+{
+    for (float x = 1e-4f; x < 1e4f; x *= 1.37f) {
+        float expected = 1.0f / sqrtf(x);
+        TEST_ASSERT_FLOAT_WITHIN(expected * 2e-3f, expected, fusion_inv_sqrt(x));
+    }
+}
+
+TEST_CASE("Fusion aligns with gravity on the first sample", "[fusion]")
+{
+    fusion_config_t config = FUSION_CONFIG_DEFAULT();
+    fusion_t fusion;
+    fusion_euler_t euler;
+
+    fusion_init(&fusion, &config);
+    /* 30 degrees roll, -10 degrees pitch, 2 g to check only the direction matters */
+    float roll = 30.0f * 0.01745329252f;
+    float pitch = -10.0f * 0.01745329252f;
+    fusion_update(&fusion, 0.0f, 0.0f, 0.0f,
+                  -2.0f * sinf(pitch), 2.0f * cosf(pitch) * sinf(roll), 2.0f * cosf(pitch) * cosf(roll), SAMPLE_DT);
+    fusion_get_euler(&fusion.q, &euler);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 30.0f, euler.roll);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -10.0f, euler.pitch);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, euler.yaw);
+}
+
+TEST_CASE("Fusion Madgwick tracks motion", "[fusion]")
+{
+    check_tracks_sway(FUSION_MADGWICK);
+}
+
+TEST_CASE("Fusion Mahony tracks motion", "[fusion]")
+{
+    check_tracks_sway(FUSION_MAHONY);
+}
+
+TEST_CASE("Fusion rejects short linear acceleration", "[fusion]")
+{
+    fusion_config_t config = FUSION_CONFIG_DEFAULT();
+    fusion_t fusion;
+    fusion_euler_t euler;
+    float max_error = 0.0f;
+
+    fusion_init(&fusion, &config);
+    /* Sensor level and still, pushed sideways at 0.3 g for 200 ms: accelerometer alone reads ~17 degrees */
+    for (int i = 0; i < SAMPLE_RATE_HZ; i++) {
+        float ay = (i >= 400 && i < 600) ? 0.3f : 0.0f;
+        fusion_update(&fusion, 0.0f, 0.0f, 0.0f, 0.0f, ay, 1.0f, SAMPLE_DT);
+        fusion_get_euler(&fusion.q, &euler);
+        max_error = fmaxf(max_error, fabsf(euler.roll));
+    }
+    ESP_LOGI(TAG, "max roll error %.3f deg", max_error);
+    TEST_ASSERT_LESS_THAN_FLOAT(3.0f, max_error);
+}
+
+TEST_CASE("Fusion update benchmark", "[fusion][bench]")
+{
+    fusion_config_t config = FUSION_CONFIG_DEFAULT();
+    fusion_t fusion[2];
+    fusion_euler_t euler;
+    float gyro[3], acce[3];
+
+    config.algorithm = FUSION_MADGWICK;
+    fusion_init(&fusion[0], &config);
+    config.algorithm = FUSION_MAHONY;
+    fusion_init(&fusion[1], &config);
+    roll_sample(10.0f, 5.0f, gyro, acce);
+
+    for (int f = 0; f < 2; f++) {
+        fusion_update(&fusion[f], gyro[0], gyro[1], gyro[2], acce[0], acce[1], acce[2], SAMPLE_DT);
+        bench_t bench;
+        bench_begin(&bench);
+        for (int i = 0; i < BENCH_UPDATES; i++) {
+            fusion_update(&fusion[f], gyro[0], gyro[1], gyro[2], acce[0], acce[1], acce[2], SAMPLE_DT);
+        }
+        double cost = bench_end(&bench) / BENCH_UPDATES;
+        ESP_LOGI(TAG, "%s: %.1f " BENCH_UNIT "/update", f == 0 ? "madgwick" : "mahony", cost);
+#if !CONFIG_IDF_TARGET_LINUX
+        uint32_t cycles = (uint32_t) cost;
+        ESP_LOGI(TAG, "%d sensors at %d Hz take %.1f %% of a %d MHz core", BENCH_SENSORS, SAMPLE_RATE_HZ,
+                 100.0 * cycles * BENCH_SENSORS * SAMPLE_RATE_HZ / (CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1e6),
+                 CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+        /* Fusion must leave most of the core to acquisition and upload */
+        TEST_ASSERT_LESS_THAN_UINT32(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000u / (4u * BENCH_SENSORS * SAMPLE_RATE_HZ), cycles);
+#endif
+        fusion_get_euler(&fusion[f].q, &euler);
+        TEST_ASSERT_FALSE(isnan(euler.roll));
+    }
+}
@@ -25,6 +25,15 @@
 #define JSON_USE_NULLREF 1
 #endif
 
+// If non-zero, the members of objects and arrays are kept in a FlatMap, a
+// sorted vector, instead of a std::map: fewer allocations and bytes per
+// member, but references to a member are only valid until a sibling is
+// inserted or removed. Off by default, as upstream; it changes the layout of
+// Value, so a project turns it on for every component at once.
+#ifndef JSON_USE_FLAT_OBJECTS
+#define JSON_USE_FLAT_OBJECTS 0
+#endif
+
 /// If defined, indicates that the source file is amalgamated
 /// to prevent private header inclusion.
 /// Remarks: it is automatically defined in the generated amalgamated header.
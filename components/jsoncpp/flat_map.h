@@ -0,0 +1,163 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_FLAT_MAP_H_INCLUDED
+#define JSON_FLAT_MAP_H_INCLUDED
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#pragma pack(push)
+#pragma pack()
+
+namespace Json {
+
+/** \brief Sorted vector of key/value pairs with the std::map members that
+ * Value uses.
+ *
+ * Members are contiguous: one allocation per growth instead of one node per
+ * member, and no tree links. Up to linearSearchMax members a linear scan is
+ * cheapest; larger maps are bisected, after checking the last key so that
+ * keys arriving in order, as array indexes and timestamps do, are appended
+ * without a search.
+ *
+ * Unlike std::map, inserting or erasing moves the members after the
+ * position, so references and iterators to members are only valid until the
+ * map changes. Keys must not be modified through an iterator.
+ */
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          typename Alloc = std::allocator<std::pair<Key, T>>>
+class FlatMap {
+public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using key_compare = Compare;
+  using allocator_type = Alloc;
+
+private:
+  using Storage = std::vector<value_type, Alloc>;
+
+public:
+  using size_type = typename Storage::size_type;
+  using iterator = typename Storage::iterator;
+  using const_iterator = typename Storage::const_iterator;
+
+  /// Up to this many members, a linear scan beats bisection.
+  static constexpr size_type linearSearchMax = 8;
+  /// Capacity of the first allocation; later ones double.
+  static constexpr size_type initialCapacity = 2;
+
+  explicit FlatMap(const Alloc& alloc = Alloc()) : items_(alloc) {}
+  FlatMap(const FlatMap& other, const Alloc& alloc)
+      : items_(other.items_, alloc) {}
+
+  iterator begin() noexcept { return items_.begin(); }
+  const_iterator begin() const noexcept { return items_.begin(); }
+  iterator end() noexcept { return items_.end(); }
+  const_iterator end() const noexcept { return items_.end(); }
+
+  size_type size() const noexcept { return items_.size(); }
+  bool empty() const noexcept { return items_.empty(); }
+  void clear() noexcept { items_.clear(); }
+  void reserve(size_type n) { items_.reserve(n); }
+  allocator_type get_allocator() const { return items_.get_allocator(); }
+
+  iterator lower_bound(const Key& key) {
+    return begin() + (lowerBound(key) - items_.cbegin());
+  }
+  const_iterator lower_bound(const Key& key) const { return lowerBound(key); }
+
+  iterator find(const Key& key) {
+    iterator it = lower_bound(key);
+    return it != end() && !less(key, it->first) ? it : end();
+  }
+  const_iterator find(const Key& key) const {
+    const_iterator it = lower_bound(key);
+    return it != end() && !less(key, it->first) ? it : end();
+  }
+
+  /// Inserts at \c hint, which must be lower_bound() of a key not present.
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args) {
+    size_type pos = size_type(hint - items_.cbegin());
+    grow();
+    return items_.emplace(items_.cbegin() + pos, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    value_type item(std::forward<Args>(args)...);
+    iterator it = lower_bound(item.first);
+    if (it != end() && !less(item.first, it->first))
+      return std::make_pair(it, false);
+    return std::make_pair(emplace_hint(it, std::move(item)), true);
+  }
+
+  T& operator[](const Key& key) {
+    iterator it = lower_bound(key);
+    if (it == end() || less(key, it->first))
+      it = emplace_hint(it, std::piecewise_construct,
+                        std::forward_as_tuple(key), std::forward_as_tuple());
+    return it->second;
+  }
+
+  iterator erase(const_iterator pos) { return items_.erase(pos); }
+  size_type erase(const Key& key) {
+    iterator it = find(key);
+    if (it == end())
+      return 0;
+    items_.erase(it);
+    return 1;
+  }
+
+private:
+  static bool less(const Key& a, const Key& b) { return Compare()(a, b); }
+
+  const_iterator lowerBound(const Key& key) const {
+    if (items_.size() <= linearSearchMax) {
+      const_iterator it = items_.begin();
+      while (it != items_.end() && less(it->first, key))
+        ++it;
+      return it;
+    }
+    if (less(items_.back().first, key))
+      return items_.end();
+    return std::lower_bound(
+        items_.begin(), items_.end(), key,
+        [](const value_type& item, const Key& k) {
+          return less(item.first, k);
+        });
+  }
+
+  // Doubles from initialCapacity rather than from 1: one reallocation less,
+  // and with an arena one abandoned buffer less.
+  void grow() {
+    if (items_.size() == items_.capacity())
+      items_.reserve(std::max(initialCapacity, 2 * items_.size()));
+  }
+
+  Storage items_;
+};
+
+template <typename K, typename T, typename C, typename A>
+bool operator==(const FlatMap<K, T, C, A>& a, const FlatMap<K, T, C, A>& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename K, typename T, typename C, typename A>
+bool operator<(const FlatMap<K, T, C, A>& a, const FlatMap<K, T, C, A>& b) {
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_FLAT_MAP_H_INCLUDED
@@ -1471,8 +1471,8 @@ bool OurReader::readObject(Token& token) {
     } else {
       break;
     }
-    if (name.length() >= (1U << 30))
-      throwRuntimeError("keylength >= 2^30");
+    if (name.length() >= (1U << 29))
+      throwRuntimeError("keylength >= 2^29");
     if (features_.rejectDupKeys_ && currentValue().isMember(name)) {
       String msg = "Duplicate key: '" + name + "'";
       return addErrorAndRecover(msg, tokenName, tokenObjectEnd);
@@ -15,6 +15,7 @@
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <tuple>
 #include <utility>
 
 // Provide implementation equivalent of std::snprintf for older _MSC compilers
@@ -112,13 +113,17 @@ static inline bool InRange(double d, T min, U max) {
  *               computed using strlen(value).
  * @return Pointer on the duplicate instance of string.
  */
-static inline char* duplicateStringValue(const char* value, size_t length) {
+static inline char* duplicateStringValue(const char* value, size_t length,
+                                         bool* inArena) {
   // Avoid an integer overflow in the call to malloc below by limiting length
   // to a sane value.
   if (length >= static_cast<size_t>(Value::maxInt))
     length = Value::maxInt - 1;
 
-  auto newString = static_cast<char*>(malloc(length + 1));
+  Arena* arena = Arena::current();
+  *inArena = arena != nullptr;
+  auto newString = static_cast<char*>(arena ? arena->allocate(length + 1)
+                                            : malloc(length + 1));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateStringValue(): "
                       "Failed to allocate string value buffer");
@@ -131,7 +136,8 @@ static inline char* duplicateStringValue(const char* value, size_t length) {
 /* Record the length as a prefix.
  */
 static inline char* duplicateAndPrefixStringValue(const char* value,
-                                                  unsigned int length) {
+                                                  unsigned int length,
+                                                  bool* inArena) {
   // Avoid an integer overflow in the call to malloc below by limiting length
   // to a sane value.
   JSON_ASSERT_MESSAGE(length <= static_cast<unsigned>(Value::maxInt) -
@@ -139,7 +145,10 @@ static inline char* duplicateAndPrefixStringValue(const char* value,
                       "in Json::Value::duplicateAndPrefixStringValue(): "
                       "length too big for prefixing");
   size_t actualLength = sizeof(length) + length + 1;
-  auto newString = static_cast<char*>(malloc(actualLength));
+  Arena* arena = Arena::current();
+  *inArena = arena != nullptr;
+  auto newString = static_cast<char*>(arena ? arena->allocate(actualLength)
+                                            : malloc(actualLength));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateAndPrefixStringValue(): "
                       "Failed to allocate string value buffer");
@@ -183,6 +192,105 @@ static inline void releasePrefixedStringValue(char* value) { free(value); }
 static inline void releaseStringValue(char* value, unsigned) { free(value); }
 #endif // JSONCPP_USING_SECURE_MEMORY
 
+// //////////////////////////////////////////////////////////////////
+// class Arena
+// //////////////////////////////////////////////////////////////////
+
+struct Arena::Block {
+  Block* next;
+  size_t size;
+  size_t used;
+};
+
+static thread_local Arena* currentArena = nullptr;
+
+static const size_t arenaAlign = alignof(std::max_align_t);
+
+// Block header rounded up so the data after it is aligned
+size_t Arena::headerSize() {
+  return (sizeof(Block) + arenaAlign - 1) & ~(arenaAlign - 1);
+}
+
+Arena::Arena(size_t blockSize)
+    : head_(nullptr), blockSize_(blockSize > 0 ? blockSize : 4096), used_(0),
+      allocations_(0), blocks_(0) {}
+
+Arena::~Arena() {
+  JSON_ASSERT_MESSAGE(currentArena != this,
+                      "in Json::Arena::~Arena(): still in an ArenaScope");
+  while (head_) {
+    Block* next = head_->next;
+    free(head_);
+    head_ = next;
+  }
+}
+
+Arena::Block* Arena::newBlock(size_t size) {
+  auto block = static_cast<Block*>(malloc(headerSize() + size));
+  if (block == nullptr) {
+    throwRuntimeError("in Json::Arena::allocate(): "
+                      "Failed to allocate an arena block");
+  }
+  block->size = size;
+  block->used = 0;
+  blocks_++;
+  return block;
+}
+
+void* Arena::allocate(size_t size) {
+  size = (size + arenaAlign - 1) & ~(arenaAlign - 1);
+  used_ += size;
+  allocations_++;
+  if (size > blockSize_ / 4) {
+    // Own block, linked behind the current one so that one stays in use
+    Block* block = newBlock(size);
+    block->used = size;
+    if (head_) {
+      block->next = head_->next;
+      head_->next = block;
+    } else {
+      block->next = nullptr;
+      head_ = block;
+    }
+    return reinterpret_cast<char*>(block) + headerSize();
+  }
+  if (!head_ || head_->size - head_->used < size) {
+    Block* block = newBlock(blockSize_);
+    block->next = head_;
+    head_ = block;
+  }
+  void* p = reinterpret_cast<char*>(head_) + headerSize() + head_->used;
+  head_->used += size;
+  return p;
+}
+
+void Arena::reset() {
+  Block* keep = nullptr;
+  while (head_) {
+    Block* next = head_->next;
+    if (!keep && head_->size == blockSize_) {
+      keep = head_;
+      keep->next = nullptr;
+      keep->used = 0;
+    } else {
+      free(head_);
+      blocks_--;
+    }
+    head_ = next;
+  }
+  head_ = keep;
+  used_ = 0;
+  allocations_ = 0;
+}
+
+Arena* Arena::current() { return currentArena; }
+
+ArenaScope::ArenaScope(Arena& arena) : previous_(currentArena) {
+  currentArena = &arena;
+}
+
+ArenaScope::~ArenaScope() { currentArena = previous_; }
+
 } // namespace Json
 
 // //////////////////////////////////////////////////////////////////
@@ -230,78 +338,85 @@ JSONCPP_NORETURN void throwLogicError(String const& msg) {
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 
-// Notes: policy_ indicates if the string was allocated when
+// Notes: the mode indicates if the string was allocated when
 // a string is stored.
 
-Value::CZString::CZString(ArrayIndex index) : cstr_(nullptr), index_(index) {}
+Value::CZString::CZString(ArrayIndex index)
+    : cstr_(nullptr), info_(unsigned(indexKey) << modeShift) {
+  index_ = index;
+}
 
+// A short key is copied inline whatever the policy: that is cheaper than a
+// later duplication, and comparing two inline keys is one memcmp.
 Value::CZString::CZString(char const* str, unsigned length,
                           DuplicationPolicy allocate)
     : cstr_(str) {
-  // allocate != duplicate
-  storage_.policy_ = allocate & 0x3;
-  storage_.length_ = length & 0x3FFFFFFF;
-}
-
-Value::CZString::CZString(const CZString& other) {
-  cstr_ = (other.storage_.policy_ != noDuplication && other.cstr_ != nullptr
-               ? duplicateStringValue(other.cstr_, other.storage_.length_)
-               : other.cstr_);
-  storage_.policy_ =
-      static_cast<unsigned>(
-          other.cstr_
-              ? (static_cast<DuplicationPolicy>(other.storage_.policy_) ==
-                         noDuplication
-                     ? noDuplication
-                     : duplicate)
-              : static_cast<DuplicationPolicy>(other.storage_.policy_)) &
-      3U;
-  storage_.length_ = other.storage_.length_;
+  if (length <= inlineCapacity &&
+      (length == 0 || memchr(str, 0, length) == nullptr)) {
+    cstr_ = nullptr;
+    info_ = 0;
+    memcpy(static_cast<void*>(this), str, length);
+    return;
+  }
+  info_ = (length & lengthMask) |
+          ((unsigned(allocate) + staticKey) << modeShift);
+}
+
+Value::CZString::CZString(const CZString& other)
+    : cstr_(other.cstr_), info_(other.info_) {
+  Mode otherMode = other.mode();
+  if (otherMode == ownedKey || otherMode == borrowedKey ||
+      otherMode == arenaKey) {
+    bool inArena = false;
+    cstr_ = duplicateStringValue(other.cstr_, length(), &inArena);
+    info_ = (info_ & lengthMask) |
+            (unsigned(inArena ? arenaKey : ownedKey) << modeShift);
+  }
 }
 
 Value::CZString::CZString(CZString&& other) noexcept
-    : cstr_(other.cstr_), index_(other.index_) {
-  other.cstr_ = nullptr;
+    : cstr_(other.cstr_), info_(other.info_) {
+  other.info_ = unsigned(indexKey) << modeShift;
 }
 
 Value::CZString::~CZString() {
-  if (cstr_ && storage_.policy_ == duplicate) {
+  if (mode() == ownedKey) {
     releaseStringValue(const_cast<char*>(cstr_),
-                       storage_.length_ + 1U); // +1 for null terminating
-                                               // character for sake of
-                                               // completeness but not actually
-                                               // necessary
+                       length() + 1U); // +1 for null terminating
+                                       // character for sake of
+                                       // completeness but not actually
+                                       // necessary
   }
 }
 
 void Value::CZString::swap(CZString& other) {
   std::swap(cstr_, other.cstr_);
-  std::swap(index_, other.index_);
+  std::swap(info_, other.info_);
 }
 
+// Keys are assigned when FlatMap moves members around: the string this one
+// owned goes to other, to be freed with it.
 Value::CZString& Value::CZString::operator=(const CZString& other) {
-  cstr_ = other.cstr_;
-  index_ = other.index_;
+  CZString(other).swap(*this);
   return *this;
 }
 
 Value::CZString& Value::CZString::operator=(CZString&& other) noexcept {
-  cstr_ = other.cstr_;
-  index_ = other.index_;
-  other.cstr_ = nullptr;
+  swap(other);
   return *this;
 }
 
 bool Value::CZString::operator<(const CZString& other) const {
-  if (!cstr_)
+  if (mode() == indexKey)
     return index_ < other.index_;
-  // return strcmp(cstr_, other.cstr_) < 0;
+  // Zero padded, so byte order is string order
+  if (mode() == inlineKey && other.mode() == inlineKey)
+    return memcmp(inlineData(), other.inlineData(), inlineCapacity) < 0;
   // Assume both are strings.
-  unsigned this_len = this->storage_.length_;
-  unsigned other_len = other.storage_.length_;
+  unsigned this_len = this->length();
+  unsigned other_len = other.length();
   unsigned min_len = std::min<unsigned>(this_len, other_len);
-  JSON_ASSERT(this->cstr_ && other.cstr_);
-  int comp = memcmp(this->cstr_, other.cstr_, min_len);
+  int comp = memcmp(this->data(), other.data(), min_len);
   if (comp < 0)
     return true;
   if (comp > 0)
@@ -310,27 +425,43 @@ bool Value::CZString::operator<(const CZString& other) const {
 }
 
 bool Value::CZString::operator==(const CZString& other) const {
-  if (!cstr_)
+  if (mode() == indexKey)
     return index_ == other.index_;
-  // return strcmp(cstr_, other.cstr_) == 0;
+  if (mode() == inlineKey && other.mode() == inlineKey)
+    return memcmp(inlineData(), other.inlineData(), inlineCapacity) == 0;
   // Assume both are strings.
-  unsigned this_len = this->storage_.length_;
-  unsigned other_len = other.storage_.length_;
+  unsigned this_len = this->length();
+  unsigned other_len = other.length();
   if (this_len != other_len)
     return false;
-  JSON_ASSERT(this->cstr_ && other.cstr_);
-  int comp = memcmp(this->cstr_, other.cstr_, this_len);
+  int comp = memcmp(this->data(), other.data(), this_len);
   return comp == 0;
 }
 
 ArrayIndex Value::CZString::index() const { return index_; }
 
 // const char* Value::CZString::c_str() const { return cstr_; }
-const char* Value::CZString::data() const { return cstr_; }
-unsigned Value::CZString::length() const { return storage_.length_; }
-bool Value::CZString::isStaticString() const {
-  return storage_.policy_ == noDuplication;
+const char* Value::CZString::data() const {
+  switch (mode()) {
+  case inlineKey:
+    return inlineData();
+  case indexKey:
+    return nullptr;
+  default:
+    return cstr_;
+  }
+}
+unsigned Value::CZString::length() const {
+  switch (mode()) {
+  case inlineKey:
+    return unsigned(strlen(inlineData()));
+  case indexKey:
+    return 0;
+  default:
+    return info_ & lengthMask;
+  }
 }
+bool Value::CZString::isStaticString() const { return mode() == staticKey; }
 
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -363,7 +494,7 @@ Value::Value(ValueType type) {
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues();
+    newMap(nullptr);
     break;
   case booleanValue:
     value_.bool_ = false;
@@ -402,20 +533,17 @@ Value::Value(const char* value) {
   initBasic(stringValue, true);
   JSON_ASSERT_MESSAGE(value != nullptr,
                       "Null Value Passed to Value Constructor");
-  value_.string_ = duplicateAndPrefixStringValue(
-      value, static_cast<unsigned>(strlen(value)));
+  newString(value, static_cast<unsigned>(strlen(value)));
 }
 
 Value::Value(const char* begin, const char* end) {
   initBasic(stringValue, true);
-  value_.string_ =
-      duplicateAndPrefixStringValue(begin, static_cast<unsigned>(end - begin));
+  newString(begin, static_cast<unsigned>(end - begin));
 }
 
 Value::Value(const String& value) {
   initBasic(stringValue, true);
-  value_.string_ = duplicateAndPrefixStringValue(
-      value.data(), static_cast<unsigned>(value.length()));
+  newString(value.data(), static_cast<unsigned>(value.length()));
 }
 
 Value::Value(const StaticString& value) {
@@ -503,17 +631,15 @@ bool Value::operator<(const Value& other) const {
   case booleanValue:
     return value_.bool_ < other.value_.bool_;
   case stringValue: {
-    if ((value_.string_ == nullptr) || (other.value_.string_ == nullptr)) {
-      return other.value_.string_ != nullptr;
-    }
     unsigned this_len;
     unsigned other_len;
     char const* this_str;
     char const* other_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
-    decodePrefixedString(other.isAllocated(), other.value_.string_, &other_len,
-                         &other_str);
+    bool has_this = stringData(&this_str, &this_len);
+    bool has_other = other.stringData(&other_str, &other_len);
+    if (!has_this || !has_other) {
+      return has_other;
+    }
     unsigned min_len = std::min<unsigned>(this_len, other_len);
     JSON_ASSERT(this_str && other_str);
     int comp = memcmp(this_str, other_str, min_len);
@@ -558,17 +684,15 @@ bool Value::operator==(const Value& other) const {
   case booleanValue:
     return value_.bool_ == other.value_.bool_;
   case stringValue: {
-    if ((value_.string_ == nullptr) || (other.value_.string_ == nullptr)) {
-      return (value_.string_ == other.value_.string_);
-    }
     unsigned this_len;
     unsigned other_len;
     char const* this_str;
     char const* other_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
-    decodePrefixedString(other.isAllocated(), other.value_.string_, &other_len,
-                         &other_str);
+    bool has_this = stringData(&this_str, &this_len);
+    bool has_other = other.stringData(&other_str, &other_len);
+    if (!has_this || !has_other) {
+      return has_this == has_other;
+    }
     if (this_len != other_len)
       return false;
     JSON_ASSERT(this_str && other_str);
@@ -590,12 +714,10 @@ bool Value::operator!=(const Value& other) const { return !(*this == other); }
 const char* Value::asCString() const {
   JSON_ASSERT_MESSAGE(type() == stringValue,
                       "in Json::Value::asCString(): requires stringValue");
-  if (value_.string_ == nullptr)
-    return nullptr;
   unsigned this_len;
   char const* this_str;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                       &this_str);
+  if (!stringData(&this_str, &this_len))
+    return nullptr;
   return this_str;
 }
 
@@ -603,12 +725,10 @@ const char* Value::asCString() const {
 unsigned Value::getCStringLength() const {
   JSON_ASSERT_MESSAGE(type() == stringValue,
                       "in Json::Value::asCString(): requires stringValue");
-  if (value_.string_ == 0)
-    return 0;
   unsigned this_len;
   char const* this_str;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                       &this_str);
+  if (!stringData(&this_str, &this_len))
+    return 0;
   return this_len;
 }
 #endif
@@ -616,11 +736,9 @@ unsigned Value::getCStringLength() const {
 bool Value::getString(char const** begin, char const** end) const {
   if (type() != stringValue)
     return false;
-  if (value_.string_ == nullptr)
-    return false;
   unsigned length;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &length,
-                       begin);
+  if (!stringData(begin, &length))
+    return false;
   *end = *begin + length;
   return true;
 }
@@ -630,12 +748,10 @@ String Value::asString() const {
   case nullValue:
     return "";
   case stringValue: {
-    if (value_.string_ == nullptr)
-      return "";
     unsigned this_len;
     char const* this_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
+    if (!stringData(&this_str, &this_len))
+      return "";
     return String(this_str, this_len);
   }
   case booleanValue:
@@ -933,8 +1049,9 @@ Value& Value::operator[](ArrayIndex index) {
   if (it != value_.map_->end() && (*it).first == key)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(key, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->emplace_hint(it, std::piecewise_construct,
+                                 std::forward_as_tuple(key),
+                                 std::forward_as_tuple());
   return (*it).second;
 }
 
@@ -968,14 +1085,68 @@ const Value& Value::operator[](int index) const {
 void Value::initBasic(ValueType type, bool allocated) {
   setType(type);
   setIsAllocated(allocated);
+  bits_.arena_ = false;
+  bits_.inline_ = false;
   comments_ = Comments{};
   start_ = 0;
   limit_ = 0;
 }
 
+// The member storage, and every node it allocates later, comes from the arena
+// current at its creation.
+void Value::newMap(const ObjectValues* other) {
+  Arena* arena = Arena::current();
+  ArenaAllocator<ObjectValues::value_type> allocator(arena);
+  void* storage = arena ? arena->allocate(sizeof(ObjectValues))
+                        : ::operator new(sizeof(ObjectValues));
+  value_.map_ = other ? new (storage) ObjectValues(*other, allocator)
+                      : new (storage) ObjectValues(allocator);
+  bits_.arena_ = arena != nullptr;
+}
+
+void Value::newString(const char* value, unsigned length) {
+  static_assert(inlineStringMax < (1U << 3), "inlineLength_ is too narrow");
+  if (length <= inlineStringMax) {
+    memcpy(value_.chars_, value, length);
+    value_.chars_[length] = 0;
+    setIsAllocated(false);
+    bits_.arena_ = false;
+    bits_.inline_ = true;
+    bits_.inlineLength_ = length;
+    return;
+  }
+  bool inArena;
+  value_.string_ = duplicateAndPrefixStringValue(value, length, &inArena);
+  setIsAllocated(true);
+  bits_.arena_ = inArena;
+}
+
+// Data and length of a string value wherever it is held; false for the null
+// string of a default StaticString.
+bool Value::stringData(char const** str, unsigned* length) const {
+  if (bits_.inline_) {
+    *str = value_.chars_;
+    *length = bits_.inlineLength_;
+    return true;
+  }
+  if (value_.string_ == nullptr)
+    return false;
+  decodePrefixedString(isAllocated(), value_.string_, length, str);
+  return true;
+}
+
+void Value::abandonArena() {
+  if (bits_.arena_)
+    initBasic(nullValue);
+  else
+    *this = Value();
+}
+
 void Value::dupPayload(const Value& other) {
   setType(other.type());
   setIsAllocated(false);
+  bits_.arena_ = false;
+  bits_.inline_ = false;
   switch (type()) {
   case nullValue:
   case intValue:
@@ -985,20 +1156,19 @@ void Value::dupPayload(const Value& other) {
     value_ = other.value_;
     break;
   case stringValue:
-    if (other.value_.string_ && other.isAllocated()) {
+    if (other.bits_.inline_ ||
+        (other.value_.string_ && other.isAllocated())) {
       unsigned len;
       char const* str;
-      decodePrefixedString(other.isAllocated(), other.value_.string_, &len,
-                           &str);
-      value_.string_ = duplicateAndPrefixStringValue(str, len);
-      setIsAllocated(true);
+      other.stringData(&str, &len);
+      newString(str, len);
     } else {
       value_.string_ = other.value_.string_;
     }
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    newMap(other.value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -1014,12 +1184,15 @@ void Value::releasePayload() {
   case booleanValue:
     break;
   case stringValue:
-    if (isAllocated())
+    if (isAllocated() && !bits_.arena_)
       releasePrefixedStringValue(value_.string_);
     break;
   case arrayValue:
   case objectValue:
-    delete value_.map_;
+    if (bits_.arena_)
+      value_.map_->~ObjectValues();
+    else
+      delete value_.map_;
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -1047,8 +1220,9 @@ Value& Value::resolveReference(const char* key) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->emplace_hint(it, std::piecewise_construct,
+                                 std::forward_as_tuple(actualKey),
+                                 std::forward_as_tuple());
   Value& value = (*it).second;
   return value;
 }
@@ -1066,8 +1240,9 @@ Value& Value::resolveReference(char const* key, char const* end) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->emplace_hint(it, std::piecewise_construct,
+                                 std::forward_as_tuple(actualKey),
+                                 std::forward_as_tuple());
   Value& value = (*it).second;
   return value;
 }
@@ -1145,6 +1320,9 @@ bool Value::insert(ArrayIndex index, Value&& newValue) {
   if (index > length) {
     return false;
   }
+  // Add the last slot first: a new member may move the others, and the moves
+  // below hold a reference to one across the lookup of the next.
+  (*this)[length];
   for (ArrayIndex i = length; i > index; i--) {
     (*this)[i] = std::move((*this)[i - 1]);
   }
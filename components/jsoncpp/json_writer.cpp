@@ -12,9 +12,11 @@
 #include <cctype>
 #include <cstring>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <set>
 #include <sstream>
+#include <type_traits>
 #include <utility>
 
 #if __cplusplus >= 201103L
@@ -124,6 +126,459 @@ String valueToString(UInt value) { return valueToString(LargestUInt(value)); }
 #endif // # if defined(JSON_HAS_INT64)
 
 namespace {
+
+// Shortest round-trip formatting of doubles and floats: Grisu2 (Florian
+// Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers", PLDI 2010), with the boundaries and digit generation of Milo
+// Yip's and Niels Lohmann's implementations. The digits always read back as
+// the same number and are the shortest such digits for all but a few inputs,
+// where a longer text that still reads back the same is written. No floating
+// point arithmetic and no snprintf.
+
+struct DiyFp {
+  std::uint64_t f;
+  int e;
+
+  DiyFp(std::uint64_t f_, int e_) : f(f_), e(e_) {}
+
+  // Upper 64 bits of the 128-bit product, rounded.
+  static DiyFp mul(DiyFp x, DiyFp y) {
+    const std::uint64_t xLo = x.f & 0xFFFFFFFFU, xHi = x.f >> 32;
+    const std::uint64_t yLo = y.f & 0xFFFFFFFFU, yHi = y.f >> 32;
+    const std::uint64_t lo = xLo * yLo, mid1 = xLo * yHi, mid2 = xHi * yLo,
+                        hi = xHi * yHi;
+    std::uint64_t carry =
+        (lo >> 32) + (mid1 & 0xFFFFFFFFU) + (mid2 & 0xFFFFFFFFU);
+    carry += std::uint64_t(1) << 31;
+    return DiyFp(hi + (mid1 >> 32) + (mid2 >> 32) + (carry >> 32),
+                 x.e + y.e + 64);
+  }
+
+  static DiyFp normalize(DiyFp x) {
+    while ((x.f >> 63) == 0) {
+      x.f <<= 1;
+      x.e--;
+    }
+    return x;
+  }
+};
+
+// The value and the midpoints to its neighbours, normalized to a common
+// exponent. Computed with the precision of Float, so that a float gets the
+// digits of a float.
+struct Boundaries {
+  DiyFp w, minus, plus;
+};
+
+template <typename Float> Boundaries computeBoundaries(Float value) {
+  static_assert(std::numeric_limits<Float>::is_iec559,
+                "IEEE 754 floating point required");
+  constexpr int precision = std::numeric_limits<Float>::digits;
+  constexpr int bias =
+      std::numeric_limits<Float>::max_exponent - 1 + (precision - 1);
+  constexpr int minExponent = 1 - bias;
+  constexpr std::uint64_t hiddenBit = std::uint64_t(1) << (precision - 1);
+  using Bits = typename std::conditional<precision == 24, std::uint32_t,
+                                         std::uint64_t>::type;
+
+  Bits bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const std::uint64_t biasedExponent = bits >> (precision - 1);
+  const std::uint64_t fraction = bits & (hiddenBit - 1);
+
+  const DiyFp v = biasedExponent == 0
+                      ? DiyFp(fraction, minExponent)
+                      : DiyFp(fraction + hiddenBit,
+                              static_cast<int>(biasedExponent) - bias);
+  // At a power of two the neighbour below is twice as close.
+  const bool lowerCloser = fraction == 0 && biasedExponent > 1;
+  const DiyFp plus(2 * v.f + 1, v.e - 1);
+  const DiyFp minus = lowerCloser ? DiyFp(4 * v.f - 1, v.e - 2)
+                                  : DiyFp(2 * v.f - 1, v.e - 1);
+
+  const DiyFp wPlus = DiyFp::normalize(plus);
+  const DiyFp wMinus(minus.f << (minus.e - wPlus.e), wPlus.e);
+  return {DiyFp::normalize(v), wMinus, wPlus};
+}
+
+// Scaling by a cached power of ten brings the binary exponent into
+// [minScaledExponent, maxScaledExponent], where the integral part fits 32
+// bits.
+constexpr int minScaledExponent = -60;
+constexpr int maxScaledExponent = -32;
+
+struct CachedPower {
+  std::uint64_t f;
+  int e;
+  int k;
+};
+
+// 10^k for k = -300, -292, ..., 324, normalized and rounded to 64 bits.
+CachedPower cachedPowerFor(int e) {
+  static const CachedPower powers[] = {
+        {0xAB70FE17C79AC6CA, -1060, -300},
+        {0xFF77B1FCBEBCDC4F, -1034, -292},
+        {0xBE5691EF416BD60C, -1007, -284},
+        {0x8DD01FAD907FFC3C, -980, -276},
+        {0xD3515C2831559A83, -954, -268},
+        {0x9D71AC8FADA6C9B5, -927, -260},
+        {0xEA9C227723EE8BCB, -901, -252},
+        {0xAECC49914078536D, -874, -244},
+        {0x823C12795DB6CE57, -847, -236},
+        {0xC21094364DFB5637, -821, -228},
+        {0x9096EA6F3848984F, -794, -220},
+        {0xD77485CB25823AC7, -768, -212},
+        {0xA086CFCD97BF97F4, -741, -204},
+        {0xEF340A98172AACE5, -715, -196},
+        {0xB23867FB2A35B28E, -688, -188},
+        {0x84C8D4DFD2C63F3B, -661, -180},
+        {0xC5DD44271AD3CDBA, -635, -172},
+        {0x936B9FCEBB25C996, -608, -164},
+        {0xDBAC6C247D62A584, -582, -156},
+        {0xA3AB66580D5FDAF6, -555, -148},
+        {0xF3E2F893DEC3F126, -529, -140},
+        {0xB5B5ADA8AAFF80B8, -502, -132},
+        {0x87625F056C7C4A8B, -475, -124},
+        {0xC9BCFF6034C13053, -449, -116},
+        {0x964E858C91BA2655, -422, -108},
+        {0xDFF9772470297EBD, -396, -100},
+        {0xA6DFBD9FB8E5B88F, -369, -92},
+        {0xF8A95FCF88747D94, -343, -84},
+        {0xB94470938FA89BCF, -316, -76},
+        {0x8A08F0F8BF0F156B, -289, -68},
+        {0xCDB02555653131B6, -263, -60},
+        {0x993FE2C6D07B7FAC, -236, -52},
+        {0xE45C10C42A2B3B06, -210, -44},
+        {0xAA242499697392D3, -183, -36},
+        {0xFD87B5F28300CA0E, -157, -28},
+        {0xBCE5086492111AEB, -130, -20},
+        {0x8CBCCC096F5088CC, -103, -12},
+        {0xD1B71758E219652C, -77, -4},
+        {0x9C40000000000000, -50, 4},
+        {0xE8D4A51000000000, -24, 12},
+        {0xAD78EBC5AC620000, 3, 20},
+        {0x813F3978F8940984, 30, 28},
+        {0xC097CE7BC90715B3, 56, 36},
+        {0x8F7E32CE7BEA5C70, 83, 44},
+        {0xD5D238A4ABE98068, 109, 52},
+        {0x9F4F2726179A2245, 136, 60},
+        {0xED63A231D4C4FB27, 162, 68},
+        {0xB0DE65388CC8ADA8, 189, 76},
+        {0x83C7088E1AAB65DB, 216, 84},
+        {0xC45D1DF942711D9A, 242, 92},
+        {0x924D692CA61BE758, 269, 100},
+        {0xDA01EE641A708DEA, 295, 108},
+        {0xA26DA3999AEF774A, 322, 116},
+        {0xF209787BB47D6B85, 348, 124},
+        {0xB454E4A179DD1877, 375, 132},
+        {0x865B86925B9BC5C2, 402, 140},
+        {0xC83553C5C8965D3D, 428, 148},
+        {0x952AB45CFA97A0B3, 455, 156},
+        {0xDE469FBD99A05FE3, 481, 164},
+        {0xA59BC234DB398C25, 508, 172},
+        {0xF6C69A72A3989F5C, 534, 180},
+        {0xB7DCBF5354E9BECE, 561, 188},
+        {0x88FCF317F22241E2, 588, 196},
+        {0xCC20CE9BD35C78A5, 614, 204},
+        {0x98165AF37B2153DF, 641, 212},
+        {0xE2A0B5DC971F303A, 667, 220},
+        {0xA8D9D1535CE3B396, 694, 228},
+        {0xFB9B7CD9A4A7443C, 720, 236},
+        {0xBB764C4CA7A44410, 747, 244},
+        {0x8BAB8EEFB6409C1A, 774, 252},
+        {0xD01FEF10A657842C, 800, 260},
+        {0x9B10A4E5E9913129, 827, 268},
+        {0xE7109BFBA19C0C9D, 853, 276},
+        {0xAC2820D9623BF429, 880, 284},
+        {0x80444B5E7AA7CF85, 907, 292},
+        {0xBF21E44003ACDD2D, 933, 300},
+        {0x8E679C2F5E44FF8F, 960, 308},
+        {0xD433179D9C8CB841, 986, 316},
+        {0x9E19DB92B4E31BA9, 1013, 324},
+  };
+  constexpr int minDecimalExponent = -300;
+  constexpr int decimalExponentStep = 8;
+
+  // ceil((minScaledExponent - e - 1) * log10(2))
+  const int f = minScaledExponent - e - 1;
+  const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+  const int index = (-minDecimalExponent + k + (decimalExponentStep - 1)) /
+                    decimalExponentStep;
+  assert(index >= 0 &&
+         static_cast<size_t>(index) < sizeof(powers) / sizeof(powers[0]));
+  const CachedPower cached = powers[index];
+  assert(minScaledExponent <= cached.e + e + 64 &&
+         cached.e + e + 64 <= maxScaledExponent);
+  return cached;
+}
+
+// Number of decimal digits of n, and the largest power of ten <= n.
+int largestPow10(std::uint32_t n, std::uint32_t& pow10) {
+  static const std::uint32_t powers[] = {
+      1000000000U, 100000000U, 10000000U, 1000000U, 100000U,
+      10000U,      1000U,      100U,      10U,      1U};
+  int digits = 10;
+  const std::uint32_t* p = powers;
+  while (digits > 1 && n < *p) {
+    --digits;
+    ++p;
+  }
+  pow10 = *p;
+  return digits;
+}
+
+// Moves the last digit down while that brings it closer to w and stays in
+// the range.
+void roundWeed(char* digits, int length, std::uint64_t dist,
+               std::uint64_t delta, std::uint64_t rest, std::uint64_t tenK) {
+  while (rest < dist && delta - rest >= tenK &&
+         (rest + tenK < dist || dist - rest > rest + tenK - dist)) {
+    digits[length - 1]--;
+    rest += tenK;
+  }
+}
+
+// Generates the digits of mPlus until they are inside (mMinus, mPlus).
+void generateDigits(char* digits, int& length, int& exponent, DiyFp mMinus,
+                    DiyFp w, DiyFp mPlus) {
+  std::uint64_t delta = mPlus.f - mMinus.f;
+  std::uint64_t dist = mPlus.f - w.f;
+
+  const int shift = -mPlus.e;
+  const std::uint64_t one = std::uint64_t(1) << shift;
+  std::uint32_t integral = static_cast<std::uint32_t>(mPlus.f >> shift);
+  std::uint64_t fractional = mPlus.f & (one - 1);
+
+  std::uint32_t pow10;
+  int n = largestPow10(integral, pow10);
+  while (n > 0) {
+    const std::uint32_t d = integral / pow10;
+    integral %= pow10;
+    digits[length++] = static_cast<char>('0' + d);
+    --n;
+    const std::uint64_t rest =
+        (static_cast<std::uint64_t>(integral) << shift) + fractional;
+    if (rest <= delta) {
+      exponent += n;
+      roundWeed(digits, length, dist, delta, rest,
+                static_cast<std::uint64_t>(pow10) << shift);
+      return;
+    }
+    pow10 /= 10;
+  }
+
+  int m = 0;
+  for (;;) {
+    fractional *= 10;
+    digits[length++] = static_cast<char>('0' + (fractional >> shift));
+    fractional &= one - 1;
+    ++m;
+    delta *= 10;
+    dist *= 10;
+    if (fractional <= delta)
+      break;
+  }
+  exponent -= m;
+  roundWeed(digits, length, dist, delta, fractional, one);
+}
+
+// Digits of a finite value > 0: value == digits * 10^exponent.
+template <typename Float>
+void grisu2(char* digits, int& length, int& exponent, Float value) {
+  const Boundaries b = computeBoundaries(value);
+  const CachedPower cached = cachedPowerFor(b.plus.e);
+  const DiyFp c(cached.f, cached.e);
+
+  const DiyFp w = DiyFp::mul(b.w, c);
+  const DiyFp wMinus = DiyFp::mul(b.minus, c);
+  const DiyFp wPlus = DiyFp::mul(b.plus, c);
+  // The products are off by up to one unit: stay on the safe side.
+  const DiyFp mMinus(wMinus.f + 1, wMinus.e);
+  const DiyFp mPlus(wPlus.f - 1, wPlus.e);
+
+  length = 0;
+  exponent = -cached.k;
+  generateDigits(digits, length, exponent, mMinus, w, mPlus);
+}
+
+// Writes a finite value > 0 with the shortest digits, laid out as "%.17g"
+// would: exponential below 1e-4 and from 1e17 on, and ".0" after integers.
+template <typename Float> char* writeShortest(char* out, Float value) {
+  char digits[20];
+  int length;
+  int exponent;
+  grisu2(digits, length, exponent, value);
+  // Digits before the decimal point.
+  const int point = length + exponent;
+
+  if (point < -3 || point > 17) {
+    *out++ = digits[0];
+    if (length > 1) {
+      *out++ = '.';
+      std::memcpy(out, digits + 1, static_cast<size_t>(length - 1));
+      out += length - 1;
+    }
+    int e = point - 1;
+    *out++ = 'e';
+    *out++ = e < 0 ? '-' : '+';
+    e = e < 0 ? -e : e;
+    if (e >= 100)
+      *out++ = static_cast<char>('0' + e / 100);
+    *out++ = static_cast<char>('0' + e / 10 % 10);
+    *out++ = static_cast<char>('0' + e % 10);
+  } else if (point <= 0) {
+    *out++ = '0';
+    *out++ = '.';
+    std::memset(out, '0', static_cast<size_t>(-point));
+    out += -point;
+    std::memcpy(out, digits, static_cast<size_t>(length));
+    out += length;
+  } else if (point < length) {
+    std::memcpy(out, digits, static_cast<size_t>(point));
+    out += point;
+    *out++ = '.';
+    std::memcpy(out, digits + point, static_cast<size_t>(length - point));
+    out += length - point;
+  } else {
+    std::memcpy(out, digits, static_cast<size_t>(length));
+    out += length;
+    std::memset(out, '0', static_cast<size_t>(point - length));
+    out += point - length;
+    *out++ = '.';
+    *out++ = '0';
+  }
+  return out;
+}
+
+// Shortest text that reads back as value, or as the same float when asFloat
+// and value is one.
+String shortestToString(double value, bool asFloat) {
+  char buffer[32];
+  char* end = buffer;
+  if (std::signbit(value)) {
+    *end++ = '-';
+    value = -value;
+  }
+  if (value == 0) {
+    *end++ = '0';
+    *end++ = '.';
+    *end++ = '0';
+  } else if (asFloat && value <= std::numeric_limits<float>::max() &&
+             static_cast<double>(static_cast<float>(value)) == value) {
+    end = writeShortest(end, static_cast<float>(value));
+  } else {
+    end = writeShortest(end, value);
+  }
+  return String(buffer, end);
+}
+
+// Most places fixedToString() writes; the digits of 5^17 still fit 40 bits.
+constexpr unsigned int fixedDecimalsMax = 17;
+
+// Bit i of the 128-bit hi:lo.
+bool bitAt(std::uint64_t hi, std::uint64_t lo, int i) {
+  return i >= 128 ? false
+         : i >= 64 ? ((hi >> (i - 64)) & 1) != 0
+                   : ((lo >> i) & 1) != 0;
+}
+
+// Whether any of the bits below i of hi:lo is set.
+bool anyBelow(std::uint64_t hi, std::uint64_t lo, int i) {
+  if (i >= 128)
+    return hi != 0 || lo != 0;
+  if (i > 64)
+    return lo != 0 || (hi & ((std::uint64_t(1) << (i - 64)) - 1)) != 0;
+  return i == 64 ? lo != 0 : (lo & ((std::uint64_t(1) << i) - 1)) != 0;
+}
+
+// Writes value rounded to decimals places, as "%.*f" followed by
+// fixZerosInTheEnd() did: trailing zeros dropped but the one after the
+// point, no point at all for 0 places. Rounding is exact, ties to even as
+// printf does, with integer arithmetic only. Needs |value| < 2^53 and
+// decimals <= fixedDecimalsMax.
+String fixedToString(double value, unsigned int decimals) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const int biasedExponent = static_cast<int>((bits >> 52) & 0x7FF);
+  std::uint64_t significand = bits & ((std::uint64_t(1) << 52) - 1);
+  // value == significand / 2^shift
+  int shift = 1074;
+  if (biasedExponent != 0) {
+    significand |= std::uint64_t(1) << 52;
+    shift = 1075 - biasedExponent;
+  }
+  assert(shift >= 0 && decimals <= fixedDecimalsMax);
+
+  std::uint64_t integral = 0;
+  char digits[fixedDecimalsMax];
+  bool roundUp;
+  if (shift <= 60) {
+    // Ten times the fraction still fits: one digit per step.
+    const std::uint64_t one = std::uint64_t(1) << shift;
+    integral = significand >> shift;
+    std::uint64_t fraction = significand & (one - 1);
+    for (unsigned int i = 0; i < decimals; ++i) {
+      fraction *= 10;
+      digits[i] = static_cast<char>('0' + (fraction >> shift));
+      fraction &= one - 1;
+    }
+    const bool odd = decimals > 0 ? (digits[decimals - 1] & 1) != 0
+                                  : (integral & 1) != 0;
+    roundUp = 2 * fraction > one || (2 * fraction == one && odd);
+  } else {
+    // Below 2^-7: value * 10^decimals == significand * 5^decimals /
+    // 2^(shift - decimals), whose integral part fits 50 bits.
+    std::uint64_t pow5 = 1;
+    for (unsigned int i = 0; i < decimals; ++i)
+      pow5 *= 5;
+    const std::uint64_t sLo = significand & 0xFFFFFFFFU, sHi = significand >> 32;
+    const std::uint64_t pLo = pow5 & 0xFFFFFFFFU, pHi = pow5 >> 32;
+    const std::uint64_t mid = sHi * pLo + sLo * pHi + ((sLo * pLo) >> 32);
+    const std::uint64_t lo = (mid << 32) | ((sLo * pLo) & 0xFFFFFFFFU);
+    const std::uint64_t hi = sHi * pHi + (mid >> 32);
+
+    const int k = shift - static_cast<int>(decimals);
+    std::uint64_t scaled = 0;
+    if (k < 64)
+      scaled = (hi << (64 - k)) | (lo >> k);
+    else if (k < 128)
+      scaled = hi >> (k - 64);
+    roundUp = bitAt(hi, lo, k - 1) &&
+              (anyBelow(hi, lo, k - 1) || (scaled & 1) != 0);
+    for (unsigned int i = decimals; i > 0; --i) {
+      digits[i - 1] = static_cast<char>('0' + scaled % 10);
+      scaled /= 10;
+    }
+  }
+
+  if (roundUp) {
+    unsigned int i = decimals;
+    while (i > 0 && digits[i - 1] == '9')
+      digits[--i] = '0';
+    if (i > 0)
+      ++digits[i - 1];
+    else
+      ++integral;
+  }
+
+  UIntToStringBuffer integralText;
+  char* current = integralText + sizeof(integralText);
+  uintToString(integral, current);
+  String text;
+  text.reserve(1 + std::strlen(current) + 1 + decimals);
+  if (bits >> 63)
+    text += '-';
+  text += current;
+  if (decimals > 0) {
+    unsigned int length = decimals;
+    while (length > 1 && digits[length - 1] == '0')
+      --length;
+    text += '.';
+    text.append(digits, length);
+  }
+  return text;
+}
+
 String valueToString(double value, bool useSpecialFloats,
                      unsigned int precision, PrecisionType precisionType) {
   // Print into the buffer. We need not request the alternative representation
@@ -136,6 +591,19 @@ String valueToString(double value, bool useSpecialFloats,
                [isnan(value) ? 0 : (value < 0) ? 1 : 2];
   }
 
+  // 17 significant digits are enough for any double; the shortest digits
+  // that read back the same are never more.
+  if (precisionType == PrecisionType::shortestFloat ||
+      (precisionType == PrecisionType::significantDigits &&
+       precision >= Value::defaultRealPrecision)) {
+    return shortestToString(value,
+                            precisionType == PrecisionType::shortestFloat);
+  }
+  if (precisionType == PrecisionType::decimalPlaces &&
+      precision <= fixedDecimalsMax && std::fabs(value) < 9007199254740992.0) {
+    return fixedToString(value, precision);
+  }
+
   String buffer(size_t(36), '\0');
   while (true) {
     int len = jsoncpp_snprintf(
@@ -353,6 +821,10 @@ String valueToQuotedString(const char* value) {
   return valueToQuotedStringN(value, strlen(value));
 }
 
+String valueToQuotedString(const char* value, size_t length) {
+  return valueToQuotedStringN(value, length);
+}
+
 // Class Writer
 // //////////////////////////////////////////////////////////////////
 Writer::~Writer() = default;
@@ -1181,8 +1653,11 @@ StreamWriter* StreamWriterBuilder::newStreamWriter() const {
     precisionType = PrecisionType::significantDigits;
   } else if (pt_str == "decimal") {
     precisionType = PrecisionType::decimalPlaces;
+  } else if (pt_str == "float") {
+    precisionType = PrecisionType::shortestFloat;
   } else {
-    throwRuntimeError("precisionType must be 'significant' or 'decimal'");
+    throwRuntimeError(
+        "precisionType must be 'significant', 'decimal' or 'float'");
   }
   String colonSymbol = " : ";
   if (eyc) {
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "json.h"
+
+#define SAMPLES         20      // One upload batch
+#define SENSORS         4
+#define BENCH_ROUNDS    50
+#define ARENA_BLOCK     4096
+
+static const char *TAG = "json arena test";
+
+static size_t heap_blocks(void)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    return info.allocated_blocks;
+}
+
+/* A batch as the upload task queues it: timestamp -> sensorN -> roll/pitch */
+static void build_batch(Json::Value &batch, int round)
+{
+    batch = Json::Value(Json::objectValue);
+    for (int i = 0; i < SAMPLES; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "%013d", round * SAMPLES + i);
+        Json::Value &sample = batch[key];
+        for (int s = 0; s < SENSORS; s++) {
+            std::string sensor = "sensor" + std::to_string(s + 1);
+            sample[sensor]["roll"] = 0.5 * i + s;
+            sample[sensor]["pitch"] = -0.25 * i - s;
+        }
+    }
+}
+
+static std::string write(const Json::Value &value)
+{
+    Json::FastWriter writer;
+    return writer.write(value);
+}
+
+TEST_CASE("Arena tree matches the heap tree and stays off the heap", "[json_arena]")
+{
+    Json::Value heap_batch;
+    build_batch(heap_batch, 0);
+    std::string expected = write(heap_batch);
+
+    Json::Arena arena(ARENA_BLOCK);
+    Json::Value batch;
+    size_t before = heap_blocks();
+    {
+        Json::ArenaScope scope(arena);
+        build_batch(batch, 0);
+    }
+    /* Only the arena's own blocks remain */
+    TEST_ASSERT_EQUAL(arena.blocks(), heap_blocks() - before);
+    TEST_ASSERT_GREATER_THAN(SAMPLES * SENSORS, arena.allocations());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), write(batch).c_str());
+
+    /* A copy made outside the scope is on the heap and survives the arena */
+    Json::Value copy = batch;
+    batch.abandonArena();
+    TEST_ASSERT_TRUE(batch.isNull());
+    arena.reset();
+    TEST_ASSERT_EQUAL(0, arena.used());
+    TEST_ASSERT_EQUAL(1, arena.blocks());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), write(copy).c_str());
+}
+
+TEST_CASE("Arena tree mixed with heap values frees the heap part", "[json_arena]")
+{
+    Json::Arena arena(ARENA_BLOCK);
+    size_t before = heap_blocks();
+    {
+        Json::Value heap_sample(Json::objectValue);
+        heap_sample["note"] = "allocated on the heap, with a string long enough";
+
+        Json::Value batch;
+        {
+            Json::ArenaScope scope(arena);
+            build_batch(batch, 0);
+        }
+        /* Copied outside the scope: heap nodes inside an arena tree */
+        batch["0000000000000"]["extra"] = heap_sample;
+        batch.removeMember("0000000000001");
+        batch["0000000000002"] = Json::Value(Json::arrayValue);
+        batch["0000000000002"].append(heap_sample);
+        TEST_ASSERT_EQUAL_STRING("allocated on the heap, with a string long enough",
+                                 batch["0000000000002"][0]["note"].asCString());
+        /* Destroyed normally: the walk frees what the heap holds */
+    }
+    arena.reset();
+    TEST_ASSERT_EQUAL(before + arena.blocks(), heap_blocks());
+}
+
+TEST_CASE("Arena parse matches the heap parse", "[json_arena]")
+{
+    Json::Value source;
+    build_batch(source, 3);
+    std::string text = write(source);
+
+    Json::Arena arena(ARENA_BLOCK);
+    Json::Value parsed;
+    {
+        Json::ArenaScope scope(arena);
+        Json::Reader reader;
+        TEST_ASSERT_TRUE(reader.parse(text.data(), text.data() + text.size(), parsed, false));
+    }
+    TEST_ASSERT_EQUAL_STRING(text.c_str(), write(parsed).c_str());
+    parsed.abandonArena();
+}
+
+TEST_CASE("Arena scopes nest and large allocations get their own block", "[json_arena]")
+{
+    Json::Arena outer(256), inner(256);
+    {
+        Json::ArenaScope outer_scope(outer);
+        TEST_ASSERT_TRUE(Json::Arena::current() == &outer);
+        {
+            Json::ArenaScope inner_scope(inner);
+            TEST_ASSERT_TRUE(Json::Arena::current() == &inner);
+        }
+        TEST_ASSERT_TRUE(Json::Arena::current() == &outer);
+    }
+    TEST_ASSERT_TRUE(Json::Arena::current() == NULL);
+
+    /* A string beyond a quarter block does not waste the current one */
+    void *small = outer.allocate(16);
+    Json::Value big;
+    {
+        Json::ArenaScope scope(outer);
+        big = Json::Value(std::string(1000, 'x'));
+    }
+    void *next = outer.allocate(16);
+    TEST_ASSERT_EQUAL(2, outer.blocks());
+    TEST_ASSERT_TRUE((char *) small + 16 == (char *) next);
+    TEST_ASSERT_EQUAL(1000, big.asString().size());
+    big.abandonArena();
+    outer.reset();
+    TEST_ASSERT_EQUAL(1, outer.blocks());
+}
+
+/*
+ * Heap blocks a batch tree holds, time to build and release it, and the largest free
+ * block after rounds of batches interleaved with a long-lived allocation, as other
+ * tasks make them: the heap path scatters its nodes around those, the arena does not.
+ */
+TEST_CASE("Arena build and parse benchmark", "[json_arena][bench]")
+{
+    static void *pinned[2][BENCH_ROUNDS];
+    Json::Arena arena(ARENA_BLOCK);
+    std::string text;
+    {
+        Json::Value source;
+        build_batch(source, 0);
+        text = write(source);
+    }
+
+    for (int mode = 0; mode < 2; mode++) {
+        bool use_arena = mode == 1;
+        size_t live_blocks = 0;
+        int64_t build_us = 0, parse_us = 0;
+        size_t largest_before = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            Json::Value batch;
+            size_t before = heap_blocks();
+            int64_t start = esp_timer_get_time();
+            {
+                Json::ArenaScope *scope = use_arena ? new Json::ArenaScope(arena) : NULL;
+                build_batch(batch, round);
+                delete scope;
+            }
+            live_blocks = heap_blocks() - before;
+            pinned[mode][round] = malloc(48);
+            if (use_arena) {
+                batch.abandonArena();
+                arena.reset();
+            } else {
+                batch = Json::Value();
+            }
+            build_us += esp_timer_get_time() - start;
+
+            start = esp_timer_get_time();
+            {
+                Json::ArenaScope *scope = use_arena ? new Json::ArenaScope(arena) : NULL;
+                Json::Reader reader;
+                TEST_ASSERT_TRUE(reader.parse(text.data(), text.data() + text.size(), batch, false));
+                delete scope;
+            }
+            if (use_arena) {
+                batch.abandonArena();
+                arena.reset();
+            } else {
+                batch = Json::Value();
+            }
+            parse_us += esp_timer_get_time() - start;
+        }
+
+        size_t largest_after = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        ESP_LOGI(TAG, "%s: %u heap blocks per batch, build %lld us, parse %lld us, largest free block %u -> %u",
+                 use_arena ? "arena" : "heap", (unsigned) live_blocks, (long long)(build_us / BENCH_ROUNDS),
+                 (long long)(parse_us / BENCH_ROUNDS), (unsigned) largest_before, (unsigned) largest_after);
+        if (use_arena) {
+            TEST_ASSERT_LESS_THAN(SAMPLES, live_blocks);
+        } else {
+            TEST_ASSERT_GREATER_THAN(SAMPLES * SENSORS, live_blocks);
+        }
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            free(pinned[mode][round]);
+        }
+    }
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "json.h"
+#include "json_tool.h"
+
+#define BENCH_NUMBERS   2000
+
+static const char *TAG = "json number test";
+
+static double random_double(void)
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        bits = (bits << 16) ^ (uint64_t) rand();
+    }
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static float random_float(void)
+{
+    uint32_t bits = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* An angle as the MPU task computes it */
+static float random_angle(void)
+{
+    return (float)(rand() % 36000) / 100.0f - 180.0f + (float)(rand() % 1000) / 1e6f;
+}
+
+static std::string float_text(float value)
+{
+    return Json::valueToString((double) value, Json::Value::defaultRealPrecision, Json::PrecisionType::shortestFloat);
+}
+
+TEST_CASE("Reals are written with the shortest digits that read back the same", "[json_number]")
+{
+    /* Same layout as "%.17g" with ".0" after integers, fewer digits */
+    const struct {
+        double value;
+        const char *text;
+    } cases[] = {
+        {0.0, "0.0"}, {-0.0, "-0.0"}, {1.0, "1.0"}, {-3.25, "-3.25"}, {100.0, "100.0"},
+        {0.1, "0.1"}, {12.34, "12.34"}, {0.0001, "0.0001"}, {1e-05, "1e-05"},
+        {1e16, "10000000000000000.0"}, {1e17, "1e+17"}, {1.5e300, "1.5e+300"},
+        {5e-324, "5e-324"}, {1.7976931348623157e308, "1.7976931348623157e+308"},
+        {(double) 12.34f, "12.34000015258789"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TEST_ASSERT_EQUAL_STRING(cases[i].text, Json::valueToString(cases[i].value).c_str());
+    }
+
+    srand(1);
+    for (int i = 0; i < 20000; i++) {
+        double value = random_double();
+        if (!isfinite(value)) {
+            continue;
+        }
+        std::string text = Json::valueToString(value);
+        TEST_ASSERT_TRUE(strtod(text.c_str(), NULL) == value);
+        TEST_ASSERT_EQUAL(signbit(value) != 0, text[0] == '-');
+
+        float single = random_float();
+        if (!isfinite(single)) {
+            continue;
+        }
+        text = float_text(single);
+        TEST_ASSERT_TRUE(strtof(text.c_str(), NULL) == single);
+        TEST_ASSERT_LESS_OR_EQUAL(Json::valueToString((double) single).size(), text.size());
+    }
+
+    /* Only values that are exactly a float are shortened as one */
+    TEST_ASSERT_EQUAL_STRING("12.34", float_text(12.34f).c_str());
+    TEST_ASSERT_EQUAL_STRING("-0.5", float_text(-0.5f).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.1", Json::valueToString(0.1, 17, Json::PrecisionType::shortestFloat).c_str());
+    TEST_ASSERT_EQUAL_STRING("1e+300", Json::valueToString(1e300, 17, Json::PrecisionType::shortestFloat).c_str());
+
+    /* Fewer digits than 17 still round as snprintf does */
+    TEST_ASSERT_EQUAL_STRING("3.14", Json::valueToString(3.14159, 3).c_str());
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    builder["precisionType"] = "float";
+    Json::Value sample;
+    sample["pitch"] = 12.34f;
+    sample["roll"] = 0.1;
+    TEST_ASSERT_EQUAL_STRING("{\"pitch\":12.34,\"roll\":0.1}", Json::writeString(builder, sample).c_str());
+}
+
+/* What valueToString() did with decimalPlaces: "%.*f", then the zeros stripped */
+static std::string printf_fixed(double value, unsigned int decimals)
+{
+    char buffer[64];
+    int len = snprintf(buffer, sizeof(buffer), "%.*f", (int) decimals, value);
+    std::string text(buffer, len);
+    if (text.find('.') == text.npos) {
+        text += ".0";
+    }
+    text.erase(Json::fixZerosInTheEnd(text.begin(), text.end(), decimals), text.end());
+    return text;
+}
+
+static std::string fixed_text(double value, unsigned int decimals)
+{
+    return Json::valueToString(value, decimals, Json::PrecisionType::decimalPlaces);
+}
+
+TEST_CASE("Reals with decimal places are rounded as printf rounds them", "[json_number]")
+{
+    const struct {
+        double value;
+        unsigned int decimals;
+        const char *text;
+    } cases[] = {
+        {12.34f, 2, "12.34"}, {-3.25, 1, "-3.2"}, {0.125, 2, "0.12"}, {0.375, 2, "0.38"}, {9.995, 2, "9.99"},
+        {99.996, 2, "100.0"}, {2.5, 0, "2"}, {3.5, 0, "4"}, {-0.001, 2, "-0.0"}, {1e-300, 3, "0.0"},
+        {0.0009765625, 17, "0.0009765625"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TEST_ASSERT_EQUAL_STRING(cases[i].text, fixed_text(cases[i].value, cases[i].decimals).c_str());
+    }
+
+    /* Angles, exact ties, tiny values and anything that fits 64 bytes */
+    srand(3);
+    for (int i = 0; i < 20000; i++) {
+        unsigned int decimals = rand() % 18;
+        double value;
+        switch (i % 4) {
+        case 0:
+            value = random_angle();
+            break;
+        case 1:
+            value = (double)(rand() % 2000001 - 1000000) / (double)(1 << (rand() % 20));
+            break;
+        case 2:
+            value = ldexp((double) rand() / RAND_MAX, -(rand() % 200));
+            break;
+        default:
+            value = random_double();
+            if (!isfinite(value) || fabs(value) >= 1e40) {
+                continue;
+            }
+            break;
+        }
+        TEST_ASSERT_EQUAL_STRING(printf_fixed(value, decimals).c_str(), fixed_text(value, decimals).c_str());
+    }
+}
+
+struct bench_t {
+    int64_t us;
+    size_t bytes;
+};
+
+/* What valueToString() did before: "%.17g", then ".0" after integers */
+static std::string printf_text(double value)
+{
+    char buffer[32];
+    int len = snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string text(buffer, len);
+    if (text.find('.') == text.npos && text.find('e') == text.npos) {
+        text += ".0";
+    }
+    return text;
+}
+
+static bench_t bench_format(const double *values, std::string (*format)(double))
+{
+    bench_t result = {};
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_NUMBERS; i++) {
+        result.bytes += format(values[i]).size();
+    }
+    result.us = esp_timer_get_time() - start;
+    return result;
+}
+
+static std::string shortest_text(double value)
+{
+    return Json::valueToString(value);
+}
+
+static std::string shortest_float_text(double value)
+{
+    return float_text((float) value);
+}
+
+static std::string printf_fixed2(double value)
+{
+    return printf_fixed(value, 2);
+}
+
+static std::string fixed2_text(double value)
+{
+    return fixed_text(value, 2);
+}
+
+/*
+ * Numbers per second and bytes per number written for sensor angles and for any doubles:
+ * "%.17g" as before, the shortest double and the shortest float.
+ */
+TEST_CASE("Real formatting benchmark", "[json_number][bench]")
+{
+    static double angles[BENCH_NUMBERS], doubles[BENCH_NUMBERS];
+    srand(2);
+    for (int i = 0; i < BENCH_NUMBERS; i++) {
+        angles[i] = random_angle();
+        do {
+            doubles[i] = random_double();
+        } while (!isfinite(doubles[i]));
+    }
+
+    const struct {
+        const char *name;
+        const double *values;
+    } sets[] = {{"angles", angles}, {"doubles", doubles}};
+    for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+        bench_t before = bench_format(sets[s].values, printf_text);
+        bench_t shortest = bench_format(sets[s].values, shortest_text);
+        ESP_LOGI(TAG, "%-7s %%.17g: %lld/s %u bytes, shortest: %lld/s %u bytes (per 100 numbers)", sets[s].name,
+                 (long long)(BENCH_NUMBERS * 1000000LL / (before.us + 1)), (unsigned)(before.bytes * 100 / BENCH_NUMBERS),
+                 (long long)(BENCH_NUMBERS * 1000000LL / (shortest.us + 1)),
+                 (unsigned)(shortest.bytes * 100 / BENCH_NUMBERS));
+        TEST_ASSERT_LESS_THAN(before.us, shortest.us);
+        TEST_ASSERT_LESS_OR_EQUAL(before.bytes, shortest.bytes);
+    }
+
+    bench_t single = bench_format(angles, shortest_float_text);
+    ESP_LOGI(TAG, "angles  shortest float: %lld/s %u bytes (per 100 numbers)",
+             (long long)(BENCH_NUMBERS * 1000000LL / (single.us + 1)), (unsigned)(single.bytes * 100 / BENCH_NUMBERS));
+
+    bench_t before = bench_format(angles, printf_fixed2);
+    bench_t fixed = bench_format(angles, fixed2_text);
+    ESP_LOGI(TAG, "angles  %%.2f: %lld/s %u bytes, 2 decimals: %lld/s %u bytes (per 100 numbers)",
+             (long long)(BENCH_NUMBERS * 1000000LL / (before.us + 1)), (unsigned)(before.bytes * 100 / BENCH_NUMBERS),
+             (long long)(BENCH_NUMBERS * 1000000LL / (fixed.us + 1)), (unsigned)(fixed.bytes * 100 / BENCH_NUMBERS));
+    TEST_ASSERT_LESS_THAN(before.us, fixed.us);
+    TEST_ASSERT_EQUAL(before.bytes, fixed.bytes);
+
+    /* A record of four sensors as the upload task sends it */
+    Json::Value sample(Json::objectValue);
+    for (int i = 0; i < 4; i++) {
+        Json::Value &sensor = sample["sensor" + std::to_string(i + 1)];
+        sensor["pitch"] = angles[2 * i];
+        sensor["roll"] = angles[2 * i + 1];
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    size_t full = Json::writeString(builder, sample).size();
+    builder["precision"] = 2;
+    builder["precisionType"] = "decimal";
+    size_t decimals = Json::writeString(builder, sample).size();
+    ESP_LOGI(TAG, "sample: %u bytes, %u with 2 decimals", (unsigned) full, (unsigned) decimals);
+    TEST_ASSERT_LESS_THAN(full, decimals);
+}
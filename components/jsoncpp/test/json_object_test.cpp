@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "json.h"
+
+#define BENCH_ROUNDS    100
+#define BENCH_OBJECTS   16
+
+static const char *TAG = "json object test";
+
+/* Member names of our payloads, in the order the code adds them */
+static const char *NAMES[] = {
+    "roll", "pitch", "yaw", "ax", "ay", "az", "gx", "gy", "gz", "temp",
+    "sensor1", "sensor2", "sensor3", "sensor4", "timestamp", "device",
+    "battery", "rssi", "uptime", "version",
+};
+#define NAME_COUNT (sizeof(NAMES) / sizeof(NAMES[0]))
+
+typedef Json::Value::ObjectValues::key_type Key;
+typedef Json::FlatMap<Key, Json::Value> FlatMembers;
+typedef std::map<Key, Json::Value> TreeMembers;
+
+static std::string names(const Json::Value &object)
+{
+    std::string text;
+    for (Json::Value::const_iterator it = object.begin(); it != object.end(); ++it) {
+        text += it.name() + ",";
+    }
+    return text;
+}
+
+TEST_CASE("Object members stay sorted and found whatever the insertion order", "[json_object]")
+{
+    srand(1);
+    for (int round = 0; round < 200; round++) {
+        Json::Value object(Json::objectValue);
+        std::map<std::string, int> model;
+        for (int op = 0; op < 60; op++) {
+            std::string name = NAMES[rand() % NAME_COUNT];
+            if (rand() % 4 == 0) {
+                object.removeMember(name);
+                model.erase(name);
+            } else {
+                object[name] = op;
+                model[name] = op;
+            }
+
+            /* Sizes cross the switch from linear search to bisection */
+            TEST_ASSERT_EQUAL(model.size(), object.size());
+            std::string expected;
+            for (const auto &member : model) {
+                expected += member.first + ",";
+                const Json::Value *found = object.find(member.first.data(),
+                                                       member.first.data() + member.first.size());
+                TEST_ASSERT_NOT_NULL(found);
+                TEST_ASSERT_EQUAL(member.second, found->asInt());
+            }
+            TEST_ASSERT_EQUAL_STRING(expected.c_str(), names(object).c_str());
+            TEST_ASSERT_FALSE(object.isMember("absent"));
+        }
+
+        Json::Value copy = object;
+        TEST_ASSERT_TRUE(copy == object);
+        copy["zzz"] = 1;
+        TEST_ASSERT_TRUE(object < copy);
+    }
+}
+
+TEST_CASE("Array members shift on insert and remove", "[json_object]")
+{
+    Json::Value array(Json::arrayValue);
+    for (int i = 0; i < 20; i++) {
+        array.append(i * 10);
+    }
+    TEST_ASSERT_TRUE(array.insert(0, -10));
+    TEST_ASSERT_TRUE(array.insert(21, 200));
+    TEST_ASSERT_TRUE(array.insert(5, "middle"));
+    TEST_ASSERT_EQUAL(23, array.size());
+    TEST_ASSERT_EQUAL(-10, array[0].asInt());
+    TEST_ASSERT_EQUAL_STRING("middle", array[5].asCString());
+    TEST_ASSERT_EQUAL(40, array[6].asInt());
+    TEST_ASSERT_EQUAL(200, array[22].asInt());
+
+    Json::Value removed;
+    TEST_ASSERT_TRUE(array.removeIndex(5, &removed));
+    TEST_ASSERT_EQUAL_STRING("middle", removed.asCString());
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(i * 10, array[i + 1].asInt());
+    }
+
+    array.resize(3);
+    TEST_ASSERT_EQUAL(3, array.size());
+    TEST_ASSERT_EQUAL(10, array[2].asInt());
+    Json::Value::const_iterator last = array.end();
+    --last;
+    TEST_ASSERT_EQUAL(3, array.end() - array.begin());
+    TEST_ASSERT_EQUAL(2, last.index());
+}
+
+struct bench_t {
+    int64_t insert_us;
+    int64_t lookup_us;
+    int64_t iterate_us;
+    size_t bytes;
+    size_t blocks;
+};
+
+/*
+ * Objects are timed in groups, a member takes less than the timer resolution.
+ * Keys point at static names, so only the members themselves are counted.
+ */
+template <typename Members>
+static bench_t bench_members(size_t count)
+{
+    static Members *objects[BENCH_OBJECTS];
+    bench_t result = {};
+    double sum = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        multi_heap_info_t before, after;
+        heap_caps_get_info(&before, MALLOC_CAP_8BIT);
+        size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+        int64_t start = esp_timer_get_time();
+        for (int o = 0; o < BENCH_OBJECTS; o++) {
+            objects[o] = new Members();
+            for (size_t i = 0; i < count; i++) {
+                (*objects[o])[Key(NAMES[i], strlen(NAMES[i]), Key::noDuplication)] = (double) i;
+            }
+        }
+        result.insert_us += esp_timer_get_time() - start;
+
+        heap_caps_get_info(&after, MALLOC_CAP_8BIT);
+        result.bytes = (free_before - heap_caps_get_free_size(MALLOC_CAP_8BIT)) / BENCH_OBJECTS;
+        result.blocks = (after.allocated_blocks - before.allocated_blocks) / BENCH_OBJECTS;
+
+        start = esp_timer_get_time();
+        for (int o = 0; o < BENCH_OBJECTS; o++) {
+            for (size_t i = 0; i < count; i++) {
+                sum += objects[o]->find(Key(NAMES[i], strlen(NAMES[i]), Key::noDuplication))->second.asDouble();
+            }
+        }
+        result.lookup_us += esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int o = 0; o < BENCH_OBJECTS; o++) {
+            for (typename Members::const_iterator it = objects[o]->begin(); it != objects[o]->end(); ++it) {
+                sum += it->second.asDouble();
+            }
+        }
+        result.iterate_us += esp_timer_get_time() - start;
+
+        for (int o = 0; o < BENCH_OBJECTS; o++) {
+            delete objects[o];
+        }
+    }
+    TEST_ASSERT_EQUAL((int64_t) BENCH_ROUNDS * BENCH_OBJECTS * count * (count - 1), (int64_t) sum);
+    return result;
+}
+
+/*
+ * Insert, lookup and iteration time per member and heap held per member, for the
+ * object sizes of our payloads and a batch: sorted vector against the std::map it replaces.
+ */
+TEST_CASE("Object storage benchmark", "[json_object][bench]")
+{
+    const size_t sizes[] = {2, 4, 6, 10, NAME_COUNT};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        bench_t flat = bench_members<FlatMembers>(n);
+        bench_t tree = bench_members<TreeMembers>(n);
+        int64_t ops = (int64_t) BENCH_ROUNDS * BENCH_OBJECTS * n;
+        ESP_LOGI(TAG, "%2u members: insert %lld/%lld ns, lookup %lld/%lld ns, iterate %lld/%lld ns, "
+                 "%u/%u bytes per member, %u/%u blocks per object (flat/map)", (unsigned) n,
+                 (long long)(flat.insert_us * 1000 / ops), (long long)(tree.insert_us * 1000 / ops),
+                 (long long)(flat.lookup_us * 1000 / ops), (long long)(tree.lookup_us * 1000 / ops),
+                 (long long)(flat.iterate_us * 1000 / ops), (long long)(tree.iterate_us * 1000 / ops),
+                 (unsigned)(flat.bytes / n), (unsigned)(tree.bytes / n), (unsigned) flat.blocks, (unsigned) tree.blocks);
+        TEST_ASSERT_LESS_THAN(tree.blocks, flat.blocks);
+        /* Bytes depend on the allocator and, past a doubling, on the unused capacity: compare
+           only where the capacity is exactly filled */
+        if ((n & (n - 1)) == 0) {
+            TEST_ASSERT_LESS_THAN(tree.bytes, flat.bytes);
+        }
+    }
+}
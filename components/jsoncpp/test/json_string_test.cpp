@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "json.h"
+
+static const char *TAG = "json string test";
+
+/* One sample as the upload task sends it */
+static const char *SAMPLE =
+    "{\"sensor1\":{\"pitch\":-3.25,\"roll\":12.5},\"sensor2\":{\"pitch\":0.5,\"roll\":-1},"
+    "\"sensor3\":{\"pitch\":4,\"roll\":2.75},\"sensor4\":{\"pitch\":-0.125,\"roll\":7}}";
+
+/* Shape of the Identity Toolkit sign-in response, tokens shortened */
+static const char *AUTH_RESPONSE =
+    "{\"kind\":\"identitytoolkit#VerifyPasswordResponse\",\"localId\":\"Zx8bQ2wS9cV1nM4kL7pR0tY3uI6o\","
+    "\"email\":\"device@example.com\",\"displayName\":\"\",\"idToken\":\"eyJhbGciOiJSUzI1NiIsImtpZCI6IjEifQ.e30.c2ln\","
+    "\"registered\":true,\"refreshToken\":\"AMf-vBy3Nd8Jx0qL5sT2wE9rU1iO4pA7\",\"expiresIn\":\"3600\"}";
+
+static size_t heap_blocks(void)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    return info.allocated_blocks;
+}
+
+static std::string write(const Json::Value &value)
+{
+    Json::FastWriter writer;
+    return writer.write(value);
+}
+
+static size_t parse_blocks(const char *text, Json::Value *value)
+{
+    Json::Reader reader;
+    size_t before = heap_blocks();
+    TEST_ASSERT_TRUE(reader.parse(text, text + strlen(text), *value, false));
+    return heap_blocks() - before;
+}
+
+TEST_CASE("Strings and keys of every length read back the same", "[json_string]")
+{
+    const std::string chars("abcdefghij\0klmnopqrstuvwxyz", 27);
+    Json::Value object(Json::objectValue);
+    Json::Value previous;
+    for (size_t len = 0; len <= 20; len++) {
+        /* Embedded zeros from length 11 on */
+        std::string text = chars.substr(0, len);
+        Json::Value value(text);
+        TEST_ASSERT_EQUAL(len, value.asString().size());
+        TEST_ASSERT_TRUE(value.asString() == text);
+        TEST_ASSERT_EQUAL(0, memcmp(text.data(), value.asCString(), len));
+        TEST_ASSERT_EQUAL('\0', value.asCString()[len]);
+
+        Json::Value copy = value;
+        Json::Value moved = std::move(copy);
+        TEST_ASSERT_TRUE(moved == value);
+        TEST_ASSERT_TRUE(moved == Json::Value(text.data(), text.data() + len));
+        if (len > 0) {
+            TEST_ASSERT_TRUE(previous < value);
+            TEST_ASSERT_FALSE(value == previous);
+        }
+        previous = value;
+
+        object[text] = (int) len;
+    }
+
+    /* Sorted by bytes whatever the storage, and found again */
+    TEST_ASSERT_EQUAL(21, object.size());
+    int expected = 0;
+    for (Json::Value::const_iterator it = object.begin(); it != object.end(); ++it, expected++) {
+        TEST_ASSERT_EQUAL(expected, it->asInt());
+        TEST_ASSERT_EQUAL((size_t) expected, it.name().size());
+        TEST_ASSERT_TRUE(it.key() == Json::Value(chars.substr(0, expected)));
+    }
+    for (size_t len = 0; len <= 20; len++) {
+        std::string key = chars.substr(0, len);
+        Json::Value removed;
+        TEST_ASSERT_TRUE(object.removeMember(key.data(), key.data() + len, &removed));
+        TEST_ASSERT_EQUAL((int) len, removed.asInt());
+    }
+    TEST_ASSERT_EQUAL(0, object.size());
+
+    /* A StaticString value still points at the caller's string */
+    static const char *text = "static";
+    object["roll"] = Json::Value(Json::StaticString(text));
+    TEST_ASSERT_TRUE(object["roll"].asCString() == text);
+    TEST_ASSERT_EQUAL_STRING("{\"roll\":\"static\"}\n", write(object).c_str());
+}
+
+TEST_CASE("Short strings and keys take no heap blocks", "[json_string]")
+{
+    size_t before = heap_blocks();
+    {
+        Json::Value pitch("pitch"), sensor("sensor1"), empty(""), longer("sensor12");
+        TEST_ASSERT_EQUAL(before + 1, heap_blocks());
+    }
+
+    /* Objects alike but for the length of their keys */
+    Json::Value short_keys(Json::objectValue), long_keys(Json::objectValue);
+    before = heap_blocks();
+    for (int i = 0; i < 10; i++) {
+        short_keys["key" + std::to_string(i)] = i;
+    }
+    size_t short_blocks = heap_blocks() - before;
+    before = heap_blocks();
+    for (int i = 0; i < 10; i++) {
+        long_keys["a longer key " + std::to_string(i)] = i;
+    }
+    TEST_ASSERT_EQUAL(short_blocks + 10, heap_blocks() - before);
+}
+
+/*
+ * Heap blocks held by the parsed trees of our two common documents, and the sizes
+ * that must not grow with the inline storage.
+ */
+TEST_CASE("String storage allocation counts", "[json_string][bench]")
+{
+    Json::Value sample, auth;
+    size_t sample_blocks = parse_blocks(SAMPLE, &sample);
+    size_t auth_blocks = parse_blocks(AUTH_RESPONSE, &auth);
+    ESP_LOGI(TAG, "sizeof(Value) %u, sizeof(key) %u; sample: %u heap blocks, auth response: %u heap blocks",
+             (unsigned) sizeof(Json::Value), (unsigned) sizeof(Json::Value::ObjectValues::key_type),
+             (unsigned) sample_blocks, (unsigned) auth_blocks);
+    TEST_ASSERT_EQUAL(2 * sizeof(void *), sizeof(Json::Value::ObjectValues::key_type));
+    TEST_ASSERT_EQUAL_STRING("3600", auth["expiresIn"].asCString());
+    TEST_ASSERT_TRUE(sample["sensor4"]["pitch"].asDouble() == -0.125);
+}
@@ -7,6 +7,7 @@
 #define JSON_H_INCLUDED
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "flat_map.h"
 #include "forwards.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 
@@ -128,7 +129,9 @@ enum CommentPlacement {
  */
 enum PrecisionType {
   significantDigits = 0, ///< we set max number of significant digits in string
-  decimalPlaces          ///< we set max number of digits after "." in string
+  decimalPlaces,         ///< we set max number of digits after "." in string
+  shortestFloat ///< shortest digits that read back as the same float, for
+                ///< values that came from a float; other values as a double
 };
 
 /** \brief Lightweight wrapper to tag static string.
@@ -157,6 +160,117 @@ private:
   const char* c_str_;
 };
 
+/** \brief Monotonic memory for Value trees.
+ *
+ * While an ArenaScope is active on a thread, every Value payload created on
+ * that thread (strings, object keys, the member storage of objects and arrays
+ * and its nodes) is carved out of the arena's blocks instead of being
+ * malloc'ed. Such payloads are never freed one by one: destroying them only
+ * runs destructors, and reset() or the arena's destruction returns all of the
+ * memory at once. A tree built entirely within a scope can skip even the
+ * destructors with Value::abandonArena().
+ *
+ * Values copied or created outside a scope use the heap as usual, so a tree
+ * may mix both. A Value built within a scope must not outlive its arena or be
+ * stored into a tree that does; copy it outside the scope instead.
+ *
+ * Not thread safe: an arena is used by one thread at a time.
+ */
+class JSON_API Arena {
+public:
+  /// \param blockSize Bytes per block; larger allocations get a block of
+  /// their own.
+  explicit Arena(size_t blockSize = 4096);
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /// Aligned for any type. Never returns null: throws, or asserts, like the
+  /// rest of the library when memory is exhausted.
+  void* allocate(size_t size);
+
+  /// Release everything allocated so far; keeps one block for reuse.
+  void reset();
+
+  /// Bytes handed out since the last reset.
+  size_t used() const { return used_; }
+  /// allocate() calls since the last reset.
+  size_t allocations() const { return allocations_; }
+  /// Blocks currently held, each one heap allocation.
+  size_t blocks() const { return blocks_; }
+
+  /// Arena of this thread's active ArenaScope, or null.
+  static Arena* current();
+
+private:
+  struct Block;
+  Block* newBlock(size_t size);
+  static size_t headerSize();
+
+  Block* head_;
+  size_t blockSize_;
+  size_t used_;
+  size_t allocations_;
+  size_t blocks_;
+
+  friend class ArenaScope;
+};
+
+/** \brief Binds Value allocations on this thread to an Arena for its lifetime.
+ *
+ * Scopes nest; the innermost one wins.
+ */
+class JSON_API ArenaScope {
+public:
+  explicit ArenaScope(Arena& arena);
+  ~ArenaScope();
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+  Arena* previous_;
+};
+
+/** \brief Allocator of the member storage of objects and arrays.
+ *
+ * Holds the arena that was current when the container was created, so nodes
+ * added later come from the same place whatever scope is active then.
+ */
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena* arena = nullptr) noexcept : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    if (arena_)
+      return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T* p, size_t) noexcept {
+    if (!arena_)
+      ::operator delete(p);
+  }
+
+  Arena* arena() const noexcept { return arena_; }
+
+private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
 /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
  *
  * This class is a discriminated union wrapper that can represents a:
@@ -185,11 +299,18 @@ private:
  * It is possible to iterate over the list of member keys of an object using
  * the getMemberNames() method.
  *
- * \note #Value string-length fit in size_t, but keys must be < 2^30.
+ * \note #Value string-length fit in size_t, but keys must be < 2^29.
  * (The reason is an implementation detail.) A #CharReader will raise an
  * exception if a bound is exceeded to avoid security holes in your app,
  * but the Value API does *not* check bounds. That is the responsibility
  * of the caller.
+ *
+ * \note With #JSON_USE_FLAT_OBJECTS, adding or removing a member of an object
+ * or array moves its siblings: a reference or iterator to a member is only
+ * valid until the container changes. Changing the member itself is fine.
+ * Short strings and member names are held inside the Value or its key: a
+ * pointer from asCString(), getString() or memberName() to one of them is
+ * only valid while that Value stays where it is.
  */
 class JSON_API Value {
   friend class ValueIteratorBase;
@@ -260,7 +381,12 @@ private:
 #ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
   class CZString {
   public:
-    enum DuplicationPolicy { noDuplication = 0, duplicate, duplicateOnCopy };
+    enum DuplicationPolicy {
+      noDuplication = 0,
+      duplicate,
+      duplicateOnCopy,
+      duplicateInArena ///< Owned, but reclaimed with its Arena
+    };
     CZString(ArrayIndex index);
     CZString(char const* str, unsigned length, DuplicationPolicy allocate);
     CZString(CZString const& other);
@@ -280,20 +406,51 @@ private:
   private:
     void swap(CZString& other);
 
-    struct StringStorage {
-      unsigned policy_ : 2;
-      unsigned length_ : 30; // 1GB max
+    // Held in the top bits of info_, the length below them.
+    enum Mode {
+      inlineKey = 0, ///< The key itself, in place of cstr_ and info_
+      staticKey,     ///< noDuplication
+      ownedKey,      ///< duplicate
+      borrowedKey,   ///< duplicateOnCopy
+      arenaKey,      ///< duplicateInArena
+      indexKey
     };
+    static constexpr unsigned modeShift = 29;
+    static constexpr unsigned lengthMask = (1U << modeShift) - 1; // 512MB max
+
+    // A key short enough, without embedded zeros, is stored in the bytes of
+    // cstr_ and info_ up to the most significant byte of info_. That byte is
+    // zero for an inline key and nonzero otherwise, since the mode is in its
+    // top bits, so it both terminates the key and tells it apart.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static constexpr unsigned inlineCapacity = sizeof(char const*);
+#else
+    static constexpr unsigned inlineCapacity =
+        sizeof(char const*) + sizeof(unsigned) - 1;
+#endif
+
+    Mode mode() const { return static_cast<Mode>(info_ >> modeShift); }
+    char const* inlineData() const {
+      return reinterpret_cast<char const*>(this);
+    }
 
-    char const* cstr_; // actually, a prefixed string, unless policy is noDup
     union {
+      char const* cstr_; // the string, unless inlineKey or indexKey
       ArrayIndex index_;
-      StringStorage storage_;
     };
+    unsigned info_;
   };
 
 public:
-  typedef std::map<CZString, Value> ObjectValues;
+#if JSON_USE_FLAT_OBJECTS
+  typedef FlatMap<CZString, Value, std::less<CZString>,
+                  ArenaAllocator<std::pair<CZString, Value>>>
+      ObjectValues;
+#else
+  typedef std::map<CZString, Value, std::less<CZString>,
+                   ArenaAllocator<std::pair<const CZString, Value>>>
+      ObjectValues;
+#endif
 #endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
 
 public:
@@ -363,6 +520,11 @@ public:
   /// copy values but leave comments and source offsets in place.
   void copyPayload(const Value& other);
 
+  /// Become null without destroying an arena-backed payload, in O(1). Only
+  /// for a tree built entirely within an ArenaScope, whose memory
+  /// Arena::reset() then reclaims; heap payloads inside it would leak.
+  void abandonArena();
+
   ValueType type() const;
 
   /// Compare payload only, not comments etc.
@@ -471,7 +633,7 @@ public:
   bool insert(ArrayIndex index, Value&& newValue);
 
   /// Access an object value by name, create a null member if it does not exist.
-  /// \note Because of our implementation, keys are limited to 2^30 -1 chars.
+  /// \note Because of our implementation, keys are limited to 2^29 -1 chars.
   /// Exceeding that will cause an exception.
   Value& operator[](const char* key);
   /// Access an object value by name, returns null if there is no member with
@@ -511,10 +673,10 @@ public:
   Value get(const String& key, const Value& defaultValue) const;
   /// Most general and efficient version of isMember()const, get()const,
   /// and operator[]const
-  /// \note As stated elsewhere, behavior is undefined if (end-begin) >= 2^30
+  /// \note As stated elsewhere, behavior is undefined if (end-begin) >= 2^29
   Value const* find(char const* begin, char const* end) const;
   /// Most general and efficient version of object-mutators.
-  /// \note As stated elsewhere, behavior is undefined if (end-begin) >= 2^30
+  /// \note As stated elsewhere, behavior is undefined if (end-begin) >= 2^29
   /// \return non-zero, but JSON_ASSERT if this is neither object nor nullValue.
   Value* demand(char const* begin, char const* end);
   /// \brief Remove and return the named member.
@@ -600,6 +762,9 @@ private:
   void setIsAllocated(bool v) { bits_.allocated_ = v; }
 
   void initBasic(ValueType type, bool allocated = false);
+  void newMap(const ObjectValues* other);
+  void newString(const char* value, unsigned length);
+  bool stringData(char const** str, unsigned* length) const;
   void dupPayload(const Value& other);
   void releasePayload();
   void dupMeta(const Value& other);
@@ -623,13 +788,20 @@ private:
     bool bool_;
     char* string_; // if allocated_, ptr to { unsigned, char[] }.
     ObjectValues* map_;
+    char chars_[sizeof(double)]; // if inline_, the string and a terminator
   } value_;
+  static constexpr unsigned inlineStringMax = sizeof(double) - 1;
 
   struct {
     // Really a ValueType, but types should agree for bitfield packing.
     unsigned int value_type_ : 8;
     // Unless allocated_, string_ must be null-terminated.
     unsigned int allocated_ : 1;
+    // string_ or map_ lives in an Arena: never freed on its own.
+    unsigned int arena_ : 1;
+    // A string of up to inlineStringMax chars is held in chars_.
+    unsigned int inline_ : 1;
+    unsigned int inlineLength_ : 3;
   } bits_;
 
   class Comments {
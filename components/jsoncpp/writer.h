@@ -108,9 +108,14 @@ public:
    *    NaN values as "NaN", positive infinity as "Infinity", and negative
    *  infinity as "-Infinity".
    *  - "precision": int
-   *  - Number of precision digits for formatting of real values.
-   *  - "precisionType": "significant"(default) or "decimal"
-   *  - Type of precision for formatting of real values.
+   *  - Number of precision digits for formatting of real values. With 17
+   *    significant digits (the default), the shortest digits that read back
+   *    as the same double are written instead.
+   *  - "precisionType": "significant"(default), "decimal" or "float"
+   *  - Type of precision for formatting of real values. "float" writes values
+   *    that are exactly a float with the shortest digits of that float.
+   *    "decimal" rounds as printf("%.*f") would, with integer arithmetic
+   *    only below 2^53.
    *  - "emitUTF8": false or true
    *  - If true, outputs raw UTF8 strings instead of escaping them.
 
@@ -354,6 +359,7 @@ String JSON_API valueToString(
     PrecisionType precisionType = PrecisionType::significantDigits);
 String JSON_API valueToString(bool value);
 String JSON_API valueToQuotedString(const char* value);
+String JSON_API valueToQuotedString(const char* value, size_t length);
 
 /// \brief Output using the StyledStreamWriter.
 /// \see Json::operator>>()
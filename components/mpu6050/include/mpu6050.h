@@ -15,13 +15,25 @@
 extern "C" {
 #endif
 
-#include "driver/i2c.h"
+#include "sdkconfig.h"
+#include "mpu6050_transport.h"
+#if CONFIG_IDF_TARGET_LINUX
+typedef int gpio_num_t;
+typedef void (*gpio_isr_t)(void *arg);
+#else
+#include "driver/i2c_master.h"
 #include "driver/gpio.h"
+#endif
 
 #define MPU6050_I2C_ADDRESS         0x68u /*!< I2C address with AD0 pin low */
 #define MPU6050_I2C_ADDRESS_1       0x69u /*!< I2C address with AD0 pin high */
 #define MPU6050_WHO_AM_I_VAL        0x68u
 
+#define MPU6050_MIN_RATE_HZ         4u    /*!< Slowest sample rate, SMPLRT_DIV = 249 */
+#define MPU6050_MAX_RATE_HZ         1000u /*!< Fastest sample rate, accelerometer output rate */
+#define MPU6050_FIFO_MAX_SAMPLES    73u   /*!< Motion frames (14 bytes) fitting in the 1024 byte FIFO */
+#define MPU6050_FIFO_READ_FRAMES    18u   /*!< Frames per FIFO burst, mpu6050_read() takes at most 255 bytes */
+
 typedef enum {
     ACCE_FS_2G  = 0,     /*!< Accelerometer full scale range is +/- 2g */
     ACCE_FS_4G  = 1,     /*!< Accelerometer full scale range is +/- 4g */
@@ -98,6 +110,18 @@ typedef struct {
     float temp;
 } mpu6050_temp_value_t;
 
+typedef struct {
+    mpu6050_raw_acce_value_t acce;
+    int16_t raw_temp;
+    mpu6050_raw_gyro_value_t gyro;
+} mpu6050_raw_motion_value_t;
+
+typedef struct {
+    mpu6050_acce_value_t acce;
+    mpu6050_gyro_value_t gyro;
+    mpu6050_temp_value_t temp;
+} mpu6050_motion_value_t;
+
 
 typedef struct {
     float roll;
@@ -108,20 +132,37 @@ typedef void *mpu6050_handle_t;
 
 typedef gpio_isr_t mpu6050_isr_t;
 
+/**
+ * @brief Create a sensor object on top of a register transport
+ *
+ * @param transport I2C transport, simulator or any other backend. Owned by the sensor from now on,
+ *                  mpu6050_delete() releases it.
+ *
+ * @return
+ *     - NULL Fail
+ *     - Others Success
+ */
+mpu6050_handle_t mpu6050_create_with_transport(mpu6050_transport_t *transport);
+
+#if !CONFIG_IDF_TARGET_LINUX
 /**
  * @brief Create and init sensor object and return a sensor handle
  *
- * @param port I2C port number
+ * Same as mpu6050_new_i2c_transport() followed by mpu6050_create_with_transport().
+ *
+ * @param bus I2C master bus handle, created with i2c_new_master_bus()
  * @param dev_addr I2C device address of sensor
+ * @param scl_speed_hz I2C clock frequency used for this sensor
  *
  * @return
  *     - NULL Fail
  *     - Others Success
  */
-mpu6050_handle_t mpu6050_create(i2c_port_t port, const uint16_t dev_addr);
+mpu6050_handle_t mpu6050_create(i2c_master_bus_handle_t bus, const uint16_t dev_addr, const uint32_t scl_speed_hz);
+#endif
 
 /**
- * @brief Delete and release a sensor object
+ * @brief Delete and release a sensor object and its transport
  *
  * @param sensor object handle of mpu6050
  */
@@ -164,6 +205,9 @@ esp_err_t mpu6050_sleep(mpu6050_handle_t sensor);
 /**
  * @brief Set accelerometer and gyroscope full scale range
  *
+ * On success the ranges are cached in the sensor handle, so later conversions
+ * do not need to read them back from the sensor.
+ *
  * @param sensor object handle of mpu6050
  * @param acce_fs accelerometer full scale range
  * @param gyro_fs gyroscope full scale range
@@ -177,6 +221,8 @@ esp_err_t mpu6050_config(mpu6050_handle_t sensor, const mpu6050_acce_fs_t acce_f
 /**
  * @brief Get accelerometer sensitivity
  *
+ * Returns the cached value when available, the sensor is only read before the first mpu6050_config().
+ *
  * @param sensor object handle of mpu6050
  * @param acce_sensitivity accelerometer sensitivity
  *
@@ -189,6 +235,8 @@ esp_err_t mpu6050_get_acce_sensitivity(mpu6050_handle_t sensor, float *const acc
 /**
  * @brief Get gyroscope sensitivity
  *
+ * Returns the cached value when available, the sensor is only read before the first mpu6050_config().
+ *
  * @param sensor object handle of mpu6050
  * @param gyro_sensitivity gyroscope sensitivity
  *
@@ -379,6 +427,149 @@ esp_err_t mpu6050_get_gyro(mpu6050_handle_t sensor, mpu6050_gyro_value_t *const
  */
 esp_err_t mpu6050_get_temp(mpu6050_handle_t sensor, mpu6050_temp_value_t *const temp_value);
 
+/**
+ * @brief Read raw accelerometer, temperature and gyroscope measurements in a single burst
+ *
+ * Registers ACCEL_XOUT_H to GYRO_ZOUT_H (0x3B - 0x48) are read in one I2C transaction,
+ * so all values belong to the same sample.
+ *
+ * @param sensor object handle of mpu6050
+ * @param raw_motion_value raw accelerometer, temperature and gyroscope measurements
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_get_raw_motion(mpu6050_handle_t sensor, mpu6050_raw_motion_value_t *const raw_motion_value);
+
+/**
+ * @brief Read accelerometer, gyroscope and temperature measurements in a single burst
+ *
+ * @param sensor object handle of mpu6050
+ * @param motion_value scaled accelerometer, gyroscope and temperature measurements
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_get_motion(mpu6050_handle_t sensor, mpu6050_motion_value_t *const motion_value);
+
+/**
+ * @brief Set the rate at which the sensor registers, the FIFO and the DATA READY interrupt are updated
+ *
+ * Enables the digital low pass filter so the gyroscope output rate is 1 kHz, the rate is
+ * rounded to 1 kHz / (1 + SMPLRT_DIV). See mpu6050_get_sample_period() for the actual period.
+ *
+ * @param sensor object handle of mpu6050
+ * @param sample_rate_hz sample rate, MPU6050_MIN_RATE_HZ to MPU6050_MAX_RATE_HZ
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Sample rate out of range
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_set_sample_rate(mpu6050_handle_t sensor, const uint16_t sample_rate_hz);
+
+/**
+ * @brief Start streaming accelerometer, temperature and gyroscope samples into the hardware FIFO
+ *
+ * Sets the sample rate with mpu6050_set_sample_rate(), resets the FIFO and enables it.
+ *
+ * @param sensor object handle of mpu6050
+ * @param sample_rate_hz sample rate, MPU6050_MIN_RATE_HZ to MPU6050_MAX_RATE_HZ
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Sample rate out of range
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_fifo_enable(mpu6050_handle_t sensor, const uint16_t sample_rate_hz);
+
+/**
+ * @brief Stop FIFO streaming and discard its content
+ *
+ * @param sensor object handle of mpu6050
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_fifo_disable(mpu6050_handle_t sensor);
+
+/**
+ * @brief Discard the FIFO content, streaming continues with the next sample
+ *
+ * @param sensor object handle of mpu6050
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_fifo_reset(mpu6050_handle_t sensor);
+
+/**
+ * @brief Get the number of bytes waiting in the FIFO
+ *
+ * @param sensor object handle of mpu6050
+ * @param fifo_count number of bytes in the FIFO
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_get_fifo_count(mpu6050_handle_t sensor, uint16_t *const fifo_count);
+
+/**
+ * @brief Get the sample period configured by mpu6050_set_sample_rate() or mpu6050_fifo_enable()
+ *
+ * @param sensor object handle of mpu6050
+ * @param sample_period_us time between two FIFO samples in microseconds
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_STATE Sample rate was never set on this handle
+ */
+esp_err_t mpu6050_get_sample_period(mpu6050_handle_t sensor, uint32_t *const sample_period_us);
+
+/**
+ * @brief Drain the samples waiting in the FIFO, oldest first
+ *
+ * Reads FIFO_COUNT once, then burst-reads the complete frames from FIFO_R_W.
+ * Samples beyond max_samples stay in the FIFO for the next call.
+ *
+ * @param sensor object handle of mpu6050
+ * @param motion_values array receiving the scaled samples
+ * @param max_samples capacity of motion_values
+ * @param out_samples number of samples written to motion_values
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG A parameter is NULL
+ *     - ESP_ERR_INVALID_SIZE FIFO overflowed, it was reset and its samples are lost
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_fifo_read_motion(mpu6050_handle_t sensor, mpu6050_motion_value_t *const motion_values,
+                                   const size_t max_samples, size_t *const out_samples);
+
+/**
+ * @brief Drain the samples waiting in the FIFO without scaling them, oldest first
+ *
+ * Same as mpu6050_fifo_read_motion(), for callers working in sensor units.
+ *
+ * @param sensor object handle of mpu6050
+ * @param raw_values array receiving the raw samples
+ * @param max_samples capacity of raw_values
+ * @param out_samples number of samples written to raw_values
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG A parameter is NULL
+ *     - ESP_ERR_INVALID_SIZE FIFO overflowed, it was reset and its samples are lost
+ *     - ESP_FAIL Fail
+ */
+esp_err_t mpu6050_fifo_read_raw_motion(mpu6050_handle_t sensor, mpu6050_raw_motion_value_t *const raw_values,
+                                       const size_t max_samples, size_t *const out_samples);
+
 /**
  * @brief Use complimentory filter to calculate roll and pitch
  *
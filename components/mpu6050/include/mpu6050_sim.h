@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief MPU6050 register map simulator
+ *
+ * A transport backend that emulates the MPU6050 registers used by the driver: sample
+ * rate, full scale ranges, data registers, FIFO, interrupt status and power management.
+ * Samples come from a motion source (recorded trace or synthetic generator) and are
+ * produced at the rate programmed in SMPLRT_DIV/CONFIG, either following a clock or
+ * when mpu6050_sim_advance() is called. An optional callback stands for the INT pin.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mpu6050_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One motion sample in physical units
+ */
+typedef struct {
+    float acce_x;   /*!< g */
+    float acce_y;
+    float acce_z;
+    float gyro_x;   /*!< degree per second */
+    float gyro_y;
+    float gyro_z;
+    float temp;     /*!< degree Celsius */
+} mpu6050_sim_sample_t;
+
+/**
+ * @brief Motion source
+ *
+ * @param arg source_arg from mpu6050_sim_config_t
+ * @param index Sample number since the simulator was created
+ * @param time_us Trace time of the sample, advanced by the programmed sample period
+ * @param sample Sample to fill
+ *
+ * @return false when the source has no more samples; the sensor then keeps its last output
+ */
+typedef bool (*mpu6050_sim_source_t)(void *arg, uint32_t index, int64_t time_us, mpu6050_sim_sample_t *sample);
+
+/**
+ * @brief Time base, in microseconds
+ */
+typedef int64_t (*mpu6050_sim_clock_t)(void *arg);
+
+/**
+ * @brief INT pin of a simulated sensor
+ *
+ * Called where the pin's ISR would run: when new samples raised DATA_RDY and DATA_RDY_EN is
+ * set in INT_ENABLE. It runs once per access that produced samples, after the simulator is
+ * unlocked, in the task that made the access, so it may read the sensor like an ISR's task would.
+ *
+ * @param arg int_arg from mpu6050_sim_config_t
+ */
+typedef void (*mpu6050_sim_int_t)(void *arg);
+
+typedef struct {
+    mpu6050_sim_source_t source;    /*!< Motion source, NULL for a sensor lying flat */
+    void *source_arg;
+    mpu6050_sim_clock_t clock;      /*!< Samples are due each sample period of this clock. NULL: only mpu6050_sim_advance() produces samples */
+    void *clock_arg;
+    mpu6050_sim_int_t int_handler;  /*!< INT pin, NULL if not connected */
+    void *int_arg;
+} mpu6050_sim_config_t;
+
+typedef struct {
+    uint32_t samples;               /*!< Samples produced */
+    uint32_t fifo_overflows;        /*!< Samples that pushed older bytes out of the FIFO */
+    uint32_t reads;                 /*!< read_regs calls */
+    uint32_t writes;                /*!< write_regs calls */
+    uint32_t bytes_read;
+} mpu6050_sim_stats_t;
+
+/**
+ * @brief Recorded trace, used with mpu6050_sim_trace_source()
+ */
+typedef struct {
+    const mpu6050_sim_sample_t *samples;
+    size_t count;
+    bool loop;                      /*!< Start over at the end instead of stopping */
+} mpu6050_sim_trace_t;
+
+/**
+ * @brief Synthetic motion, used with mpu6050_sim_sway_source()
+ *
+ * Roll and pitch oscillate around a fixed posture, 90 degrees out of phase.
+ */
+typedef struct {
+    float roll_deg;                 /*!< Mean roll */
+    float pitch_deg;                /*!< Mean pitch */
+    float amplitude_deg;            /*!< Sway amplitude */
+    float frequency_hz;             /*!< Sway frequency */
+    float temp;                     /*!< Reported temperature, degree Celsius */
+} mpu6050_sim_sway_t;
+
+/**
+ * @brief Create a simulated sensor
+ *
+ * The register map starts as after power on: device asleep, full scale ranges at their minimum.
+ *
+ * @param config Simulator configuration, copied
+ * @param ret_transport Returned transport, pass it to mpu6050_create_with_transport()
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG NULL argument
+ *     - ESP_ERR_NO_MEM Out of memory
+ */
+esp_err_t mpu6050_new_sim_transport(const mpu6050_sim_config_t *config, mpu6050_transport_t **ret_transport);
+
+/**
+ * @brief Produce samples immediately, as if that many sample periods had passed
+ *
+ * @param transport Transport created by mpu6050_new_sim_transport()
+ * @param samples Number of samples
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_STATE The simulated sensor is asleep
+ */
+esp_err_t mpu6050_sim_advance(mpu6050_transport_t *transport, uint32_t samples);
+
+/**
+ * @brief Produce the samples due on the clock without a register access
+ *
+ * Samples following a clock are only produced when the sensor is accessed. Call this
+ * periodically so the INT pin fires on time when nothing else reads the sensor.
+ *
+ * @param transport Transport created by mpu6050_new_sim_transport()
+ */
+void mpu6050_sim_poll(mpu6050_transport_t *transport);
+
+/**
+ * @brief Get the access counters of a simulated sensor
+ *
+ * @param transport Transport created by mpu6050_new_sim_transport()
+ * @param stats Returned counters
+ */
+void mpu6050_sim_get_stats(mpu6050_transport_t *transport, mpu6050_sim_stats_t *stats);
+
+/**
+ * @brief Motion source replaying a mpu6050_sim_trace_t passed as source_arg
+ */
+bool mpu6050_sim_trace_source(void *arg, uint32_t index, int64_t time_us, mpu6050_sim_sample_t *sample);
+
+/**
+ * @brief Motion source generating a mpu6050_sim_sway_t passed as source_arg
+ */
+bool mpu6050_sim_sway_source(void *arg, uint32_t index, int64_t time_us, mpu6050_sim_sample_t *sample);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief MPU6050 register transport
+ *
+ * The driver reaches the sensor only through read_regs/write_regs, so the same
+ * driver code runs on the I2C bus or against the register map simulator
+ * (mpu6050_sim.h) on a host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "driver/i2c_master.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mpu6050_transport_t mpu6050_transport_t;
+
+/**
+ * @brief Register access backend
+ *
+ * Accesses of len bytes start at reg and auto-increment the register address,
+ * except for FIFO_R_W, which returns consecutive FIFO bytes.
+ */
+struct mpu6050_transport_t {
+    /**
+     * @brief Read len consecutive registers starting at reg
+     */
+    esp_err_t (*read_regs)(mpu6050_transport_t *transport, uint8_t reg, uint8_t *data, size_t len);
+
+    /**
+     * @brief Write len consecutive registers starting at reg
+     */
+    esp_err_t (*write_regs)(mpu6050_transport_t *transport, uint8_t reg, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Release the transport and everything it owns
+     */
+    void (*del)(mpu6050_transport_t *transport);
+};
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Create a transport for a sensor on an i2c_master bus
+ *
+ * Register accesses go through i2c_master_transmit()/i2c_master_transmit_receive()
+ * and do not allocate memory.
+ *
+ * @param bus I2C master bus handle, created with i2c_new_master_bus()
+ * @param dev_addr I2C device address of sensor
+ * @param scl_speed_hz I2C clock frequency used for this sensor
+ * @param ret_transport Returned transport
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_NO_MEM Out of memory
+ *     - Others Error from i2c_master_bus_add_device()
+ */
+esp_err_t mpu6050_new_i2c_transport(i2c_master_bus_handle_t bus, uint16_t dev_addr, uint32_t scl_speed_hz,
+                                    mpu6050_transport_t **ret_transport);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,770 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include "esp_system.h"
+#include "esp_bit_defs.h"
+#include "mpu6050.h"
+
+#define ALPHA                       0.99f        /*!< Weight of gyroscope */
+#define RAD_TO_DEG                  57.27272727f /*!< Radians to degrees */
+
+/* MPU6050 register */
+#define MPU6050_SMPLRT_DIV          0x19u
+#define MPU6050_CONFIG              0x1Au
+#define MPU6050_GYRO_CONFIG         0x1Bu
+#define MPU6050_ACCEL_CONFIG        0x1Cu
+#define MPU6050_FIFO_EN             0x23u
+#define MPU6050_INTR_PIN_CFG         0x37u
+#define MPU6050_INTR_ENABLE          0x38u
+#define MPU6050_INTR_STATUS          0x3Au
+#define MPU6050_ACCEL_XOUT_H        0x3Bu
+#define MPU6050_GYRO_XOUT_H         0x43u
+#define MPU6050_TEMP_XOUT_H         0x41u
+#define MPU6050_USER_CTRL           0x6Au
+#define MPU6050_PWR_MGMT_1          0x6Bu
+#define MPU6050_FIFO_COUNTH         0x72u
+#define MPU6050_FIFO_R_W            0x74u
+#define MPU6050_WHO_AM_I            0x75u
+
+#define MPU6050_FIFO_SIZE           1024u
+#define MPU6050_MOTION_FRAME_LEN    14u   /*!< accel + temp + gyro, same layout in registers and FIFO */
+#define MPU6050_FIFO_EN_MOTION      (BIT7 | BIT6 | BIT5 | BIT4 | BIT3) /*!< TEMP, XG, YG, ZG and ACCEL into FIFO */
+#define MPU6050_USER_CTRL_FIFO_EN   BIT6
+#define MPU6050_USER_CTRL_FIFO_RST  BIT2
+#define MPU6050_DLPF_CFG_188HZ      0x01u /*!< Any DLPF setting keeps the gyro output rate at 1 kHz */
+#define MPU6050_GYRO_OUT_RATE_HZ    1000u
+
+const uint8_t MPU6050_DATA_RDY_INT_BIT =      (uint8_t) BIT0;
+const uint8_t MPU6050_I2C_MASTER_INT_BIT =    (uint8_t) BIT3;
+const uint8_t MPU6050_FIFO_OVERFLOW_INT_BIT = (uint8_t) BIT4;
+const uint8_t MPU6050_MOT_DETECT_INT_BIT =    (uint8_t) BIT6;
+const uint8_t MPU6050_ALL_INTERRUPTS = (MPU6050_DATA_RDY_INT_BIT | MPU6050_I2C_MASTER_INT_BIT | MPU6050_FIFO_OVERFLOW_INT_BIT | MPU6050_MOT_DETECT_INT_BIT);
+
+typedef struct {
+    mpu6050_transport_t *transport;
+    gpio_num_t int_pin;
+    uint32_t counter;
+    float dt;  /*!< delay time between two measurements, dt should be small (ms level) */
+    struct timeval *timer;
+    bool fs_cached;                 /*!< acce_fs/gyro_fs mirror the sensor registers */
+    mpu6050_acce_fs_t acce_fs;
+    mpu6050_gyro_fs_t gyro_fs;
+    float acce_scale;               /*!< 1 / accelerometer sensitivity */
+    float gyro_scale;               /*!< 1 / gyroscope sensitivity */
+    uint32_t sample_period_us;      /*!< Sample period set by mpu6050_set_sample_rate(), 0 if never set */
+} mpu6050_dev_t;
+
+static esp_err_t mpu6050_write(mpu6050_handle_t sensor, const uint8_t reg_start_addr, const uint8_t *const data_buf, const uint8_t data_len)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+
+    return sens->transport->write_regs(sens->transport, reg_start_addr, data_buf, data_len);
+}
+
+static esp_err_t mpu6050_read(mpu6050_handle_t sensor, const uint8_t reg_start_addr, uint8_t *const data_buf, const uint8_t data_len)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+
+    return sens->transport->read_regs(sens->transport, reg_start_addr, data_buf, data_len);
+}
+
+mpu6050_handle_t mpu6050_create_with_transport(mpu6050_transport_t *transport)
+{
+    if (NULL == transport) {
+        return NULL;
+    }
+
+    mpu6050_dev_t *sensor = (mpu6050_dev_t *) calloc(1, sizeof(mpu6050_dev_t));
+    if (NULL == sensor) {
+        return NULL;
+    }
+
+    sensor->transport = transport;
+    sensor->counter = 0;
+    sensor->dt = 0;
+    sensor->fs_cached = false;
+    sensor->timer = (struct timeval *) calloc(1, sizeof(struct timeval));
+    return (mpu6050_handle_t) sensor;
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+mpu6050_handle_t mpu6050_create(i2c_master_bus_handle_t bus, const uint16_t dev_addr, const uint32_t scl_speed_hz)
+{
+    mpu6050_transport_t *transport;
+
+    if (ESP_OK != mpu6050_new_i2c_transport(bus, dev_addr, scl_speed_hz, &transport)) {
+        return NULL;
+    }
+
+    mpu6050_handle_t sensor = mpu6050_create_with_transport(transport);
+    if (NULL == sensor) {
+        transport->del(transport);
+    }
+    return sensor;
+}
+#endif
+
+void mpu6050_delete(mpu6050_handle_t sensor)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    sens->transport->del(sens->transport);
+    free(sens->timer);
+    free(sens);
+}
+
+esp_err_t mpu6050_get_deviceid(mpu6050_handle_t sensor, uint8_t *const deviceid)
+{
+    return mpu6050_read(sensor, MPU6050_WHO_AM_I, deviceid, 1);
+}
+
+esp_err_t mpu6050_wake_up(mpu6050_handle_t sensor)
+{
+    esp_err_t ret;
+    uint8_t tmp;
+    ret = mpu6050_read(sensor, MPU6050_PWR_MGMT_1, &tmp, 1);
+    if (ESP_OK != ret) {
+        return ret;
+    }
+    tmp &= (~BIT6);
+    ret = mpu6050_write(sensor, MPU6050_PWR_MGMT_1, &tmp, 1);
+    return ret;
+}
+
+esp_err_t mpu6050_sleep(mpu6050_handle_t sensor)
+{
+    esp_err_t ret;
+    uint8_t tmp;
+    ret = mpu6050_read(sensor, MPU6050_PWR_MGMT_1, &tmp, 1);
+    if (ESP_OK != ret) {
+        return ret;
+    }
+    tmp |= BIT6;
+    ret = mpu6050_write(sensor, MPU6050_PWR_MGMT_1, &tmp, 1);
+    return ret;
+}
+
+static float mpu6050_acce_fs_to_sensitivity(const uint8_t acce_fs)
+{
+    switch (acce_fs) {
+    case ACCE_FS_2G:
+        return 16384;
+
+    case ACCE_FS_4G:
+        return 8192;
+
+    case ACCE_FS_8G:
+        return 4096;
+
+    case ACCE_FS_16G:
+    default:
+        return 2048;
+    }
+}
+
+static float mpu6050_gyro_fs_to_sensitivity(const uint8_t gyro_fs)
+{
+    switch (gyro_fs) {
+    case GYRO_FS_250DPS:
+        return 131;
+
+    case GYRO_FS_500DPS:
+        return 65.5;
+
+    case GYRO_FS_1000DPS:
+        return 32.8;
+
+    case GYRO_FS_2000DPS:
+    default:
+        return 16.4;
+    }
+}
+
+static void mpu6050_cache_fs(mpu6050_dev_t *sens, const mpu6050_acce_fs_t acce_fs, const mpu6050_gyro_fs_t gyro_fs)
+{
+    sens->acce_fs = acce_fs;
+    sens->gyro_fs = gyro_fs;
+    sens->acce_scale = 1.0f / mpu6050_acce_fs_to_sensitivity(acce_fs);
+    sens->gyro_scale = 1.0f / mpu6050_gyro_fs_to_sensitivity(gyro_fs);
+    sens->fs_cached = true;
+}
+
+/**
+ * @brief Make sure the full scale ranges are cached, reading them from the sensor
+ *        only if mpu6050_config() has not been called on this handle yet.
+ */
+static esp_err_t mpu6050_load_fs(mpu6050_handle_t sensor)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+    uint8_t config_regs[2];
+
+    if (sens->fs_cached) {
+        return ESP_OK;
+    }
+
+    /* GYRO_CONFIG and ACCEL_CONFIG are adjacent, fetch both ranges at once */
+    ret = mpu6050_read(sensor, MPU6050_GYRO_CONFIG, config_regs, sizeof(config_regs));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    mpu6050_cache_fs(sens, (mpu6050_acce_fs_t)((config_regs[1] >> 3) & 0x03),
+                     (mpu6050_gyro_fs_t)((config_regs[0] >> 3) & 0x03));
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_config(mpu6050_handle_t sensor, const mpu6050_acce_fs_t acce_fs, const mpu6050_gyro_fs_t gyro_fs)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    uint8_t config_regs[2] = {gyro_fs << 3,  acce_fs << 3};
+    esp_err_t ret = mpu6050_write(sensor, MPU6050_GYRO_CONFIG, config_regs, sizeof(config_regs));
+    if (ret == ESP_OK) {
+        mpu6050_cache_fs(sens, acce_fs, gyro_fs);
+    } else {
+        /* Registers may be partially written, re-read them on next use */
+        sens->fs_cached = false;
+    }
+    return ret;
+}
+
+esp_err_t mpu6050_get_acce_sensitivity(mpu6050_handle_t sensor, float *const acce_sensitivity)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret = mpu6050_load_fs(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *acce_sensitivity = mpu6050_acce_fs_to_sensitivity(sens->acce_fs);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_get_gyro_sensitivity(mpu6050_handle_t sensor, float *const gyro_sensitivity)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret = mpu6050_load_fs(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *gyro_sensitivity = mpu6050_gyro_fs_to_sensitivity(sens->gyro_fs);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_config_interrupts(mpu6050_handle_t sensor, const mpu6050_int_config_t *const interrupt_configuration)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (NULL == interrupt_configuration) {
+        ret = ESP_ERR_INVALID_ARG;
+        return ret;
+    }
+
+#if !CONFIG_IDF_TARGET_LINUX
+    if (GPIO_IS_VALID_GPIO(interrupt_configuration->interrupt_pin)) {
+        // Set GPIO connected to MPU6050 INT pin only when user configures interrupts.
+        mpu6050_dev_t *sensor_device = (mpu6050_dev_t *) sensor;
+        sensor_device->int_pin = interrupt_configuration->interrupt_pin;
+    } else {
+        ret = ESP_ERR_INVALID_ARG;
+        return ret;
+    }
+#endif
+
+    uint8_t int_pin_cfg = 0x00;
+
+    ret = mpu6050_read(sensor, MPU6050_INTR_PIN_CFG, &int_pin_cfg, 1);
+
+    if (ESP_OK != ret) {
+        return ret;
+    }
+
+    if (INTERRUPT_PIN_ACTIVE_LOW == interrupt_configuration->active_level) {
+        int_pin_cfg |= BIT7;
+    }
+
+    if (INTERRUPT_PIN_OPEN_DRAIN == interrupt_configuration->pin_mode) {
+        int_pin_cfg |= BIT6;
+    }
+
+    if (INTERRUPT_LATCH_UNTIL_CLEARED == interrupt_configuration->interrupt_latch) {
+        int_pin_cfg |= BIT5;
+    }
+
+    if (INTERRUPT_CLEAR_ON_ANY_READ == interrupt_configuration->interrupt_clear_behavior) {
+        int_pin_cfg |= BIT4;
+    }
+
+    ret = mpu6050_write(sensor, MPU6050_INTR_PIN_CFG, &int_pin_cfg, 1);
+
+    if (ESP_OK != ret) {
+        return ret;
+    }
+
+#if CONFIG_IDF_TARGET_LINUX
+    // No GPIO on the host: only the sensor side of the INT pin is configured
+    return ret;
+#else
+    gpio_int_type_t gpio_intr_type;
+
+    if (INTERRUPT_PIN_ACTIVE_LOW == interrupt_configuration->active_level) {
+        gpio_intr_type = GPIO_INTR_NEGEDGE;
+    } else {
+        gpio_intr_type = GPIO_INTR_POSEDGE;
+    }
+
+    gpio_config_t int_gpio_config = {
+        .mode = GPIO_MODE_INPUT,
+        .intr_type = gpio_intr_type,
+        .pin_bit_mask = (BIT0 << interrupt_configuration->interrupt_pin)
+    };
+
+    ret = gpio_config(&int_gpio_config);
+
+    return ret;
+#endif
+}
+
+esp_err_t mpu6050_register_isr(mpu6050_handle_t sensor, const mpu6050_isr_t isr)
+{
+    esp_err_t ret;
+    mpu6050_dev_t *sensor_device = (mpu6050_dev_t *) sensor;
+
+    if (NULL == sensor_device) {
+        ret = ESP_ERR_INVALID_ARG;
+        return ret;
+    }
+
+#if CONFIG_IDF_TARGET_LINUX
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    ret = gpio_isr_handler_add(
+              sensor_device->int_pin,
+              ((gpio_isr_t) * (isr)),
+              ((void *) sensor)
+          );
+
+    if (ESP_OK != ret) {
+        return ret;
+    }
+
+    ret = gpio_intr_enable(sensor_device->int_pin);
+
+    return ret;
+#endif
+}
+
+esp_err_t mpu6050_enable_interrupts(mpu6050_handle_t sensor, uint8_t interrupt_sources)
+{
+    esp_err_t ret;
+    uint8_t enabled_interrupts = 0x00;
+
+    ret = mpu6050_read(sensor, MPU6050_INTR_ENABLE, &enabled_interrupts, 1);
+
+    if (ESP_OK != ret) {
+        return ret;
+    }
+
+    if (enabled_interrupts != interrupt_sources) {
+
+        enabled_interrupts |= interrupt_sources;
+
+        ret = mpu6050_write(sensor, MPU6050_INTR_ENABLE, &enabled_interrupts, 1);
+    }
+
+    return ret;
+}
+
+esp_err_t mpu6050_disable_interrupts(mpu6050_handle_t sensor, uint8_t interrupt_sources)
+{
+    esp_err_t ret;
+    uint8_t enabled_interrupts = 0x00;
+
+    ret = mpu6050_read(sensor, MPU6050_INTR_ENABLE, &enabled_interrupts, 1);
+
+    if (ESP_OK != ret) {
+        return ret;
+    }
+
+    if (0 != (enabled_interrupts & interrupt_sources)) {
+        enabled_interrupts &= (~interrupt_sources);
+
+        ret = mpu6050_write(sensor, MPU6050_INTR_ENABLE, &enabled_interrupts, 1);
+    }
+
+    return ret;
+}
+
+esp_err_t mpu6050_get_interrupt_status(mpu6050_handle_t sensor, uint8_t *const out_intr_status)
+{
+    esp_err_t ret;
+
+    if (NULL == out_intr_status) {
+        ret = ESP_ERR_INVALID_ARG;
+        return ret;
+    }
+
+    ret = mpu6050_read(sensor, MPU6050_INTR_STATUS, out_intr_status, 1);
+
+    return ret;
+}
+
+inline uint8_t mpu6050_is_data_ready_interrupt(uint8_t interrupt_status)
+{
+    return (MPU6050_DATA_RDY_INT_BIT == (MPU6050_DATA_RDY_INT_BIT & interrupt_status));
+}
+
+inline uint8_t mpu6050_is_i2c_master_interrupt(uint8_t interrupt_status)
+{
+    return (uint8_t) (MPU6050_I2C_MASTER_INT_BIT == (MPU6050_I2C_MASTER_INT_BIT & interrupt_status));
+}
+
+inline uint8_t mpu6050_is_fifo_overflow_interrupt(uint8_t interrupt_status)
+{
+    return (uint8_t) (MPU6050_FIFO_OVERFLOW_INT_BIT == (MPU6050_FIFO_OVERFLOW_INT_BIT & interrupt_status));
+}
+
+static void mpu6050_decode_motion(const uint8_t *const data_rd, mpu6050_raw_motion_value_t *const raw_motion_value)
+{
+    raw_motion_value->acce.raw_acce_x = (int16_t)((data_rd[0] << 8) + (data_rd[1]));
+    raw_motion_value->acce.raw_acce_y = (int16_t)((data_rd[2] << 8) + (data_rd[3]));
+    raw_motion_value->acce.raw_acce_z = (int16_t)((data_rd[4] << 8) + (data_rd[5]));
+    raw_motion_value->raw_temp = (int16_t)((data_rd[6] << 8) | (data_rd[7]));
+    raw_motion_value->gyro.raw_gyro_x = (int16_t)((data_rd[8] << 8) + (data_rd[9]));
+    raw_motion_value->gyro.raw_gyro_y = (int16_t)((data_rd[10] << 8) + (data_rd[11]));
+    raw_motion_value->gyro.raw_gyro_z = (int16_t)((data_rd[12] << 8) + (data_rd[13]));
+}
+
+static void mpu6050_scale_motion(const mpu6050_dev_t *const sens, const mpu6050_raw_motion_value_t *const raw_motion,
+                                 mpu6050_motion_value_t *const motion_value)
+{
+    motion_value->acce.acce_x = raw_motion->acce.raw_acce_x * sens->acce_scale;
+    motion_value->acce.acce_y = raw_motion->acce.raw_acce_y * sens->acce_scale;
+    motion_value->acce.acce_z = raw_motion->acce.raw_acce_z * sens->acce_scale;
+    motion_value->gyro.gyro_x = raw_motion->gyro.raw_gyro_x * sens->gyro_scale;
+    motion_value->gyro.gyro_y = raw_motion->gyro.raw_gyro_y * sens->gyro_scale;
+    motion_value->gyro.gyro_z = raw_motion->gyro.raw_gyro_z * sens->gyro_scale;
+    motion_value->temp.temp = raw_motion->raw_temp / 340.00 + 36.53;
+}
+
+esp_err_t mpu6050_get_raw_acce(mpu6050_handle_t sensor, mpu6050_raw_acce_value_t *const raw_acce_value)
+{
+    uint8_t data_rd[6];
+    esp_err_t ret = mpu6050_read(sensor, MPU6050_ACCEL_XOUT_H, data_rd, sizeof(data_rd));
+
+    raw_acce_value->raw_acce_x = (int16_t)((data_rd[0] << 8) + (data_rd[1]));
+    raw_acce_value->raw_acce_y = (int16_t)((data_rd[2] << 8) + (data_rd[3]));
+    raw_acce_value->raw_acce_z = (int16_t)((data_rd[4] << 8) + (data_rd[5]));
+    return ret;
+}
+
+esp_err_t mpu6050_get_raw_gyro(mpu6050_handle_t sensor, mpu6050_raw_gyro_value_t *const raw_gyro_value)
+{
+    uint8_t data_rd[6];
+    esp_err_t ret = mpu6050_read(sensor, MPU6050_GYRO_XOUT_H, data_rd, sizeof(data_rd));
+
+    raw_gyro_value->raw_gyro_x = (int16_t)((data_rd[0] << 8) + (data_rd[1]));
+    raw_gyro_value->raw_gyro_y = (int16_t)((data_rd[2] << 8) + (data_rd[3]));
+    raw_gyro_value->raw_gyro_z = (int16_t)((data_rd[4] << 8) + (data_rd[5]));
+
+    return ret;
+}
+
+esp_err_t mpu6050_get_acce(mpu6050_handle_t sensor, mpu6050_acce_value_t *const acce_value)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+    mpu6050_raw_acce_value_t raw_acce;
+
+    ret = mpu6050_load_fs(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = mpu6050_get_raw_acce(sensor, &raw_acce);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    acce_value->acce_x = raw_acce.raw_acce_x * sens->acce_scale;
+    acce_value->acce_y = raw_acce.raw_acce_y * sens->acce_scale;
+    acce_value->acce_z = raw_acce.raw_acce_z * sens->acce_scale;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_get_gyro(mpu6050_handle_t sensor, mpu6050_gyro_value_t *const gyro_value)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+    mpu6050_raw_gyro_value_t raw_gyro;
+
+    ret = mpu6050_load_fs(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = mpu6050_get_raw_gyro(sensor, &raw_gyro);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    gyro_value->gyro_x = raw_gyro.raw_gyro_x * sens->gyro_scale;
+    gyro_value->gyro_y = raw_gyro.raw_gyro_y * sens->gyro_scale;
+    gyro_value->gyro_z = raw_gyro.raw_gyro_z * sens->gyro_scale;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_get_temp(mpu6050_handle_t sensor, mpu6050_temp_value_t *const temp_value)
+{
+    uint8_t data_rd[2];
+    esp_err_t ret = mpu6050_read(sensor, MPU6050_TEMP_XOUT_H, data_rd, sizeof(data_rd));
+    temp_value->temp = (int16_t)((data_rd[0] << 8) | (data_rd[1])) / 340.00 + 36.53;
+    return ret;
+}
+
+esp_err_t mpu6050_get_raw_motion(mpu6050_handle_t sensor, mpu6050_raw_motion_value_t *const raw_motion_value)
+{
+    uint8_t data_rd[MPU6050_MOTION_FRAME_LEN];
+    esp_err_t ret = mpu6050_read(sensor, MPU6050_ACCEL_XOUT_H, data_rd, sizeof(data_rd));
+
+    mpu6050_decode_motion(data_rd, raw_motion_value);
+    return ret;
+}
+
+esp_err_t mpu6050_get_motion(mpu6050_handle_t sensor, mpu6050_motion_value_t *const motion_value)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+    mpu6050_raw_motion_value_t raw_motion;
+
+    ret = mpu6050_load_fs(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = mpu6050_get_raw_motion(sensor, &raw_motion);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    mpu6050_scale_motion(sens, &raw_motion, motion_value);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_set_sample_rate(mpu6050_handle_t sensor, const uint16_t sample_rate_hz)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+
+    if (sample_rate_hz < MPU6050_MIN_RATE_HZ || sample_rate_hz > MPU6050_MAX_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* SMPLRT_DIV and CONFIG are adjacent: Sample Rate = 1 kHz / (1 + SMPLRT_DIV) */
+    uint8_t rate_regs[2] = {(uint8_t)(MPU6050_GYRO_OUT_RATE_HZ / sample_rate_hz - 1), MPU6050_DLPF_CFG_188HZ};
+    ret = mpu6050_write(sensor, MPU6050_SMPLRT_DIV, rate_regs, sizeof(rate_regs));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    sens->sample_period_us = (1000000u / MPU6050_GYRO_OUT_RATE_HZ) * (1u + rate_regs[0]);
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_fifo_enable(mpu6050_handle_t sensor, const uint16_t sample_rate_hz)
+{
+    esp_err_t ret;
+    uint8_t user_ctrl;
+    uint8_t fifo_en = MPU6050_FIFO_EN_MOTION;
+
+    ret = mpu6050_set_sample_rate(sensor, sample_rate_hz);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = mpu6050_read(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    user_ctrl &= (~MPU6050_USER_CTRL_FIFO_EN);
+    user_ctrl |= MPU6050_USER_CTRL_FIFO_RST;
+    ret = mpu6050_write(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = mpu6050_write(sensor, MPU6050_FIFO_EN, &fifo_en, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    user_ctrl &= (~MPU6050_USER_CTRL_FIFO_RST);
+    user_ctrl |= MPU6050_USER_CTRL_FIFO_EN;
+    return mpu6050_write(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+}
+
+esp_err_t mpu6050_fifo_disable(mpu6050_handle_t sensor)
+{
+    esp_err_t ret;
+    uint8_t user_ctrl;
+    uint8_t fifo_en = 0x00;
+
+    ret = mpu6050_write(sensor, MPU6050_FIFO_EN, &fifo_en, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = mpu6050_read(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    user_ctrl &= (~MPU6050_USER_CTRL_FIFO_EN);
+    user_ctrl |= MPU6050_USER_CTRL_FIFO_RST;
+    return mpu6050_write(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+}
+
+esp_err_t mpu6050_fifo_reset(mpu6050_handle_t sensor)
+{
+    esp_err_t ret;
+    uint8_t user_ctrl;
+
+    ret = mpu6050_read(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    user_ctrl |= MPU6050_USER_CTRL_FIFO_RST;
+    return mpu6050_write(sensor, MPU6050_USER_CTRL, &user_ctrl, 1);
+}
+
+esp_err_t mpu6050_get_fifo_count(mpu6050_handle_t sensor, uint16_t *const fifo_count)
+{
+    uint8_t data_rd[2];
+    esp_err_t ret = mpu6050_read(sensor, MPU6050_FIFO_COUNTH, data_rd, sizeof(data_rd));
+
+    *fifo_count = (uint16_t)((data_rd[0] << 8) | (data_rd[1]));
+    return ret;
+}
+
+esp_err_t mpu6050_get_sample_period(mpu6050_handle_t sensor, uint32_t *const sample_period_us)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+
+    if (0 == sens->sample_period_us) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *sample_period_us = sens->sample_period_us;
+    return ESP_OK;
+}
+
+/* Either raw_values or motion_values receives the samples, the other one is NULL */
+static esp_err_t mpu6050_fifo_read(mpu6050_handle_t sensor, mpu6050_raw_motion_value_t *const raw_values,
+                                   mpu6050_motion_value_t *const motion_values, const size_t max_samples,
+                                   size_t *const out_samples)
+{
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+    esp_err_t ret;
+    uint16_t fifo_count;
+    size_t frames;
+    uint8_t data_rd[MPU6050_FIFO_READ_FRAMES * MPU6050_MOTION_FRAME_LEN];
+    mpu6050_raw_motion_value_t raw_motion;
+
+    *out_samples = 0;
+
+    if (motion_values) {
+        ret = mpu6050_load_fs(sensor);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    ret = mpu6050_get_fifo_count(sensor, &fifo_count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (fifo_count >= MPU6050_FIFO_SIZE) {
+        /* Oldest bytes were dropped, frame alignment is lost: start over */
+        mpu6050_fifo_reset(sensor);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    frames = fifo_count / MPU6050_MOTION_FRAME_LEN;
+    if (frames > max_samples) {
+        frames = max_samples;
+    }
+
+    while (*out_samples < frames) {
+        size_t chunk = frames - *out_samples;
+        if (chunk > MPU6050_FIFO_READ_FRAMES) {
+            chunk = MPU6050_FIFO_READ_FRAMES;
+        }
+        ret = mpu6050_read(sensor, MPU6050_FIFO_R_W, data_rd, (uint8_t)(chunk * MPU6050_MOTION_FRAME_LEN));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            if (raw_values) {
+                mpu6050_decode_motion(&data_rd[i * MPU6050_MOTION_FRAME_LEN], &raw_values[*out_samples]);
+            } else {
+                mpu6050_decode_motion(&data_rd[i * MPU6050_MOTION_FRAME_LEN], &raw_motion);
+                mpu6050_scale_motion(sens, &raw_motion, &motion_values[*out_samples]);
+            }
+            (*out_samples)++;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_fifo_read_motion(mpu6050_handle_t sensor, mpu6050_motion_value_t *const motion_values,
+                                   const size_t max_samples, size_t *const out_samples)
+{
+    if (NULL == motion_values || NULL == out_samples) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return mpu6050_fifo_read(sensor, NULL, motion_values, max_samples, out_samples);
+}
+
+esp_err_t mpu6050_fifo_read_raw_motion(mpu6050_handle_t sensor, mpu6050_raw_motion_value_t *const raw_values,
+                                       const size_t max_samples, size_t *const out_samples)
+{
+    if (NULL == raw_values || NULL == out_samples) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return mpu6050_fifo_read(sensor, raw_values, NULL, max_samples, out_samples);
+}
+
+esp_err_t mpu6050_complimentory_filter(mpu6050_handle_t sensor, const mpu6050_acce_value_t *const acce_value,
+                                       const mpu6050_gyro_value_t *const gyro_value, complimentary_angle_t *const complimentary_angle)
+{
+    float acce_angle[2];
+    float gyro_angle[2];
+    float gyro_rate[2];
+    mpu6050_dev_t *sens = (mpu6050_dev_t *) sensor;
+
+    sens->counter++;
+    if (sens->counter == 1) {
+        acce_angle[0] = (atan2(acce_value->acce_y, acce_value->acce_z) * RAD_TO_DEG);
+        acce_angle[1] = (atan2(acce_value->acce_x, acce_value->acce_z) * RAD_TO_DEG);
+        complimentary_angle->roll = acce_angle[0];
+        complimentary_angle->pitch = acce_angle[1];
+        gettimeofday(sens->timer, NULL);
+        return ESP_OK;
+    }
+
+    struct timeval now, dt_t;
+    gettimeofday(&now, NULL);
+    timersub(&now, sens->timer, &dt_t);
+    sens->dt = (float) (dt_t.tv_sec) + (float)dt_t.tv_usec / 1000000;
+    gettimeofday(sens->timer, NULL);
+
+    acce_angle[0] = (atan2(acce_value->acce_y, acce_value->acce_z) * RAD_TO_DEG);
+    acce_angle[1] = (atan2(acce_value->acce_x, acce_value->acce_z) * RAD_TO_DEG);
+
+    gyro_rate[0] = gyro_value->gyro_x;
+    gyro_rate[1] = gyro_value->gyro_y;
+    gyro_angle[0] = gyro_rate[0] * sens->dt;
+    gyro_angle[1] = gyro_rate[1] * sens->dt;
+
+    complimentary_angle->roll = (ALPHA * (complimentary_angle->roll + gyro_angle[0])) + ((1 - ALPHA) * acce_angle[0]);
+    complimentary_angle->pitch = (ALPHA * (complimentary_angle->pitch + gyro_angle[1])) + ((1 - ALPHA) * acce_angle[1]);
+
+    return ESP_OK;
+}
@@ -0,0 +1,435 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_bit_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mpu6050_sim.h"
+
+#define DEG_TO_RAD                  0.01745329252f
+
+/* MPU6050 register */
+#define MPU6050_SMPLRT_DIV          0x19u
+#define MPU6050_CONFIG              0x1Au
+#define MPU6050_GYRO_CONFIG         0x1Bu
+#define MPU6050_ACCEL_CONFIG        0x1Cu
+#define MPU6050_FIFO_EN             0x23u
+#define MPU6050_INTR_ENABLE         0x38u
+#define MPU6050_INTR_STATUS         0x3Au
+#define MPU6050_ACCEL_XOUT_H        0x3Bu
+#define MPU6050_TEMP_XOUT_H         0x41u
+#define MPU6050_GYRO_XOUT_H         0x43u
+#define MPU6050_GYRO_ZOUT_L         0x48u
+#define MPU6050_USER_CTRL           0x6Au
+#define MPU6050_PWR_MGMT_1          0x6Bu
+#define MPU6050_FIFO_COUNTH         0x72u
+#define MPU6050_FIFO_COUNTL         0x73u
+#define MPU6050_FIFO_R_W            0x74u
+#define MPU6050_WHO_AM_I            0x75u
+#define MPU6050_REG_COUNT           0x80u
+
+#define MPU6050_WHO_AM_I_VAL        0x68u
+#define MPU6050_FIFO_SIZE           1024u
+#define MPU6050_MOTION_FRAME_LEN    14u
+#define MPU6050_PWR_MGMT_1_RESET    BIT7
+#define MPU6050_PWR_MGMT_1_SLEEP    BIT6
+#define MPU6050_USER_CTRL_FIFO_EN   BIT6
+#define MPU6050_USER_CTRL_FIFO_RST  BIT2
+#define MPU6050_FIFO_EN_TEMP        BIT7
+#define MPU6050_FIFO_EN_XG          BIT6
+#define MPU6050_FIFO_EN_YG          BIT5
+#define MPU6050_FIFO_EN_ZG          BIT4
+#define MPU6050_FIFO_EN_ACCEL       BIT3
+#define MPU6050_INT_DATA_RDY        BIT0
+#define MPU6050_INT_FIFO_OFLOW      BIT4
+
+/* Beyond this many overdue samples only the last ones can still be observed, through the FIFO */
+#define MPU6050_SIM_MAX_CATCH_UP    (MPU6050_FIFO_SIZE / MPU6050_MOTION_FRAME_LEN + 1u)
+
+typedef struct {
+    mpu6050_transport_t base;
+    mpu6050_sim_config_t config;
+    SemaphoreHandle_t lock;         /*!< Serializes accesses, like the I2C bus does */
+    uint8_t regs[MPU6050_REG_COUNT];
+    uint8_t fifo[MPU6050_FIFO_SIZE];
+    uint16_t fifo_head;             /*!< Oldest byte */
+    uint16_t fifo_count;
+    bool clock_started;
+    int64_t next_sample_us;         /*!< Clock time of the next sample */
+    int64_t trace_time_us;          /*!< Trace time of the next sample */
+    uint32_t sample_index;
+    bool int_raised;                /*!< A sample raised an enabled interrupt during this access */
+    mpu6050_sim_sample_t current;
+    mpu6050_sim_stats_t stats;
+} mpu6050_sim_t;
+
+static void mpu6050_sim_reset(mpu6050_sim_t *sim)
+{
+    memset(sim->regs, 0, sizeof(sim->regs));
+    sim->regs[MPU6050_PWR_MGMT_1] = MPU6050_PWR_MGMT_1_SLEEP;
+    sim->regs[MPU6050_WHO_AM_I] = MPU6050_WHO_AM_I_VAL;
+    sim->fifo_head = 0;
+    sim->fifo_count = 0;
+}
+
+static uint32_t mpu6050_sim_period_us(const mpu6050_sim_t *sim)
+{
+    /* Gyroscope output rate is 8 kHz with the DLPF off (DLPF_CFG 0 or 7), 1 kHz otherwise */
+    uint8_t dlpf_cfg = sim->regs[MPU6050_CONFIG] & 0x07u;
+    uint32_t gyro_rate_hz = (dlpf_cfg == 0 || dlpf_cfg == 7) ? 8000u : 1000u;
+
+    return (uint32_t)((1000000ull * (1u + sim->regs[MPU6050_SMPLRT_DIV])) / gyro_rate_hz);
+}
+
+static bool mpu6050_sim_sleeping(const mpu6050_sim_t *sim)
+{
+    return (sim->regs[MPU6050_PWR_MGMT_1] & MPU6050_PWR_MGMT_1_SLEEP) != 0;
+}
+
+static void mpu6050_sim_put_raw(uint8_t *reg, float value, float sensitivity)
+{
+    float scaled = roundf(value * sensitivity);
+
+    if (scaled > INT16_MAX) {
+        scaled = INT16_MAX;
+    } else if (scaled < INT16_MIN) {
+        scaled = INT16_MIN;
+    }
+    int16_t raw = (int16_t) scaled;
+    reg[0] = (uint8_t)((uint16_t) raw >> 8);
+    reg[1] = (uint8_t)((uint16_t) raw & 0xFFu);
+}
+
+static void mpu6050_sim_fifo_push(mpu6050_sim_t *sim, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (sim->fifo_count == MPU6050_FIFO_SIZE) {
+            /* Full: the oldest byte is overwritten */
+            sim->fifo_head = (sim->fifo_head + 1u) % MPU6050_FIFO_SIZE;
+            sim->fifo_count--;
+        }
+        sim->fifo[(sim->fifo_head + sim->fifo_count) % MPU6050_FIFO_SIZE] = data[i];
+        sim->fifo_count++;
+    }
+}
+
+static uint8_t mpu6050_sim_fifo_pop(mpu6050_sim_t *sim)
+{
+    if (sim->fifo_count == 0) {
+        return 0xFFu;
+    }
+    uint8_t value = sim->fifo[sim->fifo_head];
+    sim->fifo_head = (sim->fifo_head + 1u) % MPU6050_FIFO_SIZE;
+    sim->fifo_count--;
+    return value;
+}
+
+static void mpu6050_sim_produce(mpu6050_sim_t *sim)
+{
+    static const float acce_sensitivity[] = {16384.0f, 8192.0f, 4096.0f, 2048.0f};
+    static const float gyro_sensitivity[] = {131.0f, 65.5f, 32.8f, 16.4f};
+    uint8_t *out = &sim->regs[MPU6050_ACCEL_XOUT_H];
+    float acce_lsb = acce_sensitivity[(sim->regs[MPU6050_ACCEL_CONFIG] >> 3) & 0x03u];
+    float gyro_lsb = gyro_sensitivity[(sim->regs[MPU6050_GYRO_CONFIG] >> 3) & 0x03u];
+
+    if (NULL != sim->config.source) {
+        sim->config.source(sim->config.source_arg, sim->sample_index, sim->trace_time_us, &sim->current);
+    }
+    sim->sample_index++;
+    sim->trace_time_us += mpu6050_sim_period_us(sim);
+
+    mpu6050_sim_put_raw(&out[0], sim->current.acce_x, acce_lsb);
+    mpu6050_sim_put_raw(&out[2], sim->current.acce_y, acce_lsb);
+    mpu6050_sim_put_raw(&out[4], sim->current.acce_z, acce_lsb);
+    mpu6050_sim_put_raw(&out[6], sim->current.temp - 36.53f, 340.0f);
+    mpu6050_sim_put_raw(&out[8], sim->current.gyro_x, gyro_lsb);
+    mpu6050_sim_put_raw(&out[10], sim->current.gyro_y, gyro_lsb);
+    mpu6050_sim_put_raw(&out[12], sim->current.gyro_z, gyro_lsb);
+
+    uint8_t fifo_en = sim->regs[MPU6050_FIFO_EN];
+    if ((sim->regs[MPU6050_USER_CTRL] & MPU6050_USER_CTRL_FIFO_EN) && fifo_en) {
+        uint16_t count_before = sim->fifo_count;
+        size_t pushed = 0;
+
+        /* Enabled sensor registers enter the FIFO in register order */
+        if (fifo_en & MPU6050_FIFO_EN_ACCEL) {
+            mpu6050_sim_fifo_push(sim, &out[0], 6);
+            pushed += 6;
+        }
+        if (fifo_en & MPU6050_FIFO_EN_TEMP) {
+            mpu6050_sim_fifo_push(sim, &out[6], 2);
+            pushed += 2;
+        }
+        if (fifo_en & MPU6050_FIFO_EN_XG) {
+            mpu6050_sim_fifo_push(sim, &out[8], 2);
+            pushed += 2;
+        }
+        if (fifo_en & MPU6050_FIFO_EN_YG) {
+            mpu6050_sim_fifo_push(sim, &out[10], 2);
+            pushed += 2;
+        }
+        if (fifo_en & MPU6050_FIFO_EN_ZG) {
+            mpu6050_sim_fifo_push(sim, &out[12], 2);
+            pushed += 2;
+        }
+        if (count_before + pushed > MPU6050_FIFO_SIZE) {
+            sim->regs[MPU6050_INTR_STATUS] |= MPU6050_INT_FIFO_OFLOW;
+            sim->stats.fifo_overflows++;
+        }
+    }
+
+    sim->regs[MPU6050_INTR_STATUS] |= MPU6050_INT_DATA_RDY;
+    if (sim->regs[MPU6050_INTR_ENABLE] & MPU6050_INT_DATA_RDY) {
+        sim->int_raised = true;
+    }
+    sim->stats.samples++;
+}
+
+/* Unlock, then pulse the INT pin once if the access produced an enabled interrupt */
+static void mpu6050_sim_unlock(mpu6050_sim_t *sim)
+{
+    bool raised = sim->int_raised;
+
+    sim->int_raised = false;
+    xSemaphoreGive(sim->lock);
+    if (raised && NULL != sim->config.int_handler) {
+        sim->config.int_handler(sim->config.int_arg);
+    }
+}
+
+/* Produce every sample that became due on the clock since the last access */
+static void mpu6050_sim_sync(mpu6050_sim_t *sim)
+{
+    if (NULL == sim->config.clock) {
+        return;
+    }
+
+    int64_t now = sim->config.clock(sim->config.clock_arg);
+    int64_t period = mpu6050_sim_period_us(sim);
+
+    if (!sim->clock_started || mpu6050_sim_sleeping(sim)) {
+        sim->clock_started = true;
+        sim->next_sample_us = now + period;
+        return;
+    }
+    if (now < sim->next_sample_us) {
+        return;
+    }
+
+    uint64_t due = (uint64_t)((now - sim->next_sample_us) / period) + 1u;
+    if (due > MPU6050_SIM_MAX_CATCH_UP) {
+        uint64_t skipped = due - MPU6050_SIM_MAX_CATCH_UP;
+        sim->sample_index += (uint32_t) skipped;
+        sim->trace_time_us += (int64_t) skipped * period;
+        sim->next_sample_us += (int64_t) skipped * period;
+        due = MPU6050_SIM_MAX_CATCH_UP;
+    }
+    while (due-- > 0) {
+        mpu6050_sim_produce(sim);
+        sim->next_sample_us += period;
+    }
+}
+
+static esp_err_t mpu6050_sim_read_regs(mpu6050_transport_t *transport, uint8_t reg, uint8_t *data, size_t len)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+    bool status_read = false;
+
+    if (reg != MPU6050_FIFO_R_W && reg + len > MPU6050_REG_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(sim->lock, portMAX_DELAY);
+    mpu6050_sim_sync(sim);
+
+    /* FIFO_COUNTH latches the count, so H and L read in one burst always agree */
+    uint16_t fifo_count = sim->fifo_count;
+    for (size_t i = 0; i < len; i++) {
+        if (reg == MPU6050_FIFO_R_W) {
+            data[i] = mpu6050_sim_fifo_pop(sim);
+            continue;
+        }
+        uint8_t addr = (uint8_t)(reg + i);
+        if (addr == MPU6050_FIFO_COUNTH) {
+            data[i] = (uint8_t)(fifo_count >> 8);
+        } else if (addr == MPU6050_FIFO_COUNTL) {
+            data[i] = (uint8_t)(fifo_count & 0xFFu);
+        } else if (addr == MPU6050_FIFO_R_W) {
+            data[i] = mpu6050_sim_fifo_pop(sim);
+        } else {
+            data[i] = sim->regs[addr];
+            status_read |= (addr == MPU6050_INTR_STATUS);
+        }
+    }
+    if (status_read) {
+        sim->regs[MPU6050_INTR_STATUS] = 0;
+    }
+
+    sim->stats.reads++;
+    sim->stats.bytes_read += len;
+    mpu6050_sim_unlock(sim);
+    return ESP_OK;
+}
+
+static esp_err_t mpu6050_sim_write_regs(mpu6050_transport_t *transport, uint8_t reg, const uint8_t *data, size_t len)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+
+    if (reg != MPU6050_FIFO_R_W && reg + len > MPU6050_REG_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(sim->lock, portMAX_DELAY);
+    /* Samples due under the old configuration are produced before it changes */
+    mpu6050_sim_sync(sim);
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t addr = (reg == MPU6050_FIFO_R_W) ? reg : (uint8_t)(reg + i);
+
+        switch (addr) {
+        case MPU6050_FIFO_R_W:
+            mpu6050_sim_fifo_push(sim, &data[i], 1);
+            break;
+        case MPU6050_PWR_MGMT_1:
+            if (data[i] & MPU6050_PWR_MGMT_1_RESET) {
+                mpu6050_sim_reset(sim);
+            } else {
+                sim->regs[addr] = data[i];
+            }
+            break;
+        case MPU6050_USER_CTRL:
+            if (data[i] & MPU6050_USER_CTRL_FIFO_RST) {
+                sim->fifo_head = 0;
+                sim->fifo_count = 0;
+            }
+            sim->regs[addr] = data[i] & (uint8_t) ~MPU6050_USER_CTRL_FIFO_RST;
+            break;
+        case MPU6050_INTR_STATUS:
+        case MPU6050_FIFO_COUNTH:
+        case MPU6050_FIFO_COUNTL:
+        case MPU6050_WHO_AM_I:
+            /* Read only */
+            break;
+        default:
+            if (addr < MPU6050_ACCEL_XOUT_H || addr > MPU6050_GYRO_ZOUT_L) {
+                sim->regs[addr] = data[i];
+            }
+            break;
+        }
+    }
+
+    sim->stats.writes++;
+    mpu6050_sim_unlock(sim);
+    return ESP_OK;
+}
+
+static void mpu6050_sim_del(mpu6050_transport_t *transport)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+
+    vSemaphoreDelete(sim->lock);
+    free(sim);
+}
+
+esp_err_t mpu6050_new_sim_transport(const mpu6050_sim_config_t *config, mpu6050_transport_t **ret_transport)
+{
+    if (NULL == config || NULL == ret_transport) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) calloc(1, sizeof(mpu6050_sim_t));
+    if (NULL == sim) {
+        return ESP_ERR_NO_MEM;
+    }
+    sim->lock = xSemaphoreCreateMutex();
+    if (NULL == sim->lock) {
+        free(sim);
+        return ESP_ERR_NO_MEM;
+    }
+
+    sim->config = *config;
+    mpu6050_sim_reset(sim);
+    /* Flat and still until the source says otherwise */
+    sim->current.acce_z = 1.0f;
+    sim->current.temp = 25.0f;
+
+    sim->base.read_regs = mpu6050_sim_read_regs;
+    sim->base.write_regs = mpu6050_sim_write_regs;
+    sim->base.del = mpu6050_sim_del;
+    *ret_transport = &sim->base;
+    return ESP_OK;
+}
+
+esp_err_t mpu6050_sim_advance(mpu6050_transport_t *transport, uint32_t samples)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(sim->lock, portMAX_DELAY);
+    if (mpu6050_sim_sleeping(sim)) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        while (samples-- > 0) {
+            mpu6050_sim_produce(sim);
+        }
+    }
+    mpu6050_sim_unlock(sim);
+    return ret;
+}
+
+void mpu6050_sim_poll(mpu6050_transport_t *transport)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+
+    xSemaphoreTake(sim->lock, portMAX_DELAY);
+    mpu6050_sim_sync(sim);
+    mpu6050_sim_unlock(sim);
+}
+
+void mpu6050_sim_get_stats(mpu6050_transport_t *transport, mpu6050_sim_stats_t *stats)
+{
+    mpu6050_sim_t *sim = (mpu6050_sim_t *) transport;
+
+    xSemaphoreTake(sim->lock, portMAX_DELAY);
+    *stats = sim->stats;
+    xSemaphoreGive(sim->lock);
+}
+
+bool mpu6050_sim_trace_source(void *arg, uint32_t index, int64_t time_us, mpu6050_sim_sample_t *sample)
+{
+    const mpu6050_sim_trace_t *trace = (const mpu6050_sim_trace_t *) arg;
+
+    if (0 == trace->count || (!trace->loop && index >= trace->count)) {
+        return false;
+    }
+    *sample = trace->samples[index % trace->count];
+    return true;
+}
+
+bool mpu6050_sim_sway_source(void *arg, uint32_t index, int64_t time_us, mpu6050_sim_sample_t *sample)
+{
+    const mpu6050_sim_sway_t *sway = (const mpu6050_sim_sway_t *) arg;
+    float w = 2.0f * (float) M_PI * sway->frequency_hz;
+    float phase = w * (float)((double) time_us / 1000000.0);
+    float roll = (sway->roll_deg + sway->amplitude_deg * sinf(phase)) * DEG_TO_RAD;
+    float pitch = (sway->pitch_deg + sway->amplitude_deg * cosf(phase)) * DEG_TO_RAD;
+
+    /* Gravity vector whose atan(ay / |ax, az|) and atan(-ax / |ay, az|) give roll and pitch exactly */
+    sample->acce_x = -sinf(pitch);
+    sample->acce_y = sinf(roll);
+    float zz = 1.0f - sample->acce_x * sample->acce_x - sample->acce_y * sample->acce_y;
+    sample->acce_z = zz > 0.0f ? sqrtf(zz) : 0.0f;
+
+    /* Angular rates are the derivatives of roll and pitch */
+    sample->gyro_x = sway->amplitude_deg * w * cosf(phase);
+    sample->gyro_y = -sway->amplitude_deg * w * sinf(phase);
+    sample->gyro_z = 0.0f;
+    sample->temp = sway->temp;
+    return true;
+}
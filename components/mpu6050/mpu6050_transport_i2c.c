@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c_master.h"
+#include "mpu6050_transport.h"
+
+#define MPU6050_MAX_WRITE_LEN       8u    /*!< Largest register block written at once */
+#define MPU6050_I2C_TIMEOUT_MS      1000
+
+typedef struct {
+    mpu6050_transport_t base;
+    i2c_master_dev_handle_t dev;
+} mpu6050_i2c_transport_t;
+
+static esp_err_t mpu6050_i2c_read_regs(mpu6050_transport_t *transport, uint8_t reg, uint8_t *data, size_t len)
+{
+    mpu6050_i2c_transport_t *i2c = (mpu6050_i2c_transport_t *) transport;
+
+    return i2c_master_transmit_receive(i2c->dev, &reg, 1, data, len, MPU6050_I2C_TIMEOUT_MS);
+}
+
+static esp_err_t mpu6050_i2c_write_regs(mpu6050_transport_t *transport, uint8_t reg, const uint8_t *data, size_t len)
+{
+    mpu6050_i2c_transport_t *i2c = (mpu6050_i2c_transport_t *) transport;
+    uint8_t write_buf[1 + MPU6050_MAX_WRITE_LEN];
+
+    if (len > MPU6050_MAX_WRITE_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    write_buf[0] = reg;
+    memcpy(&write_buf[1], data, len);
+    return i2c_master_transmit(i2c->dev, write_buf, 1 + len, MPU6050_I2C_TIMEOUT_MS);
+}
+
+static void mpu6050_i2c_del(mpu6050_transport_t *transport)
+{
+    mpu6050_i2c_transport_t *i2c = (mpu6050_i2c_transport_t *) transport;
+
+    i2c_master_bus_rm_device(i2c->dev);
+    free(i2c);
+}
+
+esp_err_t mpu6050_new_i2c_transport(i2c_master_bus_handle_t bus, uint16_t dev_addr, uint32_t scl_speed_hz,
+                                    mpu6050_transport_t **ret_transport)
+{
+    esp_err_t ret;
+
+    if (NULL == ret_transport) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mpu6050_i2c_transport_t *i2c = (mpu6050_i2c_transport_t *) calloc(1, sizeof(mpu6050_i2c_transport_t));
+    if (NULL == i2c) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = dev_addr,
+        .scl_speed_hz = scl_speed_hz,
+    };
+    ret = i2c_master_bus_add_device(bus, &dev_config, &i2c->dev);
+    if (ESP_OK != ret) {
+        free(i2c);
+        return ret;
+    }
+
+    i2c->base.read_regs = mpu6050_i2c_read_regs;
+    i2c->base.write_regs = mpu6050_i2c_write_regs;
+    i2c->base.del = mpu6050_i2c_del;
+    *ret_transport = &i2c->base;
+    return ESP_OK;
+}
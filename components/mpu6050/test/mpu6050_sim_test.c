@@ -0,0 +1,168 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include "unity.h"
+#include "mpu6050.h"
+#include "mpu6050_sim.h"
+
+static const mpu6050_sim_sample_t trace_samples[] = {
+    {.acce_x = 0.0f,  .acce_y = 0.0f, .acce_z = 1.0f,  .gyro_x = 0.0f,   .gyro_y = 0.0f,  .gyro_z = 0.0f, .temp = 25.0f},
+    {.acce_x = 0.5f,  .acce_y = -0.25f, .acce_z = 0.8f, .gyro_x = 100.0f, .gyro_y = -50.0f, .gyro_z = 10.0f, .temp = 30.0f},
+};
+
+static int64_t sim_now_us;
+
+static int64_t sim_clock(void *arg)
+{
+    return sim_now_us;
+}
+
+static mpu6050_handle_t sim_sensor_create(const mpu6050_sim_config_t *config, mpu6050_transport_t **transport)
+{
+    esp_err_t ret = mpu6050_new_sim_transport(config, transport);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+
+    mpu6050_handle_t sensor = mpu6050_create_with_transport(*transport);
+    TEST_ASSERT_NOT_NULL(sensor);
+
+    ret = mpu6050_config(sensor, ACCE_FS_4G, GYRO_FS_500DPS);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    ret = mpu6050_wake_up(sensor);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    return sensor;
+}
+
+TEST_CASE("Sensor mpu6050 sim motion test", "[mpu6050][sim]")
+{
+    mpu6050_sim_trace_t trace = {.samples = trace_samples, .count = 2, .loop = false};
+    mpu6050_sim_config_t config = {.source = mpu6050_sim_trace_source, .source_arg = &trace};
+    mpu6050_transport_t *transport;
+    mpu6050_motion_value_t motion;
+    uint8_t deviceid;
+
+    mpu6050_handle_t sensor = sim_sensor_create(&config, &transport);
+
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_get_deviceid(sensor, &deviceid));
+    TEST_ASSERT_EQUAL_UINT8(MPU6050_WHO_AM_I_VAL, deviceid);
+
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_get_motion(sensor, &motion));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, motion.acce.acce_x);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -0.25f, motion.acce.acce_y);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.8f, motion.acce.acce_z);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 100.0f, motion.gyro.gyro_x);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, -50.0f, motion.gyro.gyro_y);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 10.0f, motion.gyro.gyro_z);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 30.0f, motion.temp.temp);
+
+    /* The trace has ended: the sensor keeps its last output */
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_get_motion(sensor, &motion));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, motion.acce.acce_x);
+
+    mpu6050_delete(sensor);
+}
+
+TEST_CASE("Sensor mpu6050 sim fifo test", "[mpu6050][sim]")
+{
+    mpu6050_sim_trace_t trace = {.samples = trace_samples, .count = 2, .loop = true};
+    mpu6050_sim_config_t config = {.source = mpu6050_sim_trace_source, .source_arg = &trace};
+    mpu6050_transport_t *transport;
+    mpu6050_motion_value_t samples[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_sim_stats_t stats;
+    size_t count;
+
+    mpu6050_handle_t sensor = sim_sensor_create(&config, &transport);
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_fifo_enable(sensor, 200));
+
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 20));
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_fifo_read_motion(sensor, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(20, count);
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, trace_samples[i % 2].acce_x, samples[i].acce.acce_x);
+        TEST_ASSERT_FLOAT_WITHIN(0.02f, trace_samples[i % 2].gyro_x, samples[i].gyro.gyro_x);
+    }
+
+    /* More samples than the FIFO holds: overflow is reported and the FIFO starts over */
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, MPU6050_FIFO_MAX_SAMPLES + 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, mpu6050_fifo_read_motion(sensor, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    mpu6050_sim_get_stats(transport, &stats);
+    TEST_ASSERT_GREATER_THAN(0, stats.fifo_overflows);
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_fifo_read_motion(sensor, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    mpu6050_delete(sensor);
+}
+
+TEST_CASE("Sensor mpu6050 sim clock test", "[mpu6050][sim]")
+{
+    mpu6050_sim_sway_t sway = {.roll_deg = 10.0f, .pitch_deg = -5.0f, .amplitude_deg = 0.0f, .frequency_hz = 1.0f, .temp = 25.0f};
+    mpu6050_sim_config_t config = {.source = mpu6050_sim_sway_source, .source_arg = &sway, .clock = sim_clock};
+    mpu6050_transport_t *transport;
+    mpu6050_motion_value_t samples[MPU6050_FIFO_MAX_SAMPLES];
+    size_t count;
+
+    sim_now_us = 0;
+    mpu6050_handle_t sensor = sim_sensor_create(&config, &transport);
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_fifo_enable(sensor, 100));
+
+    /* 100 ms at 100 Hz, without waiting for it */
+    sim_now_us += 100000;
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_fifo_read_motion(sensor, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(10, count);
+
+    /* Gravity vector of a sensor held at 10 degrees roll and -5 degrees pitch */
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0872f, samples[0].acce.acce_x);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.1736f, samples[0].acce.acce_y);
+
+    mpu6050_delete(sensor);
+}
+
+static int int_pulses;
+
+static void sim_int_handler(void *arg)
+{
+    int_pulses++;
+}
+
+TEST_CASE("Sensor mpu6050 sim interrupt test", "[mpu6050][sim]")
+{
+    mpu6050_sim_config_t config = {.clock = sim_clock, .int_handler = sim_int_handler};
+    mpu6050_transport_t *transport;
+    mpu6050_sim_stats_t stats;
+
+    sim_now_us = 0;
+    int_pulses = 0;
+    mpu6050_handle_t sensor = sim_sensor_create(&config, &transport);
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_set_sample_rate(sensor, 100));
+
+    /* DATA_RDY_EN is off after power on */
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 1));
+    TEST_ASSERT_EQUAL(0, int_pulses);
+
+    /* One pulse per access, however many samples it produced */
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_enable_interrupts(sensor, MPU6050_DATA_RDY_INT_BIT));
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 3));
+    TEST_ASSERT_EQUAL(1, int_pulses);
+
+    /* Samples due on the clock fire it without a register access */
+    mpu6050_sim_get_stats(transport, &stats);
+    uint32_t samples = stats.samples;
+    sim_now_us += 30000;
+    mpu6050_sim_poll(transport);
+    TEST_ASSERT_EQUAL(2, int_pulses);
+    mpu6050_sim_get_stats(transport, &stats);
+    TEST_ASSERT_EQUAL(samples + 3, stats.samples);
+    mpu6050_sim_poll(transport);
+    TEST_ASSERT_EQUAL(2, int_pulses);
+
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_disable_interrupts(sensor, MPU6050_DATA_RDY_INT_BIT));
+    TEST_ASSERT_EQUAL(ESP_OK, mpu6050_sim_advance(transport, 1));
+    TEST_ASSERT_EQUAL(2, int_pulses);
+
+    mpu6050_delete(sensor);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Flash backend of the sample journal
+ *
+ * The journal reaches flash only through these operations, so the same log code runs
+ * on a partition or, on a host, on a file that emulates NOR flash.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct journal_flash_t journal_flash_t;
+
+/**
+ * @brief NOR flash: erase sets a whole sector to 0xFF, writes can only clear bits
+ *
+ * Offsets are relative to the start of the backend.
+ */
+struct journal_flash_t {
+    uint32_t size;          /*!< Bytes, a multiple of sector_size */
+    uint32_t sector_size;   /*!< Erase unit in bytes */
+
+    esp_err_t (*read)(journal_flash_t *flash, uint32_t offset, void *data, size_t len);
+    esp_err_t (*write)(journal_flash_t *flash, uint32_t offset, const void *data, size_t len);
+
+    /**
+     * @brief Erase the sector starting at offset
+     */
+    esp_err_t (*erase_sector)(journal_flash_t *flash, uint32_t offset);
+
+    /**
+     * @brief Release the backend and everything it owns
+     */
+    void (*del)(journal_flash_t *flash);
+};
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Backend over a data partition
+ *
+ * @param label Partition label in the partition table
+ * @param ret_flash Returned backend
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_NOT_FOUND No data partition with this label
+ *     - ESP_ERR_NO_MEM Out of memory
+ */
+esp_err_t journal_new_partition_flash(const char *label, journal_flash_t **ret_flash);
+#endif
+
+/**
+ * @brief Backend over a file, for host tests
+ *
+ * The file is created erased (0xFF) if it does not exist or has another size, and keeps
+ * its content otherwise, like flash across a reboot. Writes AND the data into what is
+ * there, as NOR flash does, so a missing erase shows up as corrupt records.
+ *
+ * @param path File name
+ * @param size Bytes, a multiple of sector_size
+ * @param sector_size Erase unit in bytes
+ * @param ret_flash Returned backend
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Size not a multiple of sector_size
+ *     - ESP_FAIL The file cannot be opened
+ *     - ESP_ERR_NO_MEM Out of memory
+ */
+esp_err_t journal_new_file_flash(const char *path, uint32_t size, uint32_t sector_size, journal_flash_t **ret_flash);
+
+#ifdef __cplusplus
+}
+#endif
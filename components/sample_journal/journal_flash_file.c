@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "journal_flash.h"
+
+#define JOURNAL_FILE_CHUNK      256
+
+typedef struct {
+    journal_flash_t base;
+    FILE *file;
+} journal_file_flash_t;
+
+static esp_err_t journal_file_read(journal_flash_t *flash, uint32_t offset, void *data, size_t len)
+{
+    journal_file_flash_t *file = (journal_file_flash_t *) flash;
+
+    if (offset + len > flash->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (fseek(file->file, offset, SEEK_SET) != 0 || fread(data, 1, len, file->file) != len) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* Writes only clear bits, like NOR flash */
+static esp_err_t journal_file_write(journal_flash_t *flash, uint32_t offset, const void *data, size_t len)
+{
+    journal_file_flash_t *file = (journal_file_flash_t *) flash;
+    const uint8_t *src = (const uint8_t *) data;
+    uint8_t chunk[JOURNAL_FILE_CHUNK];
+
+    if (offset + len > flash->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    while (len > 0) {
+        size_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+        esp_err_t ret = journal_file_read(flash, offset, chunk, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] &= src[i];
+        }
+        if (fseek(file->file, offset, SEEK_SET) != 0 || fwrite(chunk, 1, n, file->file) != n) {
+            return ESP_FAIL;
+        }
+        offset += n;
+        src += n;
+        len -= n;
+    }
+    return fflush(file->file) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t journal_file_fill(journal_file_flash_t *file, uint32_t offset, uint32_t len)
+{
+    uint8_t chunk[JOURNAL_FILE_CHUNK];
+
+    memset(chunk, 0xFF, sizeof(chunk));
+    if (fseek(file->file, offset, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    while (len > 0) {
+        size_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+        if (fwrite(chunk, 1, n, file->file) != n) {
+            return ESP_FAIL;
+        }
+        len -= n;
+    }
+    return fflush(file->file) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t journal_file_erase_sector(journal_flash_t *flash, uint32_t offset)
+{
+    if (offset % flash->sector_size != 0 || offset >= flash->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return journal_file_fill((journal_file_flash_t *) flash, offset, flash->sector_size);
+}
+
+static void journal_file_del(journal_flash_t *flash)
+{
+    journal_file_flash_t *file = (journal_file_flash_t *) flash;
+
+    fclose(file->file);
+    free(file);
+}
+
+esp_err_t journal_new_file_flash(const char *path, uint32_t size, uint32_t sector_size, journal_flash_t **ret_flash)
+{
+    if (0 == sector_size || 0 == size || size % sector_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    journal_file_flash_t *file = (journal_file_flash_t *) calloc(1, sizeof(journal_file_flash_t));
+    if (NULL == file) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Keep the content of a file of the right size, as flash keeps it across a reboot */
+    file->file = fopen(path, "r+b");
+    if (file->file != NULL) {
+        if (fseek(file->file, 0, SEEK_END) != 0 || ftell(file->file) != (long) size) {
+            fclose(file->file);
+            file->file = NULL;
+        }
+    }
+    if (NULL == file->file) {
+        file->file = fopen(path, "w+b");
+        if (NULL == file->file || journal_file_fill(file, 0, size) != ESP_OK) {
+            if (file->file != NULL) {
+                fclose(file->file);
+            }
+            free(file);
+            return ESP_FAIL;
+        }
+    }
+
+    file->base.size = size;
+    file->base.sector_size = sector_size;
+    file->base.read = journal_file_read;
+    file->base.write = journal_file_write;
+    file->base.erase_sector = journal_file_erase_sector;
+    file->base.del = journal_file_del;
+
+    *ret_flash = &file->base;
+    return ESP_OK;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include "esp_partition.h"
+#include "journal_flash.h"
+
+typedef struct {
+    journal_flash_t base;
+    const esp_partition_t *partition;
+} journal_partition_flash_t;
+
+static esp_err_t journal_partition_read(journal_flash_t *flash, uint32_t offset, void *data, size_t len)
+{
+    journal_partition_flash_t *part = (journal_partition_flash_t *) flash;
+
+    return esp_partition_read(part->partition, offset, data, len);
+}
+
+static esp_err_t journal_partition_write(journal_flash_t *flash, uint32_t offset, const void *data, size_t len)
+{
+    journal_partition_flash_t *part = (journal_partition_flash_t *) flash;
+
+    return esp_partition_write(part->partition, offset, data, len);
+}
+
+static esp_err_t journal_partition_erase_sector(journal_flash_t *flash, uint32_t offset)
+{
+    journal_partition_flash_t *part = (journal_partition_flash_t *) flash;
+
+    return esp_partition_erase_range(part->partition, offset, flash->sector_size);
+}
+
+static void journal_partition_del(journal_flash_t *flash)
+{
+    free(flash);
+}
+
+esp_err_t journal_new_partition_flash(const char *label, journal_flash_t **ret_flash)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (NULL == partition) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    journal_partition_flash_t *part = (journal_partition_flash_t *) calloc(1, sizeof(journal_partition_flash_t));
+    if (NULL == part) {
+        return ESP_ERR_NO_MEM;
+    }
+    part->partition = partition;
+    part->base.sector_size = partition->erase_size;
+    part->base.size = partition->size - partition->size % partition->erase_size;
+    part->base.read = journal_partition_read;
+    part->base.write = journal_partition_write;
+    part->base.erase_sector = journal_partition_erase_sector;
+    part->base.del = journal_partition_del;
+
+    *ret_flash = &part->base;
+    return ESP_OK;
+}
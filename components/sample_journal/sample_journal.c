@@ -0,0 +1,429 @@
+#include <string.h>
+#include "sample_journal.h"
+
+#define JOURNAL_MAGIC           0x4c4e4a53u     /*!< "SJNL" */
+#define JOURNAL_READ_CHUNK      512             /*!< Bytes read from flash at once while peeking */
+
+typedef struct {
+    uint32_t magic;         /*!< JOURNAL_MAGIC, cleared to 0 once every record was released */
+    uint32_t seq;           /*!< One more than the sector written before */
+    uint32_t record_size;
+    uint32_t crc;           /*!< CRC32 of the fields above, with magic JOURNAL_MAGIC */
+} journal_header_t;
+
+typedef enum {
+    SECTOR_FREE,            /*!< Erased, torn or from another format */
+    SECTOR_RELEASED,        /*!< Complete header, magic cleared */
+    SECTOR_VALID,
+} sector_state_t;
+
+/* CRC-32 (IEEE), nibble table */
+static const uint32_t crc_table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc_table[crc & 0x0f];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0f];
+    }
+    return crc;
+}
+
+static uint32_t header_crc(uint32_t seq, uint32_t record_size)
+{
+    uint32_t fields[3] = { JOURNAL_MAGIC, seq, record_size };
+
+    return ~crc32_update(0xffffffffu, fields, sizeof(fields));
+}
+
+/* The sequence number is part of the record CRC, so a record is only valid in the sector it was written to */
+static uint32_t record_crc(uint32_t seq, const void *record, size_t record_size)
+{
+    return ~crc32_update(crc32_update(0xffffffffu, &seq, sizeof(seq)), record, record_size);
+}
+
+static uint32_t sector_offset(const sample_journal_t *journal, uint32_t sector)
+{
+    return sector * journal->flash->sector_size;
+}
+
+static uint32_t slot_offset(const sample_journal_t *journal, uint32_t sector, uint32_t slot)
+{
+    return sector_offset(journal, sector) + sizeof(journal_header_t) + slot * journal->slot_size;
+}
+
+static sector_state_t read_sector_state(sample_journal_t *journal, uint32_t sector, uint32_t *seq)
+{
+    journal_header_t header;
+
+    if (journal->flash->read(journal->flash, sector_offset(journal, sector), &header, sizeof(header)) != ESP_OK) {
+        return SECTOR_FREE;
+    }
+    if ((header.magic != JOURNAL_MAGIC && header.magic != 0) || header.record_size != journal->record_size ||
+            header.crc != header_crc(header.seq, header.record_size)) {
+        return SECTOR_FREE;
+    }
+    *seq = header.seq;
+    return header.magic == JOURNAL_MAGIC ? SECTOR_VALID : SECTOR_RELEASED;
+}
+
+static bool slot_is_erased(const uint8_t *slot, uint32_t slot_size)
+{
+    for (uint32_t i = 0; i < slot_size; i++) {
+        if (slot[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool slot_is_valid(const sample_journal_t *journal, uint32_t seq, const uint8_t *slot)
+{
+    uint32_t crc;
+
+    memcpy(&crc, slot + journal->record_size, sizeof(crc));
+    return crc == record_crc(seq, slot, journal->record_size);
+}
+
+static uint32_t slot_mark(const sample_journal_t *journal, const uint8_t *slot)
+{
+    uint32_t mark;
+
+    memcpy(&mark, slot + journal->slot_size - sizeof(mark), sizeof(mark));
+    return mark;
+}
+
+/* Slots written in the head sector: everything after the last non-erased slot is free */
+static esp_err_t find_head_slot(sample_journal_t *journal)
+{
+    uint8_t slot[JOURNAL_READ_CHUNK];
+
+    journal->head_slot = 0;
+    for (uint32_t i = 0; i < journal->slots_per_sector; i++) {
+        esp_err_t ret = journal->flash->read(journal->flash, slot_offset(journal, journal->head_sector, i), slot,
+                                             journal->slot_size);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (!slot_is_erased(slot, journal->slot_size)) {
+            journal->head_slot = i + 1;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Slots released in the tail sector: up to the last one with its mark cleared, even partly */
+static esp_err_t find_tail_slot(sample_journal_t *journal)
+{
+    uint8_t slot[JOURNAL_READ_CHUNK];
+    uint32_t end = journal->tail_sector == journal->head_sector ? journal->head_slot : journal->slots_per_sector;
+
+    journal->tail_slot = 0;
+    for (uint32_t i = 0; i < end; i++) {
+        esp_err_t ret = journal->flash->read(journal->flash, slot_offset(journal, journal->tail_sector, i), slot,
+                                             journal->slot_size);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (slot_mark(journal, slot) != 0xffffffffu) {
+            journal->tail_slot = i + 1;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t mark_released(sample_journal_t *journal, uint32_t sector, uint32_t slot)
+{
+    uint32_t mark = 0;
+
+    return journal->flash->write(journal->flash, slot_offset(journal, sector, slot) + journal->slot_size - sizeof(mark),
+                                 &mark, sizeof(mark));
+}
+
+static esp_err_t invalidate_sector(sample_journal_t *journal, uint32_t sector)
+{
+    uint32_t magic = 0;
+
+    return journal->flash->write(journal->flash, sector_offset(journal, sector), &magic, sizeof(magic));
+}
+
+/* Last sector written, released or not, and the run of valid sectors ending there */
+static esp_err_t recover(sample_journal_t *journal)
+{
+    uint32_t n = journal->sector_count;
+    uint32_t head_seq = 0;
+    int head = -1;
+    sector_state_t head_state = SECTOR_FREE;
+
+    for (uint32_t s = 0; s < n; s++) {
+        uint32_t seq;
+        sector_state_t state = read_sector_state(journal, s, &seq);
+        if (state != SECTOR_FREE && (head < 0 || (int32_t)(seq - head_seq) > 0)) {
+            head = (int) s;
+            head_seq = seq;
+            head_state = state;
+        }
+    }
+
+    if (head < 0) {
+        /* Empty: the first append takes sector 0 */
+        journal->head_sector = n - 1;
+        journal->head_seq = 0;
+        journal->head_slot = journal->slots_per_sector;
+    } else {
+        journal->head_sector = (uint32_t) head;
+        journal->head_seq = head_seq;
+        if (head_state == SECTOR_RELEASED) {
+            journal->head_slot = journal->slots_per_sector;
+        } else {
+            esp_err_t ret = find_head_slot(journal);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    }
+
+    journal->tail_sector = journal->head_sector;
+    journal->tail_slot = journal->head_slot;
+    journal->pending = 0;
+    if (head_state != SECTOR_VALID) {
+        return ESP_OK;
+    }
+
+    journal->tail_slot = 0;
+    journal->pending = journal->head_slot;
+    for (uint32_t k = 1; k < n; k++) {
+        uint32_t s = (journal->head_sector + n - k) % n;
+        uint32_t seq;
+        if (read_sector_state(journal, s, &seq) != SECTOR_VALID || seq != head_seq - k) {
+            break;
+        }
+        journal->tail_sector = s;
+        journal->pending += journal->slots_per_sector;
+    }
+
+    esp_err_t ret = find_tail_slot(journal);
+    journal->pending -= journal->tail_slot;
+    return ret;
+}
+
+esp_err_t sample_journal_open(sample_journal_t *journal, journal_flash_t *flash, size_t record_size)
+{
+    if (NULL == journal || NULL == flash || 0 == record_size || 0 == flash->sector_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(journal, 0, sizeof(*journal));
+    journal->flash = flash;
+    journal->record_size = record_size;
+    /* Record, CRC, padding to 4 bytes, then the release mark */
+    journal->slot_size = (uint32_t)((record_size + sizeof(uint32_t) + 3) & ~(size_t) 3) + sizeof(uint32_t);
+    journal->sector_count = flash->size / flash->sector_size;
+    if (journal->sector_count < 2 || journal->slot_size > JOURNAL_READ_CHUNK ||
+            flash->sector_size < sizeof(journal_header_t) + journal->slot_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    journal->slots_per_sector = (flash->sector_size - sizeof(journal_header_t)) / journal->slot_size;
+
+    return recover(journal);
+}
+
+/* Drop the oldest sector to make room for the head */
+static void drop_tail_sector(sample_journal_t *journal)
+{
+    uint32_t lost = journal->slots_per_sector - journal->tail_slot;
+
+    journal->pending -= lost;
+    journal->stats.dropped += lost;
+    journal->tail_sector = (journal->tail_sector + 1) % journal->sector_count;
+    journal->tail_slot = 0;
+    /* What was peeked may be gone: the next release must not skip unread records */
+    journal->peeked_slots = 0;
+}
+
+static esp_err_t start_sector(sample_journal_t *journal)
+{
+    uint32_t next = (journal->head_sector + 1) % journal->sector_count;
+
+    if (journal->pending > 0 && next == journal->tail_sector) {
+        drop_tail_sector(journal);
+    }
+
+    esp_err_t ret = journal->flash->erase_sector(journal->flash, sector_offset(journal, next));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    journal->stats.erases++;
+
+    journal_header_t header = {
+        .magic = JOURNAL_MAGIC,
+        .seq = journal->head_seq + 1,
+        .record_size = (uint32_t) journal->record_size,
+        .crc = header_crc(journal->head_seq + 1, (uint32_t) journal->record_size),
+    };
+    ret = journal->flash->write(journal->flash, sector_offset(journal, next), &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    journal->head_sector = next;
+    journal->head_seq = header.seq;
+    journal->head_slot = 0;
+    if (0 == journal->pending) {
+        journal->tail_sector = next;
+        journal->tail_slot = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sample_journal_append(sample_journal_t *journal, const void *record)
+{
+    uint8_t slot[JOURNAL_READ_CHUNK];
+
+    if (journal->head_slot >= journal->slots_per_sector) {
+        esp_err_t ret = start_sector(journal);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    /* Record and CRC in one write; padding and mark stay erased */
+    uint32_t crc = record_crc(journal->head_seq, record, journal->record_size);
+    memcpy(slot, record, journal->record_size);
+    memcpy(slot + journal->record_size, &crc, sizeof(crc));
+    esp_err_t ret = journal->flash->write(journal->flash, slot_offset(journal, journal->head_sector, journal->head_slot),
+                                          slot, journal->record_size + sizeof(crc));
+    /* A failed write may have left part of the slot written: it is skipped either way */
+    journal->head_slot++;
+    journal->pending++;
+    if (ret == ESP_OK) {
+        journal->stats.appended++;
+    }
+    return ret;
+}
+
+size_t sample_journal_peek(sample_journal_t *journal, void *records, size_t max_records)
+{
+    uint8_t chunk[JOURNAL_READ_CHUNK];
+    uint8_t *out = (uint8_t *) records;
+    uint32_t sector = journal->tail_sector;
+    uint32_t slot = journal->tail_slot;
+    uint32_t covered = 0;
+    uint32_t seq = 0;
+    size_t copied = 0;
+
+    read_sector_state(journal, sector, &seq);
+    while (copied < max_records && covered < journal->pending) {
+        if (slot == journal->slots_per_sector) {
+            sector = (sector + 1) % journal->sector_count;
+            slot = 0;
+            read_sector_state(journal, sector, &seq);
+        }
+
+        /* As many slots as fit in the chunk, without leaving the sector or the log */
+        uint32_t n = JOURNAL_READ_CHUNK / journal->slot_size;
+        if (n > journal->slots_per_sector - slot) {
+            n = journal->slots_per_sector - slot;
+        }
+        if (n > journal->pending - covered) {
+            n = journal->pending - covered;
+        }
+        if (n > max_records - copied) {
+            n = (uint32_t)(max_records - copied);
+        }
+        if (journal->flash->read(journal->flash, slot_offset(journal, sector, slot), chunk, n * journal->slot_size) != ESP_OK) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            const uint8_t *p = chunk + i * journal->slot_size;
+            if (slot_is_valid(journal, seq, p)) {
+                memcpy(out + copied * journal->record_size, p, journal->record_size);
+                copied++;
+            }
+        }
+        slot += n;
+        covered += n;
+    }
+
+    journal->peeked_slots = covered;
+    journal->stats.corrupt += covered - (uint32_t) copied;
+    return copied;
+}
+
+esp_err_t sample_journal_release(sample_journal_t *journal)
+{
+    uint32_t n = journal->peeked_slots;
+    esp_err_t ret = ESP_OK;
+    bool marked = true;
+
+    journal->peeked_slots = 0;
+    while (n > 0 && journal->pending > 0) {
+        uint32_t end = journal->tail_sector == journal->head_sector ? journal->head_slot : journal->slots_per_sector;
+        uint32_t step = end - journal->tail_slot;
+        if (step > n) {
+            step = n;
+        }
+        journal->tail_slot += step;
+        journal->pending -= step;
+        journal->stats.released += step;
+        n -= step;
+        marked = false;
+
+        if (journal->tail_slot == journal->slots_per_sector) {
+            /* Fully read: recovery must not bring it back */
+            esp_err_t err = invalidate_sector(journal, journal->tail_sector);
+            if (err != ESP_OK) {
+                ret = err;
+            }
+            marked = true;
+            if (journal->tail_sector != journal->head_sector) {
+                journal->tail_sector = (journal->tail_sector + 1) % journal->sector_count;
+                journal->tail_slot = 0;
+            }
+        }
+    }
+
+    /* Within a sector only the last released slot is marked: recovery releases everything before it */
+    if (!marked) {
+        esp_err_t err = mark_released(journal, journal->tail_sector, journal->tail_slot - 1);
+        if (err != ESP_OK) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
+uint32_t sample_journal_pending(const sample_journal_t *journal)
+{
+    return journal->pending;
+}
+
+uint32_t sample_journal_capacity(const sample_journal_t *journal)
+{
+    /* The sector being filled when the head catches up with the tail takes one sector's worth */
+    return (journal->sector_count - 1) * journal->slots_per_sector;
+}
+
+void sample_journal_get_stats(const sample_journal_t *journal, sample_journal_stats_t *stats)
+{
+    *stats = journal->stats;
+}
+
+esp_err_t sample_journal_format(sample_journal_t *journal)
+{
+    for (uint32_t s = 0; s < journal->sector_count; s++) {
+        esp_err_t ret = journal->flash->erase_sector(journal->flash, sector_offset(journal, s));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        journal->stats.erases++;
+    }
+    return recover(journal);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Append-only log of fixed-size records in flash, for store-and-forward
+ *
+ * Records are appended to the current sector and the sectors are used round robin, so
+ * every sector is erased once per trip around the partition and wear is even. Each
+ * sector starts with a header holding a sequence number; each record is followed by a
+ * CRC32. Nothing but the current positions is kept in RAM.
+ *
+ * A reader takes records from the oldest end with sample_journal_peek() and drops them
+ * with sample_journal_release() once they are safely elsewhere. A fully released sector
+ * is invalidated by clearing its header magic, so it needs no erase until it is reused.
+ * When the log is full, appending erases the oldest sector and its records are dropped.
+ *
+ * sample_journal_open() rebuilds the positions from flash after a reset: the sectors
+ * with valid headers and consecutive sequence numbers are the log, a record torn by a
+ * power loss fails its CRC and is skipped. A release clears a mark in the last slot it
+ * covers, so released records are not read again after a reset, except those of a
+ * release interrupted by the reset: consumers must tolerate seeing a record twice.
+ *
+ * Not thread safe: one task appends and reads.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "journal_flash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t appended;      /*!< Records written since open */
+    uint32_t released;      /*!< Records released by the reader since open */
+    uint32_t dropped;       /*!< Records erased unread because the log was full */
+    uint32_t corrupt;       /*!< Slots skipped for a bad CRC, torn by a power loss */
+    uint32_t erases;        /*!< Sectors erased since open */
+} sample_journal_stats_t;
+
+/**
+ * @brief Journal state; fields are private, use the functions below
+ *
+ * Positions are a sector index and a slot within it. tail is the oldest unreleased slot,
+ * head the next slot to write. pending counts the slots between them, torn ones included.
+ */
+typedef struct {
+    journal_flash_t *flash;
+    size_t record_size;
+    uint32_t slot_size;         /*!< Record, its CRC and the release mark, 4 byte aligned */
+    uint32_t slots_per_sector;
+    uint32_t sector_count;
+    uint32_t head_sector;
+    uint32_t head_slot;         /*!< slots_per_sector when a new sector is needed */
+    uint32_t head_seq;          /*!< Sequence number of the head sector */
+    uint32_t tail_sector;
+    uint32_t tail_slot;
+    uint32_t pending;
+    uint32_t peeked_slots;      /*!< Slots covered by the last peek, released by sample_journal_release() */
+    sample_journal_stats_t stats;
+} sample_journal_t;
+
+/**
+ * @brief Open the journal on a flash backend, recovering what a previous run left
+ *
+ * Sectors written with another record_size are treated as free.
+ *
+ * @param journal Journal state
+ * @param flash Backend, owned by the caller for the journal's lifetime
+ * @param record_size Size of one record in bytes
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Fewer than two sectors, or a record does not fit in a sector
+ *     - Others Error from the backend
+ */
+esp_err_t sample_journal_open(sample_journal_t *journal, journal_flash_t *flash, size_t record_size);
+
+/**
+ * @brief Write a record at the head; erases the oldest sector first if the log is full
+ */
+esp_err_t sample_journal_append(sample_journal_t *journal, const void *record);
+
+/**
+ * @brief Copy up to max_records of the oldest records out, without releasing them
+ *
+ * Torn records are skipped. A new peek starts from the oldest record again.
+ *
+ * @return Number of records copied
+ */
+size_t sample_journal_peek(sample_journal_t *journal, void *records, size_t max_records);
+
+/**
+ * @brief Drop the records returned by the last sample_journal_peek()
+ */
+esp_err_t sample_journal_release(sample_journal_t *journal);
+
+/**
+ * @brief Records waiting to be read, counting torn ones that will be skipped
+ */
+uint32_t sample_journal_pending(const sample_journal_t *journal);
+
+/**
+ * @brief Records kept at least before appending drops the oldest
+ */
+uint32_t sample_journal_capacity(const sample_journal_t *journal);
+
+void sample_journal_get_stats(const sample_journal_t *journal, sample_journal_stats_t *stats);
+
+/**
+ * @brief Erase every sector: the journal is empty afterwards
+ */
+esp_err_t sample_journal_format(sample_journal_t *journal);
+
+#ifdef __cplusplus
+}
+#endif
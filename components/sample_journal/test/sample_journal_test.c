@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "sample_journal.h"
+
+#define TEST_FILE_PATH          "sample_journal_test.bin"
+#define TEST_FILE_SECTORS       16
+#define TEST_SECTOR_SIZE        4096
+#define TEST_PARTITION_LABEL    "journal"
+#define PEEK_RECORDS            64
+#define BENCH_RECORDS           20000
+
+static const char *TAG = "sample journal test";
+
+/* Same size as an uploaded record of a few sensors; every word derives from seq */
+typedef struct {
+    uint32_t seq;
+    uint32_t payload[6];
+    uint32_t check;
+} test_record_t;
+
+static void make_record(uint32_t seq, test_record_t *record)
+{
+    record->seq = seq;
+    for (int i = 0; i < 6; i++) {
+        record->payload[i] = seq * 2654435761u + i;
+    }
+    record->check = ~seq;
+}
+
+static void check_record(const test_record_t *record, uint32_t seq)
+{
+    TEST_ASSERT_EQUAL_UINT32(seq, record->seq);
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_UINT32(seq * 2654435761u + i, record->payload[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32((uint32_t) ~seq, record->check);
+}
+
+/* A file on the host, the journal partition on a target: same log code either way */
+static journal_flash_t *open_flash(void)
+{
+    journal_flash_t *flash = NULL;
+#if CONFIG_IDF_TARGET_LINUX
+    TEST_ASSERT_EQUAL(ESP_OK, journal_new_file_flash(TEST_FILE_PATH, TEST_FILE_SECTORS * TEST_SECTOR_SIZE,
+                                                     TEST_SECTOR_SIZE, &flash));
+#else
+    if (journal_new_partition_flash(TEST_PARTITION_LABEL, &flash) != ESP_OK) {
+        TEST_IGNORE_MESSAGE("No \"journal\" data partition");
+    }
+#endif
+    return flash;
+}
+
+static journal_flash_t *open_empty(sample_journal_t *journal)
+{
+    journal_flash_t *flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_format(journal));
+    TEST_ASSERT_EQUAL_UINT32(0, sample_journal_pending(journal));
+    return flash;
+}
+
+static void append_range(sample_journal_t *journal, uint32_t first, uint32_t count)
+{
+    test_record_t record;
+
+    for (uint32_t seq = first; seq < first + count; seq++) {
+        make_record(seq, &record);
+        TEST_ASSERT_EQUAL(ESP_OK, sample_journal_append(journal, &record));
+    }
+}
+
+/* Reads everything, releasing as it goes; returns the number of records seen */
+static uint32_t drain(sample_journal_t *journal, uint32_t first_seq)
+{
+    static test_record_t records[PEEK_RECORDS];
+    uint32_t seq = first_seq;
+    size_t n;
+
+    while ((n = sample_journal_peek(journal, records, PEEK_RECORDS)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            check_record(&records[i], seq++);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, sample_journal_release(journal));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, sample_journal_pending(journal));
+    return seq - first_seq;
+}
+
+TEST_CASE("Sample journal reads back in order across sectors", "[sample_journal]")
+{
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    uint32_t count = 3 * journal.slots_per_sector + 7;
+    test_record_t records[4];
+
+    append_range(&journal, 0, count);
+    TEST_ASSERT_EQUAL_UINT32(count, sample_journal_pending(&journal));
+
+    /* An unreleased peek is read again */
+    TEST_ASSERT_EQUAL(4, sample_journal_peek(&journal, records, 4));
+    check_record(&records[0], 0);
+    TEST_ASSERT_EQUAL(4, sample_journal_peek(&journal, records, 4));
+    check_record(&records[3], 3);
+
+    TEST_ASSERT_EQUAL_UINT32(count, drain(&journal, 0));
+
+    /* Appending continues after a complete drain */
+    append_range(&journal, count, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, drain(&journal, count));
+    flash->del(flash);
+}
+
+TEST_CASE("Sample journal recovers its positions after a reset", "[sample_journal]")
+{
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    uint32_t spp = journal.slots_per_sector;
+    test_record_t records[PEEK_RECORDS];
+
+    /* Release two full sectors and part of the third, then "reset" */
+    append_range(&journal, 0, 4 * spp + 5);
+    uint32_t released = 0;
+    while (released < 2 * spp + 3) {
+        size_t n = sample_journal_peek(&journal, records, 2 * spp + 3 - released < PEEK_RECORDS ?
+                                       2 * spp + 3 - released : PEEK_RECORDS);
+        TEST_ASSERT_EQUAL(ESP_OK, sample_journal_release(&journal));
+        released += n;
+    }
+    flash->del(flash);
+
+    flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(&journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL_UINT32(2 * spp + 2, sample_journal_pending(&journal));
+    append_range(&journal, 4 * spp + 5, 3);
+    TEST_ASSERT_EQUAL_UINT32(2 * spp + 5, drain(&journal, 2 * spp + 3));
+    flash->del(flash);
+
+    /* Nothing is read again once everything was released */
+    flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(&journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL_UINT32(0, sample_journal_pending(&journal));
+    flash->del(flash);
+}
+
+TEST_CASE("Sample journal drops the oldest sector when full", "[sample_journal]")
+{
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    uint32_t spp = journal.slots_per_sector;
+    uint32_t total = journal.sector_count * spp + 2;
+    sample_journal_stats_t stats;
+
+    append_range(&journal, 0, total);
+    sample_journal_get_stats(&journal, &stats);
+    TEST_ASSERT_EQUAL_UINT32(spp, stats.dropped);
+    TEST_ASSERT_GREATER_OR_EQUAL(sample_journal_capacity(&journal), sample_journal_pending(&journal));
+    TEST_ASSERT_EQUAL_UINT32(total - spp, sample_journal_pending(&journal));
+    flash->del(flash);
+
+    /* The wrapped log is recovered as well */
+    flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(&journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL_UINT32(total - spp, drain(&journal, spp));
+    flash->del(flash);
+}
+
+TEST_CASE("Sample journal skips a record torn by a power loss", "[sample_journal]")
+{
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    sample_journal_stats_t stats;
+    test_record_t record;
+
+    append_range(&journal, 0, 10);
+
+    /* Half a record at the head, as if power went away during the write */
+    make_record(10, &record);
+    uint32_t offset = journal.head_sector * flash->sector_size + 16 + journal.head_slot * journal.slot_size;
+    TEST_ASSERT_EQUAL(ESP_OK, flash->write(flash, offset, &record, sizeof(record) / 2));
+    flash->del(flash);
+
+    flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(&journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL_UINT32(11, sample_journal_pending(&journal));
+    append_range(&journal, 10, 5);
+    TEST_ASSERT_EQUAL_UINT32(15, drain(&journal, 0));
+    sample_journal_get_stats(&journal, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.corrupt);
+    flash->del(flash);
+}
+
+TEST_CASE("Sample journal ignores a sector torn while it was started", "[sample_journal]")
+{
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    uint32_t spp = journal.slots_per_sector;
+
+    append_range(&journal, 0, spp);
+
+    /* The next sector erased and only the magic of its header written */
+    uint32_t next = (journal.head_sector + 1) % journal.sector_count;
+    uint32_t magic = 0x4c4e4a53u;
+    TEST_ASSERT_EQUAL(ESP_OK, flash->erase_sector(flash, next * flash->sector_size));
+    TEST_ASSERT_EQUAL(ESP_OK, flash->write(flash, next * flash->sector_size, &magic, sizeof(magic)));
+    flash->del(flash);
+
+    flash = open_flash();
+    TEST_ASSERT_EQUAL(ESP_OK, sample_journal_open(&journal, flash, sizeof(test_record_t)));
+    TEST_ASSERT_EQUAL_UINT32(spp, sample_journal_pending(&journal));
+    append_range(&journal, spp, 3);
+    TEST_ASSERT_EQUAL_UINT32(spp + 3, drain(&journal, 0));
+    flash->del(flash);
+}
+
+TEST_CASE("Sample journal write and drain throughput", "[sample_journal][bench]")
+{
+    static test_record_t records[PEEK_RECORDS];
+    sample_journal_t journal;
+    journal_flash_t *flash = open_empty(&journal);
+    sample_journal_stats_t stats;
+    uint32_t count = BENCH_RECORDS < sample_journal_capacity(&journal) ? BENCH_RECORDS : sample_journal_capacity(&journal);
+
+    int64_t start = esp_timer_get_time();
+    append_range(&journal, 0, count);
+    int64_t write_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    uint32_t drained = 0;
+    size_t n;
+    while ((n = sample_journal_peek(&journal, records, PEEK_RECORDS)) > 0) {
+        TEST_ASSERT_EQUAL(ESP_OK, sample_journal_release(&journal));
+        drained += n;
+    }
+    int64_t drain_us = esp_timer_get_time() - start;
+
+    sample_journal_get_stats(&journal, &stats);
+    ESP_LOGI(TAG, "write: %lu records in %lld ms, %.0f records/s, %.1f KiB/s, %lu erases",
+             (unsigned long) count, (long long)(write_us / 1000), count * 1e6 / write_us,
+             count * sizeof(test_record_t) * 1e6 / 1024 / write_us, (unsigned long) stats.erases);
+    ESP_LOGI(TAG, "drain: %lu records in %lld ms, %.0f records/s, %.1f KiB/s",
+             (unsigned long) drained, (long long)(drain_us / 1000), drained * 1e6 / drain_us,
+             drained * sizeof(test_record_t) * 1e6 / 1024 / drain_us);
+    TEST_ASSERT_EQUAL_UINT32(count, drained);
+    flash->del(flash);
+}
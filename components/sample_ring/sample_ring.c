@@ -0,0 +1,101 @@
+#include <string.h>
+#include "sample_ring.h"
+
+#define LOAD(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CAS(p, e, v)    __atomic_compare_exchange_n((p), (e), (v), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+bool sample_ring_init(sample_ring_t *ring, void *storage, size_t record_size, uint32_t capacity,
+                      sample_ring_policy_t policy)
+{
+    if (NULL == ring || NULL == storage || 0 == record_size || 0 == capacity || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    ring->storage = (uint8_t *) storage;
+    ring->record_size = record_size;
+    ring->mask = capacity - 1;
+    ring->policy = policy;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->pushed = 0;
+    ring->popped = 0;
+    ring->dropped = 0;
+    ring->high_water = 0;
+    return true;
+}
+
+static uint8_t *sample_ring_slot(const sample_ring_t *ring, uint32_t index)
+{
+    return ring->storage + (size_t)(index & ring->mask) * ring->record_size;
+}
+
+/* Counters are written by one side only, so a plain load and an atomic store are enough */
+static void sample_ring_count_up(volatile uint32_t *counter)
+{
+    STORE(counter, *counter + 1);
+}
+
+bool sample_ring_push(sample_ring_t *ring, const void *record)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = LOAD(&ring->tail);
+
+    /* Indices run freely and wrap at 2^32; head - tail is the fill level */
+    while (head - tail > ring->mask) {
+        if (ring->policy == SAMPLE_RING_DROP_NEWEST) {
+            sample_ring_count_up(&ring->dropped);
+            return false;
+        }
+        /* Evict the oldest record, unless the consumer takes it first: then there is room */
+        if (CAS(&ring->tail, &tail, tail + 1)) {
+            sample_ring_count_up(&ring->dropped);
+            break;
+        }
+    }
+
+    memcpy(sample_ring_slot(ring, head), record, ring->record_size);
+    STORE(&ring->head, head + 1);
+    sample_ring_count_up(&ring->pushed);
+
+    uint32_t level = head + 1 - LOAD(&ring->tail);
+    if (level > ring->high_water) {
+        STORE(&ring->high_water, level);
+    }
+    return true;
+}
+
+bool sample_ring_pop(sample_ring_t *ring, void *record)
+{
+    uint32_t tail = LOAD(&ring->tail);
+
+    while (tail != LOAD(&ring->head)) {
+        /*
+         * The producer may evict this record and overwrite its slot while it is being
+         * copied. It moves tail before it writes, so a successful CAS proves the copy
+         * is intact; otherwise tail now holds the next record to try.
+         */
+        memcpy(record, sample_ring_slot(ring, tail), ring->record_size);
+        if (CAS(&ring->tail, &tail, tail + 1)) {
+            sample_ring_count_up(&ring->popped);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t sample_ring_count(const sample_ring_t *ring)
+{
+    uint32_t tail = LOAD(&ring->tail);
+    uint32_t head = LOAD(&ring->head);
+
+    return head - tail;
+}
+
+void sample_ring_get_stats(const sample_ring_t *ring, sample_ring_stats_t *stats)
+{
+    stats->pushed = LOAD(&ring->pushed);
+    stats->popped = LOAD(&ring->popped);
+    stats->dropped = LOAD(&ring->dropped);
+    stats->high_water = LOAD(&ring->high_water);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Lock-free single producer / single consumer ring of fixed-size records
+ *
+ * One task pushes, another pops, and neither ever blocks or takes a lock: a full ring
+ * either drops the record being pushed or the oldest one waiting, depending on the
+ * policy, and counts it. Records are copied in and out, so the producer can reuse its
+ * buffer as soon as sample_ring_push() returns.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SAMPLE_RING_DROP_OLDEST = 0,    /*!< A push into a full ring evicts the oldest record */
+    SAMPLE_RING_DROP_NEWEST = 1,    /*!< A push into a full ring is refused */
+} sample_ring_policy_t;
+
+typedef struct {
+    uint32_t pushed;        /*!< Records accepted by sample_ring_push() */
+    uint32_t popped;        /*!< Records returned by sample_ring_pop() */
+    uint32_t dropped;       /*!< Records lost to overflow, evicted or refused */
+    uint32_t high_water;    /*!< Most records ever waiting at once */
+} sample_ring_stats_t;
+
+/**
+ * @brief Ring state; fields are private, use the functions below
+ *
+ * head is only written by the producer. tail is advanced by the consumer, and by the
+ * producer when it evicts under SAMPLE_RING_DROP_OLDEST, always with compare-and-swap.
+ */
+typedef struct {
+    uint8_t *storage;
+    size_t record_size;
+    uint32_t mask;
+    sample_ring_policy_t policy;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t pushed;
+    volatile uint32_t popped;
+    volatile uint32_t dropped;
+    volatile uint32_t high_water;
+} sample_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Ring state
+ * @param storage capacity * record_size bytes, owned by the caller for the ring's lifetime
+ * @param record_size Size of one record in bytes
+ * @param capacity Number of records, a power of two
+ * @param policy What a push into a full ring does
+ *
+ * @return false if capacity is not a power of two or an argument is NULL or zero
+ */
+bool sample_ring_init(sample_ring_t *ring, void *storage, size_t record_size, uint32_t capacity,
+                      sample_ring_policy_t policy);
+
+/**
+ * @brief Copy a record in; producer side only
+ *
+ * @return true if the record was stored. With SAMPLE_RING_DROP_OLDEST this is always the
+ *         case, an older record may have been dropped to make room.
+ */
+bool sample_ring_push(sample_ring_t *ring, const void *record);
+
+/**
+ * @brief Copy the oldest record out; consumer side only
+ *
+ * @return false if the ring is empty
+ */
+bool sample_ring_pop(sample_ring_t *ring, void *record);
+
+/**
+ * @brief Number of records waiting, a snapshot when called from either side
+ */
+uint32_t sample_ring_count(const sample_ring_t *ring);
+
+/**
+ * @brief Read the counters; each one is exact, but they are not read atomically together
+ */
+void sample_ring_get_stats(const sample_ring_t *ring, sample_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
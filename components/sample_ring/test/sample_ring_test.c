@@ -0,0 +1,199 @@
+#include <string.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sample_ring.h"
+
+#define RING_CAPACITY       16
+#define STRESS_RECORDS      200000
+
+static const char *TAG = "sample ring test";
+
+/* Every word derives from seq, so a record torn by a concurrent write is detected */
+typedef struct {
+    uint32_t seq;
+    uint32_t payload[7];
+    uint32_t check;
+} test_record_t;
+
+static void make_record(uint32_t seq, test_record_t *record)
+{
+    record->seq = seq;
+    for (int i = 0; i < 7; i++) {
+        record->payload[i] = seq * 2654435761u + i;
+    }
+    record->check = ~seq;
+}
+
+static void check_record(const test_record_t *record)
+{
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL_UINT32(record->seq * 2654435761u + i, record->payload[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32((uint32_t) ~record->seq, record->check);
+}
+
+static void fill(sample_ring_t *ring, uint32_t count)
+{
+    test_record_t record;
+
+    for (uint32_t seq = 0; seq < count; seq++) {
+        make_record(seq, &record);
+        sample_ring_push(ring, &record);
+    }
+}
+
+TEST_CASE("Sample ring rejects a capacity that is not a power of two", "[sample_ring]")
+{
+    sample_ring_t ring;
+    test_record_t storage[RING_CAPACITY];
+
+    TEST_ASSERT_FALSE(sample_ring_init(&ring, storage, sizeof(test_record_t), 12, SAMPLE_RING_DROP_OLDEST));
+    TEST_ASSERT_FALSE(sample_ring_init(&ring, storage, sizeof(test_record_t), 0, SAMPLE_RING_DROP_OLDEST));
+    TEST_ASSERT_FALSE(sample_ring_init(&ring, NULL, sizeof(test_record_t), RING_CAPACITY, SAMPLE_RING_DROP_OLDEST));
+    TEST_ASSERT_TRUE(sample_ring_init(&ring, storage, sizeof(test_record_t), RING_CAPACITY, SAMPLE_RING_DROP_OLDEST));
+}
+
+TEST_CASE("Sample ring returns records in order", "[sample_ring]")
+{
+    sample_ring_t ring;
+    test_record_t storage[RING_CAPACITY];
+    test_record_t record;
+
+    TEST_ASSERT_TRUE(sample_ring_init(&ring, storage, sizeof(test_record_t), RING_CAPACITY, SAMPLE_RING_DROP_NEWEST));
+    TEST_ASSERT_FALSE(sample_ring_pop(&ring, &record));
+
+    /* Several laps, so the indices wrap over the storage */
+    for (uint32_t lap = 0; lap < 5; lap++) {
+        for (uint32_t i = 0; i < RING_CAPACITY - 3; i++) {
+            make_record(lap * 100 + i, &record);
+            TEST_ASSERT_TRUE(sample_ring_push(&ring, &record));
+        }
+        TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY - 3, sample_ring_count(&ring));
+        for (uint32_t i = 0; i < RING_CAPACITY - 3; i++) {
+            TEST_ASSERT_TRUE(sample_ring_pop(&ring, &record));
+            check_record(&record);
+            TEST_ASSERT_EQUAL_UINT32(lap * 100 + i, record.seq);
+        }
+        TEST_ASSERT_FALSE(sample_ring_pop(&ring, &record));
+    }
+}
+
+TEST_CASE("Sample ring drop newest keeps the oldest records", "[sample_ring]")
+{
+    sample_ring_t ring;
+    test_record_t storage[RING_CAPACITY];
+    test_record_t record;
+    sample_ring_stats_t stats;
+
+    TEST_ASSERT_TRUE(sample_ring_init(&ring, storage, sizeof(test_record_t), RING_CAPACITY, SAMPLE_RING_DROP_NEWEST));
+    fill(&ring, RING_CAPACITY);
+    make_record(RING_CAPACITY, &record);
+    TEST_ASSERT_FALSE(sample_ring_push(&ring, &record));
+    fill(&ring, 2);
+
+    sample_ring_get_stats(&ring, &stats);
+    TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY, stats.pushed);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY, stats.high_water);
+
+    for (uint32_t seq = 0; seq < RING_CAPACITY; seq++) {
+        TEST_ASSERT_TRUE(sample_ring_pop(&ring, &record));
+        TEST_ASSERT_EQUAL_UINT32(seq, record.seq);
+    }
+    TEST_ASSERT_FALSE(sample_ring_pop(&ring, &record));
+}
+
+TEST_CASE("Sample ring drop oldest keeps the newest records", "[sample_ring]")
+{
+    sample_ring_t ring;
+    test_record_t storage[RING_CAPACITY];
+    test_record_t record;
+    sample_ring_stats_t stats;
+
+    TEST_ASSERT_TRUE(sample_ring_init(&ring, storage, sizeof(test_record_t), RING_CAPACITY, SAMPLE_RING_DROP_OLDEST));
+    fill(&ring, RING_CAPACITY + 5);
+    TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY, sample_ring_count(&ring));
+
+    sample_ring_get_stats(&ring, &stats);
+    TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY + 5, stats.pushed);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.dropped);
+
+    for (uint32_t seq = 5; seq < RING_CAPACITY + 5; seq++) {
+        TEST_ASSERT_TRUE(sample_ring_pop(&ring, &record));
+        TEST_ASSERT_EQUAL_UINT32(seq, record.seq);
+    }
+    sample_ring_get_stats(&ring, &stats);
+    TEST_ASSERT_EQUAL_UINT32(RING_CAPACITY, stats.popped);
+}
+
+static volatile bool producer_done;
+
+static void producer_task(void *arg)
+{
+    sample_ring_t *ring = (sample_ring_t *) arg;
+    test_record_t record;
+
+    for (uint32_t seq = 0; seq < STRESS_RECORDS; seq++) {
+        make_record(seq, &record);
+        sample_ring_push(ring, &record);
+        /* Bursts longer than the ring, so both the full and the empty edge are crossed */
+        if (seq % (4 * RING_CAPACITY) == 0) {
+            vTaskDelay(1);
+        }
+    }
+    producer_done = true;
+    vTaskDelete(NULL);
+}
+
+static void check_concurrent(sample_ring_policy_t policy)
+{
+    static test_record_t storage[RING_CAPACITY];
+    static sample_ring_t ring;
+    test_record_t record;
+    sample_ring_stats_t stats;
+    uint32_t received = 0;
+    int64_t last_seq = -1;
+
+    TEST_ASSERT_TRUE(sample_ring_init(&ring, storage, sizeof(test_record_t), RING_CAPACITY, policy));
+    producer_done = false;
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(producer_task, "producer", 4096, &ring, 5, NULL,
+                                                      portNUM_PROCESSORS - 1));
+
+    while (!producer_done || sample_ring_count(&ring) > 0) {
+        if (!sample_ring_pop(&ring, &record)) {
+            vTaskDelay(1);
+            continue;
+        }
+        check_record(&record);
+        TEST_ASSERT_TRUE((int64_t) record.seq > last_seq);
+        last_seq = record.seq;
+        received++;
+    }
+
+    sample_ring_get_stats(&ring, &stats);
+    ESP_LOGI(TAG, "%s: %lu received, %lu dropped, high water %lu",
+             policy == SAMPLE_RING_DROP_OLDEST ? "drop oldest" : "drop newest",
+             (unsigned long) received, (unsigned long) stats.dropped, (unsigned long) stats.high_water);
+    TEST_ASSERT_EQUAL_UINT32(received, stats.popped);
+    if (policy == SAMPLE_RING_DROP_OLDEST) {
+        /* Evicted records were pushed, and the newest one always gets through */
+        TEST_ASSERT_EQUAL_UINT32(STRESS_RECORDS, stats.pushed);
+        TEST_ASSERT_EQUAL_UINT32(STRESS_RECORDS, received + stats.dropped);
+        TEST_ASSERT_EQUAL_UINT32(STRESS_RECORDS - 1, last_seq);
+    } else {
+        TEST_ASSERT_EQUAL_UINT32(STRESS_RECORDS, stats.pushed + stats.dropped);
+        TEST_ASSERT_EQUAL_UINT32(stats.pushed, received);
+    }
+}
+
+TEST_CASE("Sample ring drop oldest between two tasks", "[sample_ring]")
+{
+    check_concurrent(SAMPLE_RING_DROP_OLDEST);
+}
+
+TEST_CASE("Sample ring drop newest between two tasks", "[sample_ring]")
+{
+    check_concurrent(SAMPLE_RING_DROP_NEWEST);
+}
@@ -1,127 +1,963 @@
 #include "mpu_wrapper.h"
 #include "mpu6050.h"
-#include "math.h"
-#include "driver/i2c.h"
+#if CONFIG_MPU_TRANSPORT_SIM
+#include "mpu6050_sim.h"
+#else
+#include "driver/i2c_master.h"
 #include "driver/gpio.h"
+#endif
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
 
-#define I2C_MASTER_SCL_IO    26
-#define I2C_MASTER_SDA_IO    25
-#define I2C_MASTER_NUM_0     I2C_NUM_0
-#define I2C_MASTER_SCL_IO_1  22
-#define I2C_MASTER_SDA_IO_1  21
-#define I2C_MASTER_NUM_1     I2C_NUM_1
-#define I2C_FREQ_HZ          400000
+#define MPU_NUM_BUSES        2
+#define ACQ_TASK_STACK       4096
+#define ACQ_TASK_PRIO        10
+#define FRAME_BARRIER_TIMEOUT_MS 50
+#define FUSION_MAX_GAP_US    250000  // Acima disso o giroscópio não é integrado e o filtro recomeça
+#define FIXED_GYRO_LSB_PER_DPS_X10 655  // GYRO_FS_500DPS, configurado em mpu6050_init_all()
+#define FIXED_ALPHA_SHIFT    6       // Peso 1/64 do acelerômetro por amostra
 
 static const char *TAG = "MPU_WRAPPER";
-static mpu6050_handle_t mpu0 = NULL;
-static mpu6050_handle_t mpu1 = NULL;
 
-static float calculate_roll(float ax, float ay, float az) {
-    return atan(ay / sqrt(ax * ax + az * az)) * (180.0 / M_PI);
+// Descritores configurados no menuconfig; adicionar um sensor não exige código novo
+typedef struct {
+    int bus;
+    uint8_t addr;
+    int int_pin;                    // -1 se o INT não estiver ligado
+} sensor_desc_t;
+
+typedef struct {
+    int sda_io;
+    int scl_io;
+} bus_desc_t;
+
+#define SENSOR_DESC(n) {CONFIG_MPU_SENSOR##n##_BUS, CONFIG_MPU_SENSOR##n##_ADDR, CONFIG_MPU_SENSOR##n##_INT_IO}
+
+static const sensor_desc_t sensor_table[MPU_SENSOR_COUNT] = {
+    SENSOR_DESC(0),
+#if MPU_SENSOR_COUNT > 1
+    SENSOR_DESC(1),
+#endif
+#if MPU_SENSOR_COUNT > 2
+    SENSOR_DESC(2),
+#endif
+#if MPU_SENSOR_COUNT > 3
+    SENSOR_DESC(3),
+#endif
+};
+
+static const bus_desc_t bus_table[MPU_NUM_BUSES] = {
+    {CONFIG_MPU_I2C0_SDA_IO, CONFIG_MPU_I2C0_SCL_IO},
+    {CONFIG_MPU_I2C1_SDA_IO, CONFIG_MPU_I2C1_SCL_IO},
+};
+
+// Estado do modo FIFO de cada sensor, usado para reconstruir os instantes das amostras
+typedef struct {
+    uint32_t period_us;
+    int64_t next_timestamp_us;
+} stream_state_t;
+
+// Tratador do DATA READY: a ISR do GPIO ou, no simulador, uma função em contexto de task
+typedef void (*data_ready_handler_t)(void *arg);
+
+// Entrada do registro, indexada pelo ID do sensor
+typedef struct {
+    int id;
+    const sensor_desc_t *desc;
+    mpu6050_handle_t handle;
+    mpu_sensor_status_t status;
+    stream_state_t stream;
+    volatile int64_t irq_timestamp_us;
+    bool data_ready;                // Tratador do DATA READY instalado por setup_data_ready()
+#if CONFIG_MPU_TRANSPORT_SIM
+    mpu6050_transport_t *sim_transport;
+    data_ready_handler_t volatile sim_handler;  // Chamado pelo pino INT simulado
+#endif
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    fusion_fixed_t fusion;
+#else
+    fusion_t fusion;
+#endif
+    int64_t fusion_timestamp_us;    // Instante da última amostra fundida
+} sensor_entry_t;
+
+// Sensores de cada barramento, lidos em sequência
+typedef struct {
+    int count;
+    int ids[MPU_SENSOR_COUNT];
+} bus_group_t;
+
+static sensor_entry_t sensors[MPU_SENSOR_COUNT];
+static bus_group_t bus_groups[MPU_NUM_BUSES];
+
+// Modo de aquisição por interrupção: o pino INT de cada sensor acorda a task de leitura
+static TaskHandle_t acq_task = NULL;
+static mpu_sample_cb_t acq_callback = NULL;
+static void *acq_callback_arg = NULL;
+static mpu_sample_t latest[MPU_SENSOR_COUNT];
+static uint32_t latest_valid_mask = 0;
+static portMUX_TYPE latest_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Aquisição em frames: uma task por barramento, sincronizadas por uma barreira
+static TaskHandle_t frame_tasks[MPU_NUM_BUSES] = {};
+static EventGroupHandle_t frame_barrier = NULL;
+static EventBits_t frame_barrier_bits = 0;
+static int frame_publisher_bus = -1;
+static mpu_frame_cb_t frame_callback = NULL;
+static void *frame_callback_arg = NULL;
+static volatile int64_t frame_trigger_us;
+static volatile uint32_t frame_sequence;
+static uint32_t frame_read_sequence[MPU_NUM_BUSES];
+static uint32_t frame_read_mask[MPU_NUM_BUSES];
+static mpu_frame_t frame_pending;
+static mpu_frame_t latest_frame;
+static bool latest_frame_valid = false;
+
+// Funde a amostra no filtro do sensor e guarda a orientação resultante na amostra
+static void update_orientation(sensor_entry_t *sensor, mpu_sample_t *sample) {
+    int64_t dt_us = sample->timestamp_us - sensor->fusion_timestamp_us;
+    if (dt_us <= 0 || dt_us > FUSION_MAX_GAP_US) {
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+        fusion_fixed_reset(&sensor->fusion);
+#else
+        fusion_reset(&sensor->fusion);
+#endif
+        dt_us = 0;
+    }
+    sensor->fusion_timestamp_us = sample->timestamp_us;
+
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    const mpu6050_raw_motion_value_t *raw = &sample->raw;
+    const int16_t gyro[3] = {raw->gyro.raw_gyro_x, raw->gyro.raw_gyro_y, raw->gyro.raw_gyro_z};
+    const int16_t acce[3] = {raw->acce.raw_acce_x, raw->acce.raw_acce_y, raw->acce.raw_acce_z};
+    fusion_fixed_update(&sensor->fusion, gyro, acce, (uint32_t) dt_us);
+    sample->orientation = sensor->fusion.angles;
+#else
+    const mpu6050_motion_value_t *motion = &sample->motion;
+    fusion_update(&sensor->fusion,
+                  motion->gyro.gyro_x, motion->gyro.gyro_y, motion->gyro.gyro_z,
+                  motion->acce.acce_x, motion->acce.acce_y, motion->acce.acce_z,
+                  dt_us * 1e-6f);
+    sample->orientation = sensor->fusion.q;
+#endif
 }
 
-static float calculate_pitch(float ax, float ay, float az) {
-    return atan(-ax / sqrt(ay * ay + az * az)) * (180.0 / M_PI);
+void mpu6050_sample_euler(const mpu_sample_t *sample, fusion_euler_t *euler) {
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    fusion_fixed_get_euler(&sample->orientation, euler);
+#else
+    fusion_get_euler(&sample->orientation, euler);
+#endif
 }
 
-bool mpu6050_init_all(void) {
-    esp_err_t ret;
-
-    // Configuração do barramento I2C 0
-    i2c_config_t conf0 = {};
-    conf0.mode = I2C_MODE_MASTER;
-    conf0.sda_io_num = I2C_MASTER_SDA_IO;
-    conf0.scl_io_num = I2C_MASTER_SCL_IO;
-    conf0.sda_pullup_en = GPIO_PULLUP_ENABLE;
-    conf0.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf0.master.clk_speed = I2C_FREQ_HZ;
-
-    ret = i2c_param_config(I2C_MASTER_NUM_0, &conf0);
+static bool record_result(sensor_entry_t *sensor, esp_err_t ret) {
+    sensor->status.last_error = ret;
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro na configuração do I2C 0");
+        sensor->status.error_count++;
         return false;
     }
+    return true;
+}
 
-    ret = i2c_driver_install(I2C_MASTER_NUM_0, I2C_MODE_MASTER, 0, 0, 0);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro na instalação do driver I2C 0");
+#if CONFIG_MPU_TRANSPORT_SIM
+// Cada sensor simulado balança em torno de uma postura diferente
+static mpu6050_sim_sway_t sim_motion[MPU_SENSOR_COUNT];
+static volatile bool sim_clock_held = false;
+static volatile int64_t sim_clock_held_us;
+// Sem pino INT de verdade, um timer sincroniza os sensores com o relógio na taxa de amostragem
+static esp_timer_handle_t sim_poll_timer = NULL;
+
+static int64_t sim_clock(void *arg) {
+    if (sim_clock_held) {
+        return sim_clock_held_us;
+    }
+    return esp_timer_get_time() * CONFIG_MPU_SIM_TIME_SCALE;
+}
+
+// Pino INT simulado. Roda na task do esp_timer (sim_poll) ou em quem chamou
+// mpu6050_sim_data_ready(), nunca em interrupção: o tratador é a versão de task
+static void sim_int_handler(void *arg) {
+    sensor_entry_t *sensor = (sensor_entry_t *)arg;
+    data_ready_handler_t handler = sensor->sim_handler;
+    if (handler != NULL) {
+        handler(sensor);
+    }
+}
+
+static void sim_poll(void *arg) {
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+        if (sensors[sensor_id].data_ready) {
+            mpu6050_sim_poll(sensors[sensor_id].sim_transport);
+        }
+    }
+}
+
+static esp_err_t sim_start_polling(uint16_t sample_rate_hz) {
+    esp_err_t ret = ESP_OK;
+    if (sim_poll_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = sim_poll;
+        args.name = "mpu_sim_int";
+        ret = esp_timer_create(&args, &sim_poll_timer);
+    }
+    if (ret == ESP_OK && !esp_timer_is_active(sim_poll_timer)) {
+        ret = esp_timer_start_periodic(sim_poll_timer, 1000000 / sample_rate_hz / CONFIG_MPU_SIM_TIME_SCALE + 1);
+    }
+    return ret;
+}
+
+void mpu6050_sim_hold_clock(bool hold) {
+    if (hold && !sim_clock_held) {
+        sim_clock_held_us = esp_timer_get_time() * CONFIG_MPU_SIM_TIME_SCALE;
+    }
+    sim_clock_held = hold;
+}
+
+bool mpu6050_sim_set_motion(int sensor_id, const mpu6050_sim_sway_t *motion) {
+    if (motion == NULL || sensor_id < 0 || sensor_id >= MPU_SENSOR_COUNT) {
         return false;
     }
+    sim_motion[sensor_id] = *motion;
+    return true;
+}
 
-    // Configuração do barramento I2C 1
-    i2c_config_t conf1 = {};
-    conf1.mode = I2C_MODE_MASTER;
-    conf1.sda_io_num = I2C_MASTER_SDA_IO_1;
-    conf1.scl_io_num = I2C_MASTER_SCL_IO_1;
-    conf1.sda_pullup_en = GPIO_PULLUP_ENABLE;
-    conf1.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf1.master.clk_speed = I2C_FREQ_HZ;
+bool mpu6050_sim_data_ready(int sensor_id, uint32_t samples) {
+    if (sensor_id < 0 || sensor_id >= MPU_SENSOR_COUNT || sensors[sensor_id].handle == NULL) {
+        return false;
+    }
+    return mpu6050_sim_advance(sensors[sensor_id].sim_transport, samples) == ESP_OK;
+}
+
+static esp_err_t init_bus(int bus) {
+    return ESP_OK;
+}
+
+static mpu6050_handle_t create_sensor(int id) {
+    sim_motion[id].roll_deg = 10.0f * id;
+    sim_motion[id].pitch_deg = -5.0f * id;
+    sim_motion[id].amplitude_deg = 15.0f;
+    sim_motion[id].frequency_hz = 0.5f + 0.25f * id;
+    sim_motion[id].temp = 25.0f;
+
+    mpu6050_sim_config_t config = {};
+    config.source = mpu6050_sim_sway_source;
+    config.source_arg = &sim_motion[id];
+    config.clock = sim_clock;
+    if (sensor_table[id].int_pin >= 0) {
+        config.int_handler = sim_int_handler;
+        config.int_arg = &sensors[id];
+    }
 
-    ret = i2c_param_config(I2C_MASTER_NUM_1, &conf1);
+    mpu6050_transport_t *transport;
+    if (mpu6050_new_sim_transport(&config, &transport) != ESP_OK) {
+        return NULL;
+    }
+    mpu6050_handle_t handle = mpu6050_create_with_transport(transport);
+    if (handle == NULL) {
+        transport->del(transport);
+        transport = NULL;
+    }
+    sensors[id].sim_transport = transport;
+    return handle;
+}
+#else
+static i2c_master_bus_handle_t bus_handles[MPU_NUM_BUSES];
+
+static esp_err_t init_bus(int bus) {
+    if (bus_handles[bus] != NULL) {
+        return ESP_OK;
+    }
+
+    i2c_master_bus_config_t conf = {};
+    conf.i2c_port = (i2c_port_num_t)bus;
+    conf.sda_io_num = (gpio_num_t)bus_table[bus].sda_io;
+    conf.scl_io_num = (gpio_num_t)bus_table[bus].scl_io;
+    conf.clk_source = I2C_CLK_SRC_DEFAULT;
+    conf.glitch_ignore_cnt = 7;
+    conf.flags.enable_internal_pullup = true;
+
+    esp_err_t ret = i2c_new_master_bus(&conf, &bus_handles[bus]);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro na configuração do I2C 1");
+        ESP_LOGE(TAG, "Erro na inicialização do barramento I2C %d", bus);
+        bus_handles[bus] = NULL;
+    }
+    return ret;
+}
+
+static mpu6050_handle_t create_sensor(int id) {
+    return mpu6050_create(bus_handles[sensor_table[id].bus], sensor_table[id].addr, CONFIG_MPU_I2C_FREQ_HZ);
+}
+#endif
+
+bool mpu6050_init_all(void) {
+    bool all_ok = true;
+    esp_err_t bus_ret[MPU_NUM_BUSES];
+#if !CONFIG_MPU_ORIENTATION_FIXED_POINT
+    fusion_config_t fusion_config = FUSION_CONFIG_DEFAULT();
+#if CONFIG_MPU_FUSION_MAHONY
+    fusion_config.algorithm = FUSION_MAHONY;
+#endif
+#endif
+
+    int grouped = 0;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        grouped += bus_groups[bus].count;
+        bus_ret[bus] = ESP_ERR_NOT_FOUND;
+    }
+
+    // Agrupa os sensores por barramento e inicializa só os barramentos em uso. Os grupos
+    // são montados uma vez: numa nova chamada as tasks de aquisição podem estar lendo
+    if (grouped == 0) {
+        for (int id = 0; id < MPU_SENSOR_COUNT; id++) {
+            bus_group_t *group = &bus_groups[sensor_table[id].bus];
+            group->ids[group->count++] = id;
+        }
+    }
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (bus_groups[bus].count > 0) {
+            bus_ret[bus] = init_bus(bus);
+        }
+    }
+
+    // Inicialização dos sensores MPU6050; numa nova chamada, só os que ainda não têm handle
+    for (int id = 0; id < MPU_SENSOR_COUNT; id++) {
+        sensor_entry_t *sensor = &sensors[id];
+        if (sensor->handle != NULL) {
+            continue;
+        }
+        sensor->id = id;
+        sensor->desc = &sensor_table[id];
+        sensor->handle = NULL;
+        sensor->status = {};
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+        fusion_fixed_init(&sensor->fusion, FIXED_GYRO_LSB_PER_DPS_X10, FIXED_ALPHA_SHIFT);
+#else
+        fusion_init(&sensor->fusion, &fusion_config);
+#endif
+        sensor->fusion_timestamp_us = 0;
+
+        esp_err_t ret = bus_ret[sensor->desc->bus];
+        if (ret == ESP_OK) {
+            sensor->handle = create_sensor(id);
+            ret = (sensor->handle == NULL) ? ESP_ERR_NO_MEM : ESP_OK;
+        }
+        if (ret == ESP_OK) {
+            ret = mpu6050_wake_up(sensor->handle);
+        }
+        if (ret == ESP_OK) {
+            ret = mpu6050_config(sensor->handle, ACCE_FS_8G, GYRO_FS_500DPS);
+        }
+
+        if (!record_result(sensor, ret)) {
+            ESP_LOGE(TAG, "Erro ao inicializar MPU6050 %d (I2C %d, 0x%02x)", id, sensor->desc->bus, sensor->desc->addr);
+            if (sensor->handle != NULL) {
+                mpu6050_delete(sensor->handle);
+                sensor->handle = NULL;
+            }
+            all_ok = false;
+            continue;
+        }
+        sensor->status.initialized = true;
+    }
+
+    ESP_LOGI(TAG, "MPU6050 inicializados%s", all_ok ? " com sucesso" : " com erros");
+    return all_ok;
+}
+
+static sensor_entry_t *get_sensor(int sensor_id) {
+    if (sensor_id < 0 || sensor_id >= MPU_SENSOR_COUNT) {
+        ESP_LOGE(TAG, "ID de sensor inválido: %d", sensor_id);
+        return NULL;
+    }
+
+    sensor_entry_t *sensor = &sensors[sensor_id];
+    if (sensor->handle == NULL) {
+        ESP_LOGE(TAG, "Sensor %d não inicializado", sensor_id);
+        return NULL;
+    }
+    return sensor;
+}
+
+bool mpu6050_get_sensor_status(int sensor_id, mpu_sensor_status_t *status) {
+    if (status == NULL || sensor_id < 0 || sensor_id >= MPU_SENSOR_COUNT) {
         return false;
     }
+    *status = sensors[sensor_id].status;
+    return true;
+}
 
-    ret = i2c_driver_install(I2C_MASTER_NUM_1, I2C_MODE_MASTER, 0, 0, 0);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro na instalação do driver I2C 1");
+// Lê uma amostra em rajada; a leitura também limpa o INT_STATUS (INTERRUPT_CLEAR_ON_ANY_READ)
+static bool read_sample(sensor_entry_t *sensor, mpu_sample_t *sample) {
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    esp_err_t ret = mpu6050_get_raw_motion(sensor->handle, &sample->raw);
+#else
+    esp_err_t ret = mpu6050_get_motion(sensor->handle, &sample->motion);
+#endif
+    if (!record_result(sensor, ret)) {
         return false;
     }
+    update_orientation(sensor, sample);
+    return true;
+}
 
-    // Inicialização dos sensores MPU6050
-    mpu0 = mpu6050_create(I2C_MASTER_NUM_0, 0x68);
-    if (mpu0 == NULL) {
-        ESP_LOGE(TAG, "Erro ao criar MPU6050 0");
+// Lê em sequência os sensores inicializados de um barramento e retorna os bits dos lidos com sucesso
+static uint32_t read_bus(int bus, mpu_sample_t *samples) {
+    uint32_t mask = 0;
+    const bus_group_t *group = &bus_groups[bus];
+
+    for (int i = 0; i < group->count; i++) {
+        sensor_entry_t *sensor = &sensors[group->ids[i]];
+        if (sensor->handle == NULL) {
+            continue;
+        }
+        mpu_sample_t *sample = &samples[sensor->id];
+        sample->timestamp_us = esp_timer_get_time();
+        if (read_sample(sensor, sample)) {
+            mask |= 1u << sensor->id;
+        }
+    }
+    return mask;
+}
+
+bool mpu6050_get_orientation(int sensor_id, float *roll, float *pitch) {
+    if (roll == NULL || pitch == NULL) {
         return false;
     }
 
-    mpu1 = mpu6050_create(I2C_MASTER_NUM_1, 0x68);
-    if (mpu1 == NULL) {
-        ESP_LOGE(TAG, "Erro ao criar MPU6050 1");
+    sensor_entry_t *sensor = get_sensor(sensor_id);
+    if (sensor == NULL) {
         return false;
     }
 
-    // Configuração dos sensores
-    mpu6050_wake_up(mpu0);
-    mpu6050_wake_up(mpu1);
-    mpu6050_config(mpu0, ACCE_FS_8G, GYRO_FS_500DPS);
-    mpu6050_config(mpu1, ACCE_FS_8G, GYRO_FS_500DPS);
+    mpu_sample_t sample;
+    sample.timestamp_us = esp_timer_get_time();
+    if (!read_sample(sensor, &sample)) {
+        ESP_LOGE(TAG, "Erro ao ler dados do sensor %d", sensor_id);
+        return false;
+    }
 
-    ESP_LOGI(TAG, "MPU6050 inicializados com sucesso");
+    fusion_euler_t euler;
+    mpu6050_sample_euler(&sample, &euler);
+    *roll = euler.roll;
+    *pitch = euler.pitch;
     return true;
 }
 
-bool mpu6050_get_orientation(int sensor_id, float *roll, float *pitch) {
-    if (roll == NULL || pitch == NULL) {
+bool mpu6050_read_all(mpu_sample_t *samples, uint32_t *valid_mask) {
+    if (samples == NULL || valid_mask == NULL) {
         return false;
     }
 
-    mpu6050_handle_t mpu;
-    if (sensor_id == 0) {
-        mpu = mpu0;
-    } else if (sensor_id == 1) {
-        mpu = mpu1;
-    } else {
-        ESP_LOGE(TAG, "ID de sensor inválido: %d", sensor_id);
+    *valid_mask = 0;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        *valid_mask |= read_bus(bus, samples);
+    }
+    return *valid_mask == (1u << MPU_SENSOR_COUNT) - 1;
+}
+
+bool mpu6050_start_stream(int sensor_id, uint16_t sample_rate_hz) {
+    sensor_entry_t *sensor = get_sensor(sensor_id);
+    if (sensor == NULL) {
         return false;
     }
 
-    if (mpu == NULL) {
-        ESP_LOGE(TAG, "Sensor %d não inicializado", sensor_id);
+    stream_state_t *stream = &sensor->stream;
+    esp_err_t ret = mpu6050_fifo_enable(sensor->handle, sample_rate_hz);
+    if (ret == ESP_OK) {
+        ret = mpu6050_get_sample_period(sensor->handle, &stream->period_us);
+    }
+    if (!record_result(sensor, ret)) {
+        ESP_LOGE(TAG, "Erro ao ligar o FIFO do sensor %d", sensor_id);
+        return false;
+    }
+
+    // A primeira amostra entra no FIFO um período depois do reset
+    stream->next_timestamp_us = esp_timer_get_time() + stream->period_us;
+    ESP_LOGI(TAG, "FIFO do sensor %d ligado, período %lu us", sensor_id, (unsigned long)stream->period_us);
+    return true;
+}
+
+bool mpu6050_stop_stream(int sensor_id) {
+    sensor_entry_t *sensor = get_sensor(sensor_id);
+    if (sensor == NULL) {
+        return false;
+    }
+
+    sensor->stream.period_us = 0;
+    if (!record_result(sensor, mpu6050_fifo_disable(sensor->handle))) {
+        ESP_LOGE(TAG, "Erro ao desligar o FIFO do sensor %d", sensor_id);
+        return false;
+    }
+    return true;
+}
+
+bool mpu6050_get_samples(int sensor_id, mpu_sample_t *samples, size_t max_samples, size_t *count) {
+    if (samples == NULL || count == NULL) {
+        return false;
+    }
+    *count = 0;
+
+    sensor_entry_t *sensor = get_sensor(sensor_id);
+    if (sensor == NULL) {
+        return false;
+    }
+    stream_state_t *stream = &sensor->stream;
+    if (stream->period_us == 0) {
+        ESP_LOGE(TAG, "FIFO do sensor %d desligado", sensor_id);
         return false;
     }
 
-    mpu6050_acce_value_t accel;
-    esp_err_t ret = mpu6050_get_acce(mpu, &accel);
+    if (max_samples > MPU6050_FIFO_MAX_SAMPLES) {
+        max_samples = MPU6050_FIFO_MAX_SAMPLES;
+    }
+
+    // Lê em blocos de uma rajada, para não pôr um FIFO inteiro decodificado na pilha de
+    // quem chama. Cada bloco vai direto para samples; a leitura para quando o FIFO esvazia
+    size_t n = 0;
+    esp_err_t ret = ESP_OK;
+    while (n < max_samples) {
+        size_t chunk = max_samples - n;
+        if (chunk > MPU6050_FIFO_READ_FRAMES) {
+            chunk = MPU6050_FIFO_READ_FRAMES;
+        }
+        size_t got = 0;
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+        mpu6050_raw_motion_value_t motion[MPU6050_FIFO_READ_FRAMES];
+        ret = mpu6050_fifo_read_raw_motion(sensor->handle, motion, chunk, &got);
+        for (size_t i = 0; i < got; i++) {
+            samples[n + i].raw = motion[i];
+        }
+#else
+        mpu6050_motion_value_t motion[MPU6050_FIFO_READ_FRAMES];
+        ret = mpu6050_fifo_read_motion(sensor->handle, motion, chunk, &got);
+        for (size_t i = 0; i < got; i++) {
+            samples[n + i].motion = motion[i];
+        }
+#endif
+        if (ret != ESP_OK) {
+            break;
+        }
+        n += got;
+        if (got < chunk) {
+            break;
+        }
+    }
+    int64_t now = esp_timer_get_time();
+    record_result(sensor, ret);
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        ESP_LOGW(TAG, "Estouro do FIFO do sensor %d, amostras descartadas", sensor_id);
+        stream->next_timestamp_us = now + stream->period_us;
+        return false;
+    }
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Erro ao ler dados do sensor %d", sensor_id);
+        ESP_LOGE(TAG, "Erro ao ler o FIFO do sensor %d", sensor_id);
+        return false;
+    }
+    if (n == 0) {
+        return true;
+    }
+
+    // Os instantes seguem o período nominal; quando o FIFO foi esvaziado, a amostra
+    // mais nova tem que ter ocorrido no último período antes de agora. Fora disso o
+    // relógio do sensor derivou em relação ao do ESP32 e a base é realinhada.
+    int64_t period = stream->period_us;
+    int64_t newest = stream->next_timestamp_us + (int64_t)(n - 1) * period;
+    if (n < max_samples && (newest > now || newest < now - 2 * period)) {
+        stream->next_timestamp_us = now - (int64_t)(n - 1) * period;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        samples[i].timestamp_us = stream->next_timestamp_us;
+        update_orientation(sensor, &samples[i]);
+        stream->next_timestamp_us += period;
+    }
+    *count = n;
+    return true;
+}
+
+// Desfaz setup_data_ready(), mesmo que ela tenha parado no meio; os erros são ignorados
+static void teardown_data_ready(sensor_entry_t *sensor) {
+#if !CONFIG_MPU_TRANSPORT_SIM
+    gpio_intr_disable((gpio_num_t)sensor->desc->int_pin);
+    gpio_isr_handler_remove((gpio_num_t)sensor->desc->int_pin);
+#endif
+    mpu6050_disable_interrupts(sensor->handle, MPU6050_DATA_RDY_INT_BIT);
+#if CONFIG_MPU_TRANSPORT_SIM
+    sensor->sim_handler = NULL;
+#endif
+    sensor->data_ready = false;
+}
+
+// Configura a taxa de amostragem e a interrupção DATA READY de um sensor.
+// O tratador é registrado direto no GPIO (e não por mpu6050_register_isr(), que passaria
+// o handle) para receber a entrada do registro e achar o ID sem busca.
+static bool setup_data_ready(sensor_entry_t *sensor, data_ready_handler_t handler, uint16_t sample_rate_hz) {
+    mpu6050_int_config_t int_config = {};
+    int_config.interrupt_pin = (gpio_num_t)sensor->desc->int_pin;
+    int_config.active_level = INTERRUPT_PIN_ACTIVE_HIGH;
+    int_config.pin_mode = INTERRUPT_PIN_PUSH_PULL;
+    int_config.interrupt_latch = INTERRUPT_LATCH_50US;
+    int_config.interrupt_clear_behavior = INTERRUPT_CLEAR_ON_ANY_READ;
+
+    uint8_t int_status;
+    esp_err_t ret = mpu6050_set_sample_rate(sensor->handle, sample_rate_hz);
+    if (ret == ESP_OK) {
+        ret = mpu6050_config_interrupts(sensor->handle, &int_config);
+    }
+#if CONFIG_MPU_TRANSPORT_SIM
+    if (ret == ESP_OK) {
+        sensor->sim_handler = handler;
+        ret = sim_start_polling(sample_rate_hz);
+    }
+#else
+    if (ret == ESP_OK) {
+        ret = gpio_isr_handler_add(int_config.interrupt_pin, handler, sensor);
+    }
+    if (ret == ESP_OK) {
+        ret = gpio_intr_enable(int_config.interrupt_pin);
+    }
+#endif
+    if (ret == ESP_OK) {
+        ret = mpu6050_enable_interrupts(sensor->handle, MPU6050_DATA_RDY_INT_BIT);
+    }
+    if (ret == ESP_OK) {
+        ret = mpu6050_get_interrupt_status(sensor->handle, &int_status);
+    }
+    if (!record_result(sensor, ret)) {
+        teardown_data_ready(sensor);
+        return false;
+    }
+    sensor->data_ready = true;
+    return true;
+}
+
+// Desfaz um início de aquisição que falhou. As ISRs saem primeiro, para nenhuma notificar
+// uma task apagada; as tasks ainda não leram nada e estão bloqueadas esperando o disparo.
+static void stop_acquisition(void) {
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+        if (sensors[sensor_id].data_ready) {
+            teardown_data_ready(&sensors[sensor_id]);
+        }
+    }
+    if (acq_task != NULL) {
+        vTaskDelete(acq_task);
+        acq_task = NULL;
+    }
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (frame_tasks[bus] != NULL) {
+            vTaskDelete(frame_tasks[bus]);
+            frame_tasks[bus] = NULL;
+        }
+    }
+    if (frame_barrier != NULL) {
+        vEventGroupDelete(frame_barrier);
+        frame_barrier = NULL;
+    }
+    frame_barrier_bits = 0;
+    frame_publisher_bus = -1;
+#if CONFIG_MPU_TRANSPORT_SIM
+    if (sim_poll_timer != NULL) {
+        esp_timer_stop(sim_poll_timer);
+    }
+#endif
+}
+
+static bool acquisition_can_start(void) {
+    if (acq_task != NULL || frame_barrier != NULL) {
+        ESP_LOGE(TAG, "Aquisição já iniciada");
+        return false;
+    }
+
+#if CONFIG_MPU_TRANSPORT_SIM
+    // O pino INT simulado chama o tratador direto, sem o serviço de ISR do GPIO
+    return true;
+#else
+    // O serviço de ISR pode já ter sido instalado por outro componente
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Erro ao instalar o serviço de ISR do GPIO");
+        return false;
+    }
+    return true;
+#endif
+}
+
+#if CONFIG_MPU_TRANSPORT_SIM
+// Fora de interrupção as APIs FromISR e o portYIELD_FROM_ISR não valem
+static void data_ready_handler(void *arg) {
+    sensor_entry_t *sensor = (sensor_entry_t *)arg;
+
+    sensor->irq_timestamp_us = esp_timer_get_time();
+    xTaskNotify(acq_task, 1u << sensor->id, eSetBits);
+}
+#else
+static void IRAM_ATTR data_ready_handler(void *arg) {
+    sensor_entry_t *sensor = (sensor_entry_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    sensor->irq_timestamp_us = esp_timer_get_time();
+    xTaskNotifyFromISR(acq_task, 1u << sensor->id, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+static void acquisition_task(void *pvParam) {
+    while (1) {
+        uint32_t pending = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &pending, portMAX_DELAY);
+
+        for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+            if ((pending & (1u << sensor_id)) == 0) {
+                continue;
+            }
+
+            sensor_entry_t *sensor = &sensors[sensor_id];
+            mpu_sample_t sample;
+            sample.timestamp_us = sensor->irq_timestamp_us;
+            if (!read_sample(sensor, &sample)) {
+                ESP_LOGW(TAG, "Erro ao ler dados do sensor %d", sensor_id);
+                continue;
+            }
+
+            portENTER_CRITICAL(&latest_lock);
+            latest[sensor_id] = sample;
+            latest_valid_mask |= 1u << sensor_id;
+            portEXIT_CRITICAL(&latest_lock);
+
+            if (acq_callback != NULL) {
+                acq_callback(sensor_id, &sample, acq_callback_arg);
+            }
+        }
+    }
+}
+
+bool mpu6050_start_acquisition(uint16_t sample_rate_hz, mpu_sample_cb_t callback, void *arg) {
+    if (!acquisition_can_start()) {
+        return false;
+    }
+
+    acq_callback = callback;
+    acq_callback_arg = arg;
+    if (xTaskCreate(acquisition_task, "mpu_acq", ACQ_TASK_STACK, NULL, ACQ_TASK_PRIO, &acq_task) != pdPASS) {
+        ESP_LOGE(TAG, "Erro ao criar a task de aquisição");
+        acq_task = NULL;
         return false;
     }
 
-    *roll = calculate_roll(accel.acce_x, accel.acce_y, accel.acce_z);
-    *pitch = calculate_pitch(accel.acce_x, accel.acce_y, accel.acce_z);
+    int started = 0;
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+        sensor_entry_t *sensor = &sensors[sensor_id];
+        if (sensor->handle == NULL || sensor->desc->int_pin < 0) {
+            ESP_LOGW(TAG, "Sensor %d fora da aquisição (não inicializado ou sem INT)", sensor_id);
+            continue;
+        }
+        if (!setup_data_ready(sensor, data_ready_handler, sample_rate_hz)) {
+            ESP_LOGE(TAG, "Erro ao configurar a interrupção do sensor %d", sensor_id);
+            continue;
+        }
+        started++;
+    }
+    if (started == 0) {
+        ESP_LOGE(TAG, "Nenhum sensor disponível para a aquisição");
+        stop_acquisition();
+        return false;
+    }
 
+    ESP_LOGI(TAG, "Aquisição por interrupção iniciada a %u Hz com %d sensores", sample_rate_hz, started);
     return true;
 }
+
+bool mpu6050_get_latest(int sensor_id, mpu_sample_t *sample) {
+    if (sample == NULL || sensor_id < 0 || sensor_id >= MPU_SENSOR_COUNT) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&latest_lock);
+    bool valid = (latest_valid_mask & (1u << sensor_id)) != 0;
+    if (valid) {
+        *sample = latest[sensor_id];
+    }
+    portEXIT_CRITICAL(&latest_lock);
+    return valid;
+}
+
+// O DATA READY do sensor de disparo acorda as tasks de todos os barramentos ao mesmo tempo
+#if CONFIG_MPU_TRANSPORT_SIM
+static void frame_trigger_handler(void *arg) {
+    frame_trigger_us = esp_timer_get_time();
+    frame_sequence++;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (frame_tasks[bus] != NULL) {
+            xTaskNotifyGive(frame_tasks[bus]);
+        }
+    }
+}
+#else
+static void IRAM_ATTR frame_trigger_handler(void *arg) {
+    BaseType_t woken = pdFALSE;
+
+    frame_trigger_us = esp_timer_get_time();
+    frame_sequence++;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (frame_tasks[bus] != NULL) {
+            vTaskNotifyGiveFromISR(frame_tasks[bus], &woken);
+        }
+    }
+    portYIELD_FROM_ISR(woken);
+}
+#endif
+
+static void publish_frame(void) {
+    uint32_t mask = 0;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (frame_tasks[bus] == NULL) {
+            continue;
+        }
+        if (frame_read_sequence[bus] != frame_read_sequence[frame_publisher_bus]) {
+            ESP_LOGW(TAG, "Frame descartado: barramentos atendendo disparos diferentes");
+            return;
+        }
+        mask |= frame_read_mask[bus];
+    }
+    if (mask == 0) {
+        ESP_LOGW(TAG, "Frame descartado: nenhum sensor lido");
+        return;
+    }
+
+    int64_t first = INT64_MAX;
+    int64_t last = INT64_MIN;
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+        if (mask & (1u << sensor_id)) {
+            int64_t t = frame_pending.sensors[sensor_id].timestamp_us;
+            first = (t < first) ? t : first;
+            last = (t > last) ? t : last;
+        }
+    }
+    frame_pending.timestamp_us = frame_trigger_us;
+    frame_pending.read_skew_us = last - first;
+    frame_pending.valid_mask = mask;
+
+    // As outras tasks só voltam a escrever em frame_pending no próximo disparo, pelo menos
+    // um período de amostragem depois; a cópia termina bem antes disso
+    portENTER_CRITICAL(&latest_lock);
+    latest_frame = frame_pending;
+    latest_frame_valid = true;
+    portEXIT_CRITICAL(&latest_lock);
+
+    if (frame_callback != NULL) {
+        frame_callback(&frame_pending, frame_callback_arg);
+    }
+}
+
+static void frame_bus_task(void *pvParam) {
+    int bus = (int)(intptr_t)pvParam;
+    const EventBits_t own_bit = 1u << bus;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        frame_read_sequence[bus] = frame_sequence;
+        frame_read_mask[bus] = read_bus(bus, frame_pending.sensors);
+
+        // Barreira: cada task espera as leituras dos outros barramentos terminarem
+        EventBits_t bits = xEventGroupSync(frame_barrier, own_bit, frame_barrier_bits,
+                                           pdMS_TO_TICKS(FRAME_BARRIER_TIMEOUT_MS));
+        if (bus != frame_publisher_bus) {
+            continue;
+        }
+        if ((bits & frame_barrier_bits) != frame_barrier_bits) {
+            // Algum barramento não chegou: descarta o frame e desfaz os bits deixados na barreira
+            xEventGroupClearBits(frame_barrier, frame_barrier_bits);
+            ESP_LOGW(TAG, "Timeout na barreira do frame");
+            continue;
+        }
+        publish_frame();
+    }
+}
+
+bool mpu6050_start_frame_acquisition(uint16_t sample_rate_hz, mpu_frame_cb_t callback, void *arg) {
+    if (!acquisition_can_start()) {
+        return false;
+    }
+
+    // O primeiro sensor inicializado com INT dispara os frames
+    sensor_entry_t *trigger = NULL;
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT && trigger == NULL; sensor_id++) {
+        if (sensors[sensor_id].handle != NULL && sensors[sensor_id].desc->int_pin >= 0) {
+            trigger = &sensors[sensor_id];
+        }
+    }
+    if (trigger == NULL) {
+        ESP_LOGE(TAG, "Nenhum sensor com INT disponível para disparar os frames");
+        return false;
+    }
+
+    frame_callback = callback;
+    frame_callback_arg = arg;
+    frame_barrier = xEventGroupCreate();
+    if (frame_barrier == NULL) {
+        ESP_LOGE(TAG, "Erro ao criar a barreira do frame");
+        return false;
+    }
+
+    // Os outros sensores amostram na mesma taxa e são lidos no mesmo instante
+    bool bus_in_use[MPU_NUM_BUSES] = {};
+    for (int sensor_id = 0; sensor_id < MPU_SENSOR_COUNT; sensor_id++) {
+        sensor_entry_t *sensor = &sensors[sensor_id];
+        if (sensor->handle == NULL) {
+            continue;
+        }
+        bus_in_use[sensor->desc->bus] = true;
+        if (sensor != trigger && !record_result(sensor, mpu6050_set_sample_rate(sensor->handle, sample_rate_hz))) {
+            ESP_LOGW(TAG, "Erro ao configurar a taxa do sensor %d", sensor_id);
+        }
+    }
+
+    // Uma task por barramento, cada uma em um núcleo, para as transações correrem em paralelo
+    frame_barrier_bits = 0;
+    for (int bus = 0; bus < MPU_NUM_BUSES; bus++) {
+        if (!bus_in_use[bus]) {
+            continue;
+        }
+        if (frame_publisher_bus < 0) {
+            frame_publisher_bus = bus;
+        }
+        frame_barrier_bits |= 1u << bus;
+
+        char name[] = "mpu_bus0";
+        name[sizeof(name) - 2] += bus;
+        if (xTaskCreatePinnedToCore(frame_bus_task, name, ACQ_TASK_STACK, (void *)(intptr_t)bus,
+                                    ACQ_TASK_PRIO, &frame_tasks[bus], bus % portNUM_PROCESSORS) != pdPASS) {
+            ESP_LOGE(TAG, "Erro ao criar a task do barramento %d", bus);
+            frame_tasks[bus] = NULL;
+            stop_acquisition();
+            return false;
+        }
+    }
+
+    if (!setup_data_ready(trigger, frame_trigger_handler, sample_rate_hz)) {
+        ESP_LOGE(TAG, "Erro ao configurar a interrupção do sensor %d", trigger->id);
+        stop_acquisition();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Aquisição em frames iniciada a %u Hz, disparo pelo sensor %d", sample_rate_hz, trigger->id);
+    return true;
+}
+
+bool mpu6050_get_latest_frame(mpu_frame_t *frame) {
+    if (frame == NULL) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&latest_lock);
+    bool valid = latest_frame_valid;
+    if (valid) {
+        *frame = latest_frame;
+    }
+    portEXIT_CRITICAL(&latest_lock);
+    return valid;
+}
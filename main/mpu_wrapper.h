@@ -2,28 +2,238 @@
 #define MPU_WRAPPER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "mpu6050.h"
+#include "fusion.h"
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+#include "fusion_fixed.h"
+#endif
+#if CONFIG_MPU_TRANSPORT_SIM
+#include "mpu6050_sim.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Inicializa os dois sensores MPU6050
- * @return true se a inicialização foi bem-sucedida, false caso contrário
+ * @brief Número de sensores do registro, configurado em "MPU6050 Configuration" no menuconfig
+ */
+#define MPU_SENSOR_COUNT CONFIG_MPU_SENSOR_COUNT
+
+/**
+ * @brief Amostra de um sensor
+ *
+ * Com "Fixed point orientation" no menuconfig a amostra fica em unidades do sensor e a
+ * orientação em ângulos binários; mpu6050_sample_euler() converte os dois formatos.
+ */
+typedef struct {
+    int64_t timestamp_us;               /*!< Instante da amostra (base esp_timer_get_time) */
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    mpu6050_raw_motion_value_t raw;     /*!< Acelerômetro, giroscópio e temperatura, sem escala */
+    fusion_fixed_angles_t orientation;  /*!< Roll e pitch do sensor após esta amostra */
+#else
+    mpu6050_motion_value_t motion;      /*!< Acelerômetro, giroscópio e temperatura */
+    fusion_quat_t orientation;          /*!< Orientação do sensor após esta amostra */
+#endif
+} mpu_sample_t;
+
+/**
+ * @brief Estado de erro de um sensor do registro
+ */
+typedef struct {
+    bool initialized;               /*!< Sensor criado e configurado em mpu6050_init_all() */
+    esp_err_t last_error;           /*!< Resultado da última operação no sensor */
+    uint32_t error_count;           /*!< Total de operações com erro */
+} mpu_sensor_status_t;
+
+/**
+ * @brief Chamado pela task de aquisição a cada amostra nova
+ * @param sensor_id ID do sensor que gerou a amostra
+ * @param sample Amostra lida, válida apenas durante a chamada
+ * @param arg Argumento passado a mpu6050_start_acquisition()
+ */
+typedef void (*mpu_sample_cb_t)(int sensor_id, const mpu_sample_t *sample, void *arg);
+
+/**
+ * @brief Amostras de todos os sensores, lidas em paralelo nos barramentos I2C
+ *
+ * read_skew_us mede só as leituras, não a defasagem da amostragem: cada sensor amostra no
+ * seu próprio relógio, sem FSYNC, e o valor lido é o último registrado por ele, que pode ter
+ * sido amostrado até um período antes do disparo.
+ */
+typedef struct {
+    int64_t timestamp_us;                   /*!< Instante do DATA READY que disparou as leituras */
+    int64_t read_skew_us;                   /*!< Diferença entre o primeiro e o último início de leitura */
+    uint32_t valid_mask;                    /*!< Bit n ligado se sensors[n] foi lido com sucesso */
+    mpu_sample_t sensors[MPU_SENSOR_COUNT]; /*!< timestamp_us de cada amostra é o início da sua leitura */
+} mpu_frame_t;
+
+/**
+ * @brief Chamado a cada frame completo
+ * @param frame Frame lido, válido apenas durante a chamada
+ * @param arg Argumento passado a mpu6050_start_frame_acquisition()
+ */
+typedef void (*mpu_frame_cb_t)(const mpu_frame_t *frame, void *arg);
+
+/**
+ * @brief Inicializa os barramentos I2C em uso e todos os sensores do registro
+ *
+ * Um sensor que falha não impede a inicialização dos outros; veja mpu6050_get_sensor_status().
+ * Chamar de novo só tenta os sensores que falharam: os já inicializados, seus barramentos
+ * e o estado dos seus filtros são mantidos.
+ * Com o transporte "Simulator" no menuconfig os sensores são simulados (mpu6050_sim.h) e
+ * nenhum barramento I2C é usado.
+ *
+ * @return true se todos os sensores foram inicializados, false caso contrário
  */
 bool mpu6050_init_all(void);
 
 /**
- * @brief Obtém os valores de roll e pitch de um sensor específico
- * @param sensor_id ID do sensor (0 ou 1)
+ * @brief Obtém o estado de erro de um sensor
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param status Ponteiro para armazenar o estado
+ * @return true se o ID é válido, false caso contrário
+ */
+bool mpu6050_get_sensor_status(int sensor_id, mpu_sensor_status_t *status);
+
+/**
+ * @brief Lê uma amostra e obtém os valores de roll e pitch de um sensor específico
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
  * @param roll Ponteiro para armazenar o valor do roll
  * @param pitch Ponteiro para armazenar o valor do pitch
  * @return true se a leitura foi bem-sucedida, false caso contrário
  */
 bool mpu6050_get_orientation(int sensor_id, float *roll, float *pitch);
 
+/**
+ * @brief Converte a orientação de uma amostra em graus
+ * @param sample Amostra lida pelo wrapper
+ * @param euler Ponteiro para armazenar os ângulos (yaw é 0 em ponto fixo)
+ */
+void mpu6050_sample_euler(const mpu_sample_t *sample, fusion_euler_t *euler);
+
+/**
+ * @brief Lê todos os sensores, um barramento por vez, com os sensores de cada barramento em sequência
+ * @param samples Vetor de MPU_SENSOR_COUNT posições, indexado pelo ID do sensor
+ * @param valid_mask Ponteiro para armazenar os bits dos sensores lidos com sucesso
+ * @return true se todos os sensores foram lidos, false caso contrário
+ */
+bool mpu6050_read_all(mpu_sample_t *samples, uint32_t *valid_mask);
+
+/**
+ * @brief Liga o modo FIFO de um sensor, que passa a amostrar sozinho
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param sample_rate_hz Taxa de amostragem (MPU6050_MIN_RATE_HZ a MPU6050_MAX_RATE_HZ)
+ * @return true se o FIFO foi ligado, false caso contrário
+ */
+bool mpu6050_start_stream(int sensor_id, uint16_t sample_rate_hz);
+
+/**
+ * @brief Desliga o modo FIFO de um sensor
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @return true se o FIFO foi desligado, false caso contrário
+ */
+bool mpu6050_stop_stream(int sensor_id);
+
+/**
+ * @brief Retorna todas as amostras acumuladas desde a última chamada, da mais antiga para a mais nova
+ *
+ * Amostras que não couberem em samples ficam no FIFO para a próxima chamada.
+ * Um buffer de MPU6050_FIFO_MAX_SAMPLES posições sempre esvazia o FIFO.
+ *
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param samples Vetor que recebe as amostras
+ * @param max_samples Capacidade de samples
+ * @param count Ponteiro para armazenar o número de amostras lidas
+ * @return true se a leitura foi bem-sucedida, false caso contrário (inclusive estouro do FIFO)
+ */
+bool mpu6050_get_samples(int sensor_id, mpu_sample_t *samples, size_t max_samples, size_t *count);
+
+/**
+ * @brief Inicia a aquisição por interrupção DATA READY
+ *
+ * O pino INT de cada sensor dispara uma ISR que notifica uma task dedicada, que lê a
+ * amostra em rajada. Não há polling: a task fica bloqueada entre amostras e o instante
+ * de cada amostra é capturado na ISR. Sensores sem pino INT configurado são ignorados.
+ * Com sensores simulados o pino INT também é simulado e a notificação é feita em
+ * contexto de task, pela task do esp_timer.
+ *
+ * @param sample_rate_hz Taxa de amostragem (MPU6050_MIN_RATE_HZ a MPU6050_MAX_RATE_HZ)
+ * @param callback Função chamada a cada amostra, ou NULL
+ * @param arg Argumento repassado ao callback
+ * @return true se a aquisição foi iniciada, false caso contrário
+ */
+bool mpu6050_start_acquisition(uint16_t sample_rate_hz, mpu_sample_cb_t callback, void *arg);
+
+/**
+ * @brief Obtém a amostra mais recente lida pela task de aquisição
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param sample Ponteiro para armazenar a amostra
+ * @return true se já existe uma amostra, false caso contrário
+ */
+bool mpu6050_get_latest(int sensor_id, mpu_sample_t *sample);
+
+/**
+ * @brief Inicia a aquisição em frames, com os barramentos I2C lidos em paralelo
+ *
+ * O DATA READY do primeiro sensor com pino INT acorda uma task por barramento, fixadas em
+ * núcleos diferentes, que leem seus sensores ao mesmo tempo. Uma barreira junta as leituras
+ * em um frame alinhado no tempo. Não pode ser usada junto com mpu6050_start_acquisition().
+ *
+ * @param sample_rate_hz Taxa de amostragem (MPU6050_MIN_RATE_HZ a MPU6050_MAX_RATE_HZ)
+ * @param callback Função chamada a cada frame, ou NULL
+ * @param arg Argumento repassado ao callback
+ * @return true se a aquisição foi iniciada, false caso contrário
+ */
+bool mpu6050_start_frame_acquisition(uint16_t sample_rate_hz, mpu_frame_cb_t callback, void *arg);
+
+/**
+ * @brief Obtém o frame mais recente da aquisição em frames
+ * @param frame Ponteiro para armazenar o frame
+ * @return true se já existe um frame, false caso contrário
+ */
+bool mpu6050_get_latest_frame(mpu_frame_t *frame);
+
+#if CONFIG_MPU_TRANSPORT_SIM
+/**
+ * @brief Congela ou solta o relógio dos sensores simulados
+ *
+ * Com o relógio parado nenhuma amostra vence sozinha: só mpu6050_sim_data_ready() produz
+ * amostras, o que torna a aquisição determinística nos testes.
+ *
+ * @param hold true para parar o relógio no instante atual, false para voltar a segui-lo
+ */
+void mpu6050_sim_hold_clock(bool hold);
+
+/**
+ * @brief Troca o movimento de um sensor simulado
+ *
+ * Deve ser chamada antes de iniciar a aquisição: o simulador lê o movimento sem trava.
+ *
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param motion Movimento, copiado
+ * @return true se o ID é válido, false caso contrário
+ */
+bool mpu6050_sim_set_motion(int sensor_id, const mpu6050_sim_sway_t *motion);
+
+/**
+ * @brief Produz amostras em um sensor simulado, como se tantos períodos tivessem passado
+ *
+ * Com o DATA READY configurado, o pino INT simulado notifica a aquisição uma vez, na
+ * task que chamou esta função.
+ *
+ * @param sensor_id ID do sensor (0 a MPU_SENSOR_COUNT - 1)
+ * @param samples Número de amostras
+ * @return true se as amostras foram produzidas, false caso contrário
+ */
+bool mpu6050_sim_data_ready(int sensor_id, uint32_t samples);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // MPU_WRAPPER_H
\ No newline at end of file
+#endif // MPU_WRAPPER_H
@@ -0,0 +1,193 @@
+#include <math.h>
+#include <stdio.h>
+#include "unity.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mpu_wrapper.h"
+
+#define TEST_RATE_HZ        100
+#define TEST_PERIOD_US      (1000000 / TEST_RATE_HZ)
+#define TEST_SAMPLES        20
+#define ACCE_LSB_PER_G      4096.0f     /*!< ACCE_FS_8G, configurado em mpu6050_init_all() */
+
+/* Sensors wired to an INT pin, as in the registry */
+static const int int_io[MPU_SENSOR_COUNT] = {
+    CONFIG_MPU_SENSOR0_INT_IO,
+#if MPU_SENSOR_COUNT > 1
+    CONFIG_MPU_SENSOR1_INT_IO,
+#endif
+#if MPU_SENSOR_COUNT > 2
+    CONFIG_MPU_SENSOR2_INT_IO,
+#endif
+#if MPU_SENSOR_COUNT > 3
+    CONFIG_MPU_SENSOR3_INT_IO,
+#endif
+};
+
+typedef struct {
+    int sensor_id;
+    mpu_sample_t sample;
+} test_record_t;
+
+static test_record_t records[TEST_SAMPLES * MPU_SENSOR_COUNT + 1];
+static volatile int record_count;
+static SemaphoreHandle_t sample_done;
+
+static void on_sample(int sensor_id, const mpu_sample_t *sample, void *arg)
+{
+    if (record_count < (int)(sizeof(records) / sizeof(records[0]))) {
+        records[record_count].sensor_id = sensor_id;
+        records[record_count].sample = *sample;
+        record_count++;
+    }
+    xSemaphoreGive(sample_done);
+}
+
+static void sample_acce(const mpu_sample_t *sample, float acce[3])
+{
+#if CONFIG_MPU_ORIENTATION_FIXED_POINT
+    acce[0] = sample->raw.acce.raw_acce_x / ACCE_LSB_PER_G;
+    acce[1] = sample->raw.acce.raw_acce_y / ACCE_LSB_PER_G;
+    acce[2] = sample->raw.acce.raw_acce_z / ACCE_LSB_PER_G;
+#else
+    acce[0] = sample->motion.acce.acce_x;
+    acce[1] = sample->motion.acce.acce_y;
+    acce[2] = sample->motion.acce.acce_z;
+#endif
+}
+
+/*
+ * The simulated clock is held, so each sample comes from one mpu6050_sim_data_ready() call:
+ * its INT pulse must reach the acquisition task, and the callback must see every sample
+ * once, in order, with the values the motion source gave it.
+ */
+TEST_CASE("Acquisition reads every simulated DATA READY once, in order", "[mpu_wrapper]")
+{
+    mpu6050_sim_sway_t motion[MPU_SENSOR_COUNT];
+    int wired[MPU_SENSOR_COUNT];
+    int wired_count = 0;
+
+    mpu6050_sim_hold_clock(true);
+    TEST_ASSERT_TRUE(mpu6050_init_all());
+    for (int id = 0; id < MPU_SENSOR_COUNT; id++) {
+        /* Fast enough that consecutive samples differ, so a repeated or skipped one shows */
+        motion[id].roll_deg = 10.0f + 5.0f * id;
+        motion[id].pitch_deg = -20.0f + 3.0f * id;
+        motion[id].amplitude_deg = 30.0f;
+        motion[id].frequency_hz = 2.0f;
+        motion[id].temp = 25.0f;
+        TEST_ASSERT_TRUE(mpu6050_sim_set_motion(id, &motion[id]));
+        if (int_io[id] >= 0) {
+            wired[wired_count++] = id;
+        }
+    }
+    if (wired_count == 0) {
+        TEST_IGNORE_MESSAGE("No sensor with an INT pin");
+    }
+
+    sample_done = xSemaphoreCreateCounting(TEST_SAMPLES * MPU_SENSOR_COUNT, 0);
+    TEST_ASSERT_NOT_NULL(sample_done);
+    record_count = 0;
+    TEST_ASSERT_TRUE(mpu6050_start_acquisition(TEST_RATE_HZ, on_sample, NULL));
+
+    for (int k = 0; k < TEST_SAMPLES; k++) {
+        for (int i = 0; i < wired_count; i++) {
+            TEST_ASSERT_TRUE(mpu6050_sim_data_ready(wired[i], 1));
+            TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(sample_done, pdMS_TO_TICKS(1000)));
+        }
+    }
+    /* Nothing more arrives while the clock is held */
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT_EQUAL(TEST_SAMPLES * wired_count, record_count);
+
+    for (int n = 0; n < record_count; n++) {
+        int k = n / wired_count;
+        int id = wired[n % wired_count];
+        TEST_ASSERT_EQUAL(id, records[n].sensor_id);
+
+        mpu6050_sim_sample_t expected;
+        float acce[3];
+        mpu6050_sim_sway_source(&motion[id], k, (int64_t) k * TEST_PERIOD_US, &expected);
+        sample_acce(&records[n].sample, acce);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f / ACCE_LSB_PER_G, expected.acce_x, acce[0]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f / ACCE_LSB_PER_G, expected.acce_y, acce[1]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f / ACCE_LSB_PER_G, expected.acce_z, acce[2]);
+        if (n >= wired_count) {
+            TEST_ASSERT_GREATER_THAN(records[n - wired_count].sample.timestamp_us, records[n].sample.timestamp_us);
+        }
+    }
+
+    mpu_sample_t latest;
+    TEST_ASSERT_TRUE(mpu6050_get_latest(wired[0], &latest));
+    TEST_ASSERT_EQUAL(records[record_count - wired_count].sample.timestamp_us, latest.timestamp_us);
+    mpu6050_sim_hold_clock(false);
+}
+
+/*
+ * A FIFO holding several bursts comes back whole and in order: the sway phase, recovered
+ * from the gravity vector of each sample, advances by exactly one sample period each time.
+ */
+TEST_CASE("FIFO drain returns every buffered sample in order", "[mpu_wrapper]")
+{
+    const int id = 0;
+    const size_t buffered = 2 * MPU6050_FIFO_READ_FRAMES + 5;
+    static mpu_sample_t samples[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_sim_sway_t motion = {};
+    size_t count = 0;
+
+    motion.roll_deg = 10.0f;
+    motion.pitch_deg = -20.0f;
+    motion.amplitude_deg = 30.0f;
+    motion.frequency_hz = 2.0f;
+    motion.temp = 25.0f;
+    const float step = 2.0f * (float) M_PI * motion.frequency_hz * TEST_PERIOD_US / 1e6f;
+
+    mpu6050_sim_hold_clock(true);
+    TEST_ASSERT_TRUE(mpu6050_init_all());
+    TEST_ASSERT_TRUE(mpu6050_sim_set_motion(id, &motion));
+    TEST_ASSERT_TRUE(mpu6050_start_stream(id, TEST_RATE_HZ));
+    TEST_ASSERT_TRUE(mpu6050_sim_data_ready(id, buffered));
+    TEST_ASSERT_TRUE(mpu6050_get_samples(id, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(buffered, count);
+
+    float previous = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float acce[3];
+        sample_acce(&samples[i], acce);
+        float roll = asinf(acce[1]) * 180.0f / (float) M_PI;
+        float pitch = asinf(-acce[0]) * 180.0f / (float) M_PI;
+        float phase = atan2f((roll - motion.roll_deg) / motion.amplitude_deg,
+                             (pitch - motion.pitch_deg) / motion.amplitude_deg);
+        if (i > 0) {
+            float advance = remainderf(phase - previous, 2.0f * (float) M_PI);
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, step, advance);
+            TEST_ASSERT_EQUAL(TEST_PERIOD_US, samples[i].timestamp_us - samples[i - 1].timestamp_us);
+        }
+        previous = phase;
+    }
+
+    TEST_ASSERT_TRUE(mpu6050_get_samples(id, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(0, count);
+    TEST_ASSERT_TRUE(mpu6050_stop_stream(id));
+    mpu6050_sim_hold_clock(false);
+}
+
+/* A second init must keep the sensors it already set up, with their FIFO still streaming */
+TEST_CASE("A second init keeps the sensors already running", "[mpu_wrapper]")
+{
+    const int id = 0;
+    static mpu_sample_t samples[MPU6050_FIFO_MAX_SAMPLES];
+    size_t count = 0;
+
+    mpu6050_sim_hold_clock(true);
+    TEST_ASSERT_TRUE(mpu6050_init_all());
+    TEST_ASSERT_TRUE(mpu6050_start_stream(id, TEST_RATE_HZ));
+    TEST_ASSERT_TRUE(mpu6050_init_all());
+    TEST_ASSERT_TRUE(mpu6050_sim_data_ready(id, 3));
+    TEST_ASSERT_TRUE(mpu6050_get_samples(id, samples, MPU6050_FIFO_MAX_SAMPLES, &count));
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_TRUE(mpu6050_stop_stream(id));
+    mpu6050_sim_hold_clock(false);
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
-#include "driver/i2c.h"
+#include <time.h>
+#include <sys/time.h>
 #include "mpu6050.h"
 #include "math.h"
 #include "driver/gpio.h"
@@ -10,17 +11,24 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "esp_netif.h"
+#include "esp_netif_sntp.h"
 #include "esp_eap_client.h"
 
 #include "jsoncpp/value.h"
 #include "jsoncpp/json.h"
 #include "esp_firebase/app.h"
 #include "esp_firebase/rtdb.h"
+#include "esp_firebase/rtdb_batch.h"
+#include "esp_firebase/json_stream.h"
 #include "firebase_config.h"
 #include "mpu_wrapper.h"  // Adicione esta linha
+#include "sample_ring.h"
+#include "sample_journal.h"
 
 #include <iostream>
 
@@ -31,19 +39,103 @@ using namespace ESPFirebase;
 #define EAP_USERNAME "a2456621"
 #define EAP_PASSWORD "qatezc10"
 #define CONNECTED_BIT BIT0
+#define AUTH_BIT BIT1
+#define LOGIN_RETRY_MS 10000
+#define MPU_SAMPLE_RATE_HZ 100
+#define UPLOAD_POLL_MS 100
+#define UPLOAD_HISTORY_PERIOD_US 100000 // Um registro a cada 100 ms vai para o histórico
+#define UPLOAD_BATCH_SAMPLES 20         // Registros por requisição
+#define UPLOAD_BATCH_AGE_MS 2000        // Tempo máximo de um registro na fila do lote
+#define SAMPLE_ARENA_BLOCK 2048         // Bytes; um registro de vários sensores cabe num bloco
+#define CLOCK_VALID_EPOCH_S 1700000000 // Antes disso o relógio ainda não foi acertado pelo SNTP
+#define UPLOAD_RING_CAPACITY 256    // Registros; 25,6 s de histórico, cobre a associação e o login no boot
+#define UPLOAD_RING_POLICY SAMPLE_RING_DROP_OLDEST
+#define JOURNAL_PARTITION "journal"
+#define JOURNAL_DRAIN_RECORDS 50    // Registros por requisição ao reenviar o journal
+#define JOURNAL_RETRY_MS 2000       // Espera após um reenvio que falhou
+#define UPLOAD_ANGLE_DECIMALS 2     // Casas decimais dos ângulos enviados, as mesmas do log
 
 static EventGroupHandle_t wifi_event_group;
 static esp_netif_t *sta_netif = NULL;
 static const char *TAG = "INTEGRADO";
 
+// Marcos do boot, para medir o tempo até a primeira amostra e o primeiro envio
+typedef enum {
+    BOOT_SENSORS_READY,
+    BOOT_FIRST_SAMPLE,
+    BOOT_WIFI_CONNECTED,    // Associado, handshake WPA2-Enterprise concluído
+    BOOT_GOT_IP,
+    BOOT_AUTHENTICATED,
+    BOOT_CLOCK_SYNCED,
+    BOOT_FIRST_UPLOAD,
+    BOOT_PHASE_COUNT,
+} boot_phase_t;
+
+static const char *const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "sensores", "primeira amostra", "Wi-Fi", "IP", "Firebase", "SNTP", "primeiro envio",
+};
+// Instante de esp_timer_get_time() de cada marco, 0 enquanto não ocorreu; cada marco tem uma só task escritora
+static int64_t boot_phase_us[BOOT_PHASE_COUNT];
+
+// Orientação de todos os sensores em um frame, o que a task de upload consome
+typedef struct {
+    int64_t timestamp_us;
+    uint32_t valid_mask;
+    float roll[MPU_SENSOR_COUNT];
+    float pitch[MPU_SENSOR_COUNT];
+} upload_record_t;
+
+// Registro do histórico como vai ao banco e ao journal: o instante já no relógio de parede,
+// para continuar válido depois de um reset
+typedef struct {
+    int64_t timestamp_ms;
+    uint32_t valid_mask;
+    float roll[MPU_SENSOR_COUNT];
+    float pitch[MPU_SENSOR_COUNT];
+} history_record_t;
+
+// Criados pela auth_task antes de AUTH_BIT; só usados depois dele
+static FirebaseApp *firebase_app = NULL;
+static RTDB *firebase_db = NULL;
+
+// Liga a aquisição (produtora) ao upload (consumidora) sem que uma espere pela outra
+static upload_record_t upload_storage[UPLOAD_RING_CAPACITY];
+static sample_ring_t upload_ring;
+
+// Registra só a primeira ocorrência: reconexões e novas sincronizações não contam
+static void boot_mark(boot_phase_t phase) {
+    if (boot_phase_us[phase] != 0) {
+        return;
+    }
+    boot_phase_us[phase] = esp_timer_get_time();
+    ESP_LOGI(TAG, "Boot: %s em %lld ms", boot_phase_names[phase], (long long)(boot_phase_us[phase] / 1000));
+}
+
+static void boot_log_summary(void) {
+    char line[160];
+    int len = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT && len < (int)sizeof(line); i++) {
+        len += snprintf(line + len, sizeof(line) - len, "%s%s %lld", i ? ", " : "", boot_phase_names[i],
+                        (long long)(boot_phase_us[i] / 1000));
+    }
+    ESP_LOGI(TAG, "Boot (ms): %s", line);
+}
+
+static void on_clock_synced(struct timeval *tv) {
+    boot_mark(BOOT_CLOCK_SYNCED);
+}
+
 void wifi_event_handler(void *arg, esp_event_base_t event_base,
                         int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        boot_mark(BOOT_WIFI_CONNECTED);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         esp_wifi_connect();
         xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        boot_mark(BOOT_GOT_IP);
         xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
     }
 }
@@ -59,6 +151,11 @@ void init_wifi() {
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
 
+    // O SNTP fica pendente e consulta o servidor assim que houver IP, em paralelo ao login
+    esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+    sntp_config.sync_cb = on_clock_synced;
+    esp_netif_sntp_init(&sntp_config);
+
     wifi_config_t wifi_config = {};
     strcpy((char *)wifi_config.sta.ssid, WIFI_SSID);
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
@@ -72,62 +169,274 @@ void init_wifi() {
     ESP_ERROR_CHECK(esp_wifi_start());
 }
 
-void mpu_task(void *pvParam) {
-    // Aguarda Wi-Fi
-    xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+// Chamado pela task de aquisição a cada frame: só converte e copia, nunca bloqueia.
+// Só os frames do histórico entram no ring, que assim guarda as amostras do boot até o primeiro envio
+static void on_frame(const mpu_frame_t *frame, void *arg) {
+    static int64_t next_history_us = 0;
+
+    if (frame->valid_mask == 0 || frame->timestamp_us < next_history_us) {
+        return;
+    }
+    next_history_us = frame->timestamp_us + UPLOAD_HISTORY_PERIOD_US;
+    boot_mark(BOOT_FIRST_SAMPLE);
+
+    upload_record_t record = {};
+    record.timestamp_us = frame->timestamp_us;
+    record.valid_mask = frame->valid_mask;
+
+    for (int i = 0; i < MPU_SENSOR_COUNT; i++) {
+        if (frame->valid_mask & (1u << i)) {
+            fusion_euler_t euler;
+            mpu6050_sample_euler(&frame->sensors[i], &euler);
+            record.roll[i] = euler.roll;
+            record.pitch[i] = euler.pitch;
+        }
+    }
+    sample_ring_push(&upload_ring, &record);
+}
+
+// Converte um instante de esp_timer_get_time() para o relógio de parede, em ms
+static int64_t wall_clock_ms(int64_t timestamp_us) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+    return (now_us - (esp_timer_get_time() - timestamp_us)) / 1000;
+}
+
+static void to_history_record(const upload_record_t *record, history_record_t *history) {
+    history->timestamp_ms = wall_clock_ms(record->timestamp_us);
+    history->valid_mask = record->valid_mask;
+    memcpy(history->roll, record->roll, sizeof(history->roll));
+    memcpy(history->pitch, record->pitch, sizeof(history->pitch));
+}
+
+static Json::Value record_to_json(const history_record_t *record) {
+    Json::Value sample(Json::objectValue);
+    for (int i = 0; i < MPU_SENSOR_COUNT; i++) {
+        if (record->valid_mask & (1u << i)) {
+            std::string key = "sensor" + std::to_string(i + 1);
+            sample[key]["roll"] = record->roll[i];
+            sample[key]["pitch"] = record->pitch[i];
+        }
+    }
+    return sample;
+}
+
+// A amostra é montada numa arena esvaziada a cada registro, sem um malloc por nó; o lote copia
+// o que guarda para a sua própria arena
+static esp_err_t batch_add(RTDBBatch *batch, Json::Arena *arena, const history_record_t *record) {
+    Json::Value sample;
+    {
+        Json::ArenaScope scope(*arena);
+        sample = record_to_json(record);
+    }
+    esp_err_t err = batch->add(record->timestamp_ms, sample);
+    sample.abandonArena();
+    arena->reset();
+    return err;
+}
+
+// Mesmo conteúdo de record_to_json, sem montar um Json::Value por registro
+static void write_record(JsonStream &stream, const history_record_t *record) {
+    char key[16];
+    stream.beginObject();
+    for (int i = 0; i < MPU_SENSOR_COUNT; i++) {
+        if (record->valid_mask & (1u << i)) {
+            snprintf(key, sizeof(key), "sensor%d", i + 1);
+            stream.key(key);
+            stream.beginObject();
+            stream.key("pitch");
+            stream.value(Json::Value(record->pitch[i]));
+            stream.key("roll");
+            stream.value(Json::Value(record->roll[i]));
+            stream.endObject();
+        }
+    }
+    stream.endObject();
+}
 
-    // Inicializa Firebase
-    FirebaseApp app = FirebaseApp(API_KEY);
-    if (!app.loginUserAccount({USER_EMAIL, USER_PASSWORD})) {
-        ESP_LOGE(TAG, "Falha no login Firebase");
-        vTaskDelete(NULL);
+// Reenvia os registros mais antigos do journal em uma requisição; só os libera depois que o banco confirmou.
+// Um reset no meio reenvia o último lote, o que não muda nada: a chave de cada registro é o seu instante
+static esp_err_t drain_journal(sample_journal_t *journal, const char *path, uint32_t *drained) {
+    static history_record_t records[JOURNAL_DRAIN_RECORDS];
+    size_t count = sample_journal_peek(journal, records, JOURNAL_DRAIN_RECORDS);
+    if (count == 0) {
+        // Só havia registros corrompidos por uma queda de energia
+        return sample_journal_release(journal);
     }
-    RTDB db(&app, DATABASE_URL);
+
+    // Escrito direto na conexão, registro por registro: o lote nunca existe inteiro na memória
+    esp_err_t err = firebase_db->patchDataSilent(path, [count](JsonStream &stream) {
+        stream.beginObject();
+        for (size_t i = 0; i < count; i++) {
+            stream.key(RTDBBatch::sampleKey(records[i].timestamp_ms).c_str());
+            write_record(stream, &records[i]);
+        }
+        stream.endObject();
+    });
+    if (err != ESP_OK) {
+        return err;
+    }
+    *drained += count;
+    return sample_journal_release(journal);
+}
+
+// O login começa assim que houver IP, sem esperar o SNTP, e é repetido até dar certo
+void auth_task(void *pvParam) {
+    FirebaseApp *app = new FirebaseApp(API_KEY);
+
+    while (1) {
+        xEventGroupWaitBits(wifi_event_group, CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+        if (app->loginUserAccount({USER_EMAIL, USER_PASSWORD}) == ESP_OK) {
+            break;
+        }
+        ESP_LOGE(TAG, "Falha no login Firebase, nova tentativa em %d s", LOGIN_RETRY_MS / 1000);
+        vTaskDelay(pdMS_TO_TICKS(LOGIN_RETRY_MS));
+    }
+    firebase_db = new RTDB(app, DATABASE_URL);
+    // 12.34 em vez de 12.34000015258789: um terço dos bytes por ângulo
+    firebase_db->setPrecision(UPLOAD_ANGLE_DECIMALS, Json::PrecisionType::decimalPlaces);
+    firebase_app = app;
+    boot_mark(BOOT_AUTHENTICATED);
     ESP_LOGI(TAG, "Firebase conectado");
+    xEventGroupSetBits(wifi_event_group, AUTH_BIT);
+    vTaskDelete(NULL);
+}
 
-    // Inicializa os MPU6050 usando o wrapper
-    if (!mpu6050_init_all()) {
-        ESP_LOGE(TAG, "Falha na inicialização dos sensores MPU6050");
-        vTaskDelete(NULL);
+void upload_task(void *pvParam) {
+    // Sem rede, o histórico vai para o journal na flash e é reenviado quando ela volta
+    static sample_journal_t journal;
+    journal_flash_t *journal_flash = NULL;
+    bool journal_ok = journal_new_partition_flash(JOURNAL_PARTITION, &journal_flash) == ESP_OK &&
+                      sample_journal_open(&journal, journal_flash, sizeof(history_record_t)) == ESP_OK;
+    if (journal_ok) {
+        ESP_LOGI(TAG, "Journal: %lu registros pendentes, capacidade %lu",
+                 (unsigned long)sample_journal_pending(&journal), (unsigned long)sample_journal_capacity(&journal));
+    } else {
+        ESP_LOGE(TAG, "Journal indisponível: sem rede, o histórico se perde");
     }
-    ESP_LOGI(TAG, "Sensores MPU6050 inicializados");
 
-    Json::Value data;
+    // Histórico deste dispositivo em /accel/<MAC>/<instante em ms>
+    uint8_t mac[6];
+    char path[32];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(path, sizeof(path), "/accel/%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    RTDBBatch *batch = NULL;
+    Json::Arena sample_arena(SAMPLE_ARENA_BLOCK);
+
+    uint32_t reported_requests = 0;
+    uint32_t lost = 0;
+    bool journaling = false;
+    int64_t next_drain_us = 0;
+    int64_t drain_start_us = 0;
+    uint32_t drained = 0;
+    TickType_t last_wake = xTaskGetTickCount();
 
     while (1) {
-        float roll0, pitch0, roll1, pitch1;
-
-        // Lê dados do MPU0
-        if (mpu6050_get_orientation(0, &roll0, &pitch0)) {
-            ESP_LOGI(TAG, "MPU0 - Roll: %.2f°, Pitch: %.2f°", roll0, pitch0);
-        } else {
-            ESP_LOGE(TAG, "Erro ao ler MPU0");
-            roll0 = pitch0 = 0.0;
+        EventBits_t bits = xEventGroupGetBits(wifi_event_group);
+        bool online = (bits & (CONNECTED_BIT | AUTH_BIT)) == (CONNECTED_BIT | AUTH_BIT);
+        if (online && batch == NULL) {
+            batch = new RTDBBatch(firebase_db, path, UPLOAD_BATCH_SAMPLES, UPLOAD_BATCH_AGE_MS);
         }
 
-        // Lê dados do MPU1
-        if (mpu6050_get_orientation(1, &roll1, &pitch1)) {
-            ESP_LOGI(TAG, "MPU1 - Roll: %.2f°, Pitch: %.2f°", roll1, pitch1);
-        } else {
-            ESP_LOGE(TAG, "Erro ao ler MPU1");
-            roll1 = pitch1 = 0.0;
+        // Sem relógio não há chave para o histórico: até o SNTP responder, as amostras esperam no ring.
+        // Um lote cheio é enviado ali mesmo e a aquisição segue enchendo o ring
+        upload_record_t record;
+        while (time(NULL) > CLOCK_VALID_EPOCH_S && sample_ring_pop(&upload_ring, &record)) {
+            history_record_t history;
+            to_history_record(&record, &history);
+            bool direct = online && !batch->isRetrying();
+            if (direct) {
+                batch_add(batch, &sample_arena, &history);
+            } else if (journal_ok) {
+                sample_journal_append(&journal, &history);
+            } else if (batch != NULL) {
+                batch_add(batch, &sample_arena, &history);
+            } else {
+                lost++;
+            }
+            if (journaling == direct) {
+                journaling = !direct;
+                ESP_LOGI(TAG, journaling ? "Sem conexão com o Firebase: histórico vai para o journal"
+                                         : "Conexão restabelecida: histórico vai direto para o Firebase");
+            }
+        }
+        if (batch != NULL) {
+            batch->poll();
         }
 
-        // Envia dados para o Firebase
-        data["sensor1"]["roll"] = roll0;
-        data["sensor1"]["pitch"] = pitch0;
-        data["sensor2"]["roll"] = roll1;
-        data["sensor2"]["pitch"] = pitch1;
+        // O que ficou no journal sai em lotes maiores, só enquanto o envio direto está em dia
+        if (journal_ok && online && !batch->isRetrying() && sample_journal_pending(&journal) > 0 &&
+            esp_timer_get_time() >= next_drain_us) {
+            if (drain_start_us == 0) {
+                drain_start_us = esp_timer_get_time();
+                drained = 0;
+            }
+            if (drain_journal(&journal, path, &drained) != ESP_OK) {
+                next_drain_us = esp_timer_get_time() + JOURNAL_RETRY_MS * 1000LL;
+            } else if (sample_journal_pending(&journal) == 0) {
+                int64_t elapsed_us = esp_timer_get_time() - drain_start_us;
+                ESP_LOGI(TAG, "Journal reenviado: %lu registros em %lld ms (%.0f registros/s)",
+                         (unsigned long)drained, (long long)(elapsed_us / 1000),
+                         elapsed_us > 0 ? drained * 1e6 / elapsed_us : 0.0);
+                drain_start_us = 0;
+            }
+        }
 
-        db.putData("/accel", data);
-        ESP_LOGI(TAG, "Dados enviados ao Firebase");
+        rtdb_batch_stats_t batch_stats = batch != NULL ? batch->getStats() : rtdb_batch_stats_t{};
+        if (batch_stats.requests != reported_requests) {
+            reported_requests = batch_stats.requests;
+            if (batch_stats.samples_sent > 0 && boot_phase_us[BOOT_FIRST_UPLOAD] == 0) {
+                boot_mark(BOOT_FIRST_UPLOAD);
+                boot_log_summary();
+            }
+            sample_ring_stats_t ring_stats;
+            sample_ring_get_stats(&upload_ring, &ring_stats);
+            ESP_LOGI(TAG, "%lu requisições (%lu falhas), %lu registros enviados, %lu descartados no ring, %lu no lote",
+                     (unsigned long)batch_stats.requests, (unsigned long)batch_stats.failures,
+                     (unsigned long)batch_stats.samples_sent,
+                     (unsigned long)(ring_stats.dropped + batch_stats.samples_dropped + lost),
+                     (unsigned long)batch->pending());
+            if (journal_ok) {
+                sample_journal_stats_t journal_stats;
+                sample_journal_get_stats(&journal, &journal_stats);
+                ESP_LOGI(TAG, "Journal: %lu pendentes, %lu gravados, %lu reenviados, %lu descartados, %lu corrompidos",
+                         (unsigned long)sample_journal_pending(&journal), (unsigned long)journal_stats.appended,
+                         (unsigned long)journal_stats.released, (unsigned long)journal_stats.dropped,
+                         (unsigned long)journal_stats.corrupt);
+            }
+            http_stats_t http_stats = firebase_app->getHttpStats();
+            ESP_LOGI(TAG, "HTTPS: %lu handshakes (%lu reconexões, média %lld us), %lu requisições em conexões reaproveitadas, "
+                     "%lu falhas de conexão",
+                     (unsigned long)http_stats.handshakes, (unsigned long)http_stats.reconnects,
+                     (long long)(http_stats.reconnects ? http_stats.reconnect_us / http_stats.reconnects : 0),
+                     (unsigned long)http_stats.reused, (unsigned long)http_stats.connect_failures);
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(UPLOAD_POLL_MS));
     }
 }
 
+// Nada no boot espera por outra etapa sem precisar: a associação WPA2-Enterprise segue nas tasks do Wi-Fi
+// enquanto os sensores são inicializados aqui, o login só espera o IP e o upload não espera nenhum dos dois
 extern "C" void app_main(void) {
     ESP_ERROR_CHECK(nvs_flash_init());
+    sample_ring_init(&upload_ring, upload_storage, sizeof(upload_record_t), UPLOAD_RING_CAPACITY, UPLOAD_RING_POLICY);
     init_wifi();
-    xTaskCreate(mpu_task, "mpu_task", 12288, NULL, 5, NULL);
+    xTaskCreate(auth_task, "auth_task", 12288, NULL, 5, NULL);
+    xTaskCreate(upload_task, "upload_task", 12288, NULL, 5, NULL);
+
+    // A aquisição começa antes da rede e não depende dela
+    // Com algum sensor falho o marco não é registrado e o resumo do boot mostra 0
+    if (mpu6050_init_all()) {
+        boot_mark(BOOT_SENSORS_READY);
+    } else {
+        ESP_LOGE(TAG, "Falha na inicialização dos sensores MPU6050 em %lld ms", (long long)(esp_timer_get_time() / 1000));
+    }
+    // Os barramentos são lidos em paralelo, acordados pelo pino INT do primeiro sensor
+    if (!mpu6050_start_frame_acquisition(MPU_SAMPLE_RATE_HZ, on_frame, NULL)) {
+        ESP_LOGE(TAG, "Falha ao iniciar a aquisição dos sensores MPU6050");
+    } else {
+        ESP_LOGI(TAG, "Sensores MPU6050 inicializados");
+    }
 }